@@ -8,6 +8,7 @@
 /* Read the IR sensor and try to figure out where the heat is located. 
 */
 #include "HeatSensor.h"
+#include "globals.h" // logMsg(), sensorSample()
 
 #include <Wire.h>
 #include <Adafruit_AMG88xx.h>
@@ -61,6 +62,11 @@ void HeatSensor::find_focus()
     y = max(-1.0, min(1.0, y));
     magnitude = max(0, min(50, maxVal - 20));
 
+    // Record or replay the result (sensorlog.cpp), in thousandths.
+    x         = sensorSample(SENSOR_HEAT_X, x * 1000.0) / 1000.0;
+    y         = sensorSample(SENSOR_HEAT_Y, y * 1000.0) / 1000.0;
+    magnitude = sensorSample(SENSOR_HEAT_MAGNITUDE, magnitude * 1000.0) / 1000.0;
+
     // Report.
 #define SERIAL_OUT  3
 #if SERIAL_OUT == 1
@@ -87,12 +93,9 @@ void HeatSensor::find_focus()
     Serial.println();
 #endif
 #if SERIAL_OUT == 3 || SERIAL_OUT == 2
-    // Print coordinates and brightness
-    Serial.print(x);
-    Serial.print(' ');
-    Serial.print(y);
-    Serial.print(' ');
-    Serial.println(magnitude);
+    // Print coordinates and brightness (x100), via deferred log since
+    // this runs every frame
+    logMsg(LOG_HEAT, (int32_t)(x * 100.0), (int32_t)(y * 100.0), (int32_t)(magnitude * 100.0));
 #endif
 }
 
@@ -52,6 +52,7 @@
 
 // Global eye state that applies to all eyes (not per-eye):
 bool     eyeInMotion = false;
+bool     bigSaccade  = false; // Current move is a big saccade (not micro)
 float    eyeOldX, eyeOldY, eyeNewX, eyeNewY;
 uint32_t eyeMoveStartTime = 0L;
 int32_t  eyeMoveDuration  = 0L;
@@ -131,6 +132,57 @@ static inline uint16_t readBoop(void) {
   return counter;
 }
 
+// Blend two big-endian RGB565 pixels, as used in the column buffers.
+// 'a' is the weight of 'fg', 0-32. All three channels are spread into
+// one 32-bit word (green in the top half) and scaled with a single
+// multiply each, no per-channel unpacking.
+static inline uint16_t blend565(uint16_t fg, uint16_t bg, uint8_t a) {
+  uint32_t f = __builtin_bswap16(fg), b = __builtin_bswap16(bg);
+  f = (f | (f << 16)) & 0x07E0F81F;
+  b = (b | (b << 16)) & 0x07E0F81F;
+  uint32_t r = ((f * a + b * (32 - a)) >> 5) & 0x07E0F81F;
+  return __builtin_bswap16((uint16_t)(r | (r >> 16)));
+}
+
+// Bilinear texture sample. tx/ty are texel coords, fx/fy their 5-bit
+// (0-31) fractional parts. Texels are big-endian 565; all four are spread
+// into 0x07E0F81F fields so R, G and B are weighted in one multiply each.
+// X wraps around (angle is circular), Y clamps at the last row.
+static inline uint16_t bilerp565(const uint16_t *tex, int w, int h,
+  int tx, int fx, int ty, int fy) {
+  int tx1 = tx + 1;
+  if(tx1 >= w) tx1 = 0;
+  const uint16_t *row0 = &tex[ty * w],
+                 *row1 = (ty < (h - 1)) ? row0 + w : row0;
+  uint32_t p00 = __builtin_bswap16(row0[tx]), p01 = __builtin_bswap16(row0[tx1]),
+           p10 = __builtin_bswap16(row1[tx]), p11 = __builtin_bswap16(row1[tx1]);
+  p00 = (p00 | (p00 << 16)) & 0x07E0F81F;
+  p01 = (p01 | (p01 << 16)) & 0x07E0F81F;
+  p10 = (p10 | (p10 << 16)) & 0x07E0F81F;
+  p11 = (p11 | (p11 << 16)) & 0x07E0F81F;
+  uint32_t top = ((p00 * (32 - fx) + p01 * fx) >> 5) & 0x07E0F81F,
+           bot = ((p10 * (32 - fx) + p11 * fx) >> 5) & 0x07E0F81F,
+           r   = ((top * (32 - fy) + bot * fy) >> 5) & 0x07E0F81F;
+  return __builtin_bswap16((uint16_t)(r | (r >> 16)));
+}
+
+// Advance one texture's rotation for a new frame. 'ms' is the current
+// millis() time, 'dither' a 0-1023 threshold that varies frame to frame.
+static inline void spinTexture(texture *tex, uint32_t ms, uint32_t dither) {
+  if(tex->iSpin) {
+    // Spin works in fixed amount per frame (eyes may lose sync, but "wagon wheel" tricks work)
+    tex->fineAngle += tex->iSpin;
+  } else {
+    // Keep consistent timing in spin animation (eyes stay in sync, no "wagon wheel" effects)
+    // 'spin' is angle units per minute; scale to 12.20 units per millisecond
+    // so the product with millis() stays exact however long we've run.
+    int32_t rate   = (int32_t)(tex->spin * (1048576.0 / 60000.0));
+    tex->fineAngle = ((uint32_t)tex->startAngle << 10) +
+                     (uint32_t)(((int64_t)rate * ms) >> 10);
+  }
+  tex->angle = ((tex->fineAngle + dither) >> 10) & 1023;
+}
+
 // Crude error handler. Prints message to Serial Monitor, blinks LED.
 void fatal(const char *message, uint16_t blinkDelay) {
   Serial.begin(9600);
@@ -157,6 +209,10 @@ void setup() {
 #else
   if(!arcada.filesysBegin())    fatal("No filesystem found!", 250);
 #endif
+  midiBegin(); // USB MIDI puppeteering, with the drive (midi.cpp)
+
+  blockCacheBegin(); // Filesystem reads go through sector cache
+  if(filesystem_change_flag) handle_filesystem_change(); // Index assets
 
   user_setup();
 
@@ -170,6 +226,10 @@ void setup() {
   Serial.begin(115200);
   //while(!Serial) yield();
 
+  // Enable the DWT cycle counter, used for render cost stats (STATUS)
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+
   Serial.printf("Available RAM at start: %d\n", availableRAM());
   Serial.printf("Available flash at start: %d\n", arcada.availableFlash());
   yield(); // Periodic yield() makes sure mass storage filesystem stays alive
@@ -186,11 +246,11 @@ void setup() {
 
   // Button overrides: hold a button at boot to load config1/2/3.eye
   uint32_t buttonState = arcada.readButtons();
-  if((buttonState & ARCADA_BUTTONMASK_UP) && arcada.exists("config1.eye")) {
+  if((buttonState & ARCADA_BUTTONMASK_UP) && assetExists("config1.eye")) {
     filename = (char *)"config1.eye";
-  } else if((buttonState & ARCADA_BUTTONMASK_A) && arcada.exists("config2.eye")) {
+  } else if((buttonState & ARCADA_BUTTONMASK_A) && assetExists("config2.eye")) {
     filename = (char *)"config2.eye";
-  } else if((buttonState & ARCADA_BUTTONMASK_DOWN) && arcada.exists("config3.eye")) {
+  } else if((buttonState & ARCADA_BUTTONMASK_DOWN) && assetExists("config3.eye")) {
     filename = (char *)"config3.eye";
   }
 
@@ -231,9 +291,12 @@ void setup() {
       }
     }
     eye[e].colNum       = DISPLAY_SIZE; // Force initial wraparound to first column
+    eye[e].interlaced   = false;
+    eye[e].field        = 0;
     eye[e].colIdx       = 0;
     eye[e].dma_busy     = false;
     eye[e].column_ready = false;
+    eye[e].spiActive    = false;
     eye[e].dmaStartTime = 0;
 
     // Default settings that can be overridden in config file
@@ -244,18 +307,24 @@ void setup() {
     eye[e].iris.filename     = NULL;
     eye[e].iris.startAngle   = (e & 1) ? 512 : 0; // Rotate alternate eyes 180 degrees
     eye[e].iris.angle        = eye[e].iris.startAngle;
+    eye[e].iris.fineAngle    = (uint32_t)eye[e].iris.startAngle << 10;
     eye[e].iris.mirror       = 0;
     eye[e].iris.spin         = 0.0;
     eye[e].iris.iSpin        = 0;
+    eye[e].iris.filter       = false;
     eye[e].sclera.color      = 0xFFFF;
     eye[e].sclera.data       = NULL;
     eye[e].sclera.filename   = NULL;
     eye[e].sclera.startAngle = (e & 1) ? 512 : 0; // Rotate alternate eyes 180 degrees
     eye[e].sclera.angle      = eye[e].sclera.startAngle;
+    eye[e].sclera.fineAngle  = (uint32_t)eye[e].sclera.startAngle << 10;
     eye[e].sclera.mirror     = 0;
     eye[e].sclera.spin       = 0.0;
     eye[e].sclera.iSpin      = 0;
+    eye[e].sclera.filter     = false;
     eye[e].rotation          = 3;
+    eye[e].irisRadius        = 0.0;  // Use global irisRadius
+    eye[e].lutRadius         = -1.0; // Force distLUT[] calc on first frame
 
     // Uncanny eyes carryover stuff for now, all messy:
     eye[e].blink.state = NOBLINK;
@@ -320,6 +389,7 @@ void setup() {
   // program and to handle small heap allocations.
 
   uint32_t maxRam = availableRAM() - stackReserve;
+  uint32_t loadStart = DWT->CYCCNT; // For STATUS load times
 
   // Load texture maps for eyes
   uint8_t e2;
@@ -388,14 +458,18 @@ void setup() {
   status = loadEyelid(lowerEyelidFilename ?
     lowerEyelidFilename : (char *)"lower.bmp",
     lowerOpen, lowerClosed, 0, maxRam);
+  textureLoadCycles = DWT->CYCCNT - loadStart;
 
-  // Filenames are no longer needed...
+  // Filenames are no longer needed... (cleared too, as reloadEyeConfig()
+  // frees any still set)
   for(e=0; e<NUM_EYES; e++) {
-    if(eye[e].sclera.filename) free(eye[e].sclera.filename);
-    if(eye[e].iris.filename)   free(eye[e].iris.filename);
+    free(eye[e].sclera.filename);
+    free(eye[e].iris.filename);
+    eye[e].sclera.filename = eye[e].iris.filename = NULL;
   }
-  if(lowerEyelidFilename) free(lowerEyelidFilename);
-  if(upperEyelidFilename) free(upperEyelidFilename);
+  free(lowerEyelidFilename);
+  free(upperEyelidFilename);
+  lowerEyelidFilename = upperEyelidFilename = NULL;
 
   // Note that calls to availableRAM() at this point will return something
   // close to reserveSpace, suggesting very little RAM...but that function
@@ -403,14 +477,17 @@ void setup() {
   // established above that the top of the heap is something of a mirage.
   // Large allocations CAN still take place in the lower heap!
 
+  loadStart = DWT->CYCCNT;
   calcMap();
   calcDisplacement();
+  tableGenCycles = DWT->CYCCNT - loadStart;
   Serial.printf("Free RAM: %d\n", availableRAM());
 
   randomSeed(SysTick->VAL + analogRead(A2));
   eyeOldX = eyeNewX = eyeOldY = eyeNewY = mapRadius; // Start in center
   for(e=0; e<NUM_EYES; e++) { // For each eye...
     eye[e].display->setRotation(eye[e].rotation);
+    displayFastSetup(&eye[e]);
     eye[e].eyeX = eyeOldX; // Set up initial position
     eye[e].eyeY = eyeOldY;
   }
@@ -434,11 +511,13 @@ void setup() {
 
 #if defined(ADAFRUIT_MONSTER_M4SK_EXPRESS)
   if(voiceOn) {
+    fxSetup(voiceFX, numVoiceFX); // Before the audio interrupts start, for timing
     if(!voiceSetup((waveform > 0))) {
       Serial.println("Voice init fail, continuing without");
       voiceOn = false;
     } else {
       voiceGain(gain);
+      voiceAGC(agcTarget, agcMaxGain, agcAttack, agcRelease, noiseGate);
       currentPitch = voicePitch(currentPitch);
       if(waveform) voiceMod(modulate, waveform);
       arcada.enableSpeaker(true);
@@ -495,20 +574,41 @@ eyes (the eye updates aren't necessarily synchronized; each can function at
 an independent frame rate depending on particular complexity at the moment).
 */
 
-// loop() function processes ONE COLUMN of ONE EYE...
+// The Arduino core services USB (TinyUSB task, via yield()) after every
+// return from loop(). Doing that after every column is wasteful, and an
+// MSC burst landing mid-frame stalls the eyes, so loop() instead keeps
+// stepping columns until usbsched.cpp says USB is due: preferably while
+// waiting on DMA, and never less often than its maximum interval.
+
+static bool renderStep(void);
 
 void loop() {
+  usbSliceDone();
+  while(!usbServiceDue(renderStep()));
+  logDrain(); // Deferred serial output, off the render path
+  sensorLogService(); // Sensor record/replay file access, likewise
+  performService();   // Performance record/playback, likewise
+}
+
+// renderStep() processes ONE COLUMN of ONE EYE. Returns true if it was
+// waiting on DMA (a good moment to let other things run), else false.
+
+static bool renderStep(void) {
   if(++eyeNum >= NUM_EYES) eyeNum = 0; // Cycle through eyes...
 
-  uint8_t  x = eye[eyeNum].colNum;
+  uint8_t  c = eye[eyeNum].colNum; // Column count within frame (or field)
+  uint8_t  x = eye[eyeNum].interlaced ? (c * 2 + eye[eyeNum].field) : c;
   uint32_t t = micros();
 
   // If next column for this eye is not yet rendered...
   if(!eye[eyeNum].column_ready) {
-    if(!x) { // If it's the first column...
+    if(!c) { // If it's the first column...
 
       // ONCE-PER-FRAME EYE ANIMATION LOGIC HAPPENS HERE -------------------
 
+      cueFrame(eyeNum, t);  // Fire show cues due this frame (cue.cpp)
+      midiFrame(eyeNum, t); // Apply MIDI received since last frame (midi.cpp)
+
       // Eye movement
       float eyeX, eyeY;
       if(moveEyesRandomly) {
@@ -516,6 +616,7 @@ void loop() {
         if(eyeInMotion) {                       // Eye currently moving?
           if(dt >= eyeMoveDuration) {           // Time up?  Destination reached.
             eyeInMotion = false;                // Stop moving
+            bigSaccade  = false;
             // The "move" duration temporarily becomes a hold duration...
             // Normally this is 35 ms to 1 sec, but don't exceed gazeMax setting
             uint32_t limit = min(1000000, gazeMax);
@@ -547,6 +648,7 @@ void loop() {
               // Set the duration for this move, and start it going.
               eyeMoveDuration = random(83000, 166000); // ~1/12 - ~1/6 sec
               saccadeInterval = 0; // Calc next interval when this one stops
+              bigSaccade      = true;
             } else { // Microsaccade
               // r is possible radius of motion, ~1/10 size of full saccade.
               // We don't bother with clipping because if it strays just a little,
@@ -567,11 +669,19 @@ void loop() {
         }
       } else {
         // Allow user code to control eye position (e.g. IR sensor, joystick, etc.)
+        // Unless disabled, target is smoothed & predicted (pursuit.cpp).
         float r = ((float)mapDiameter - (float)DISPLAY_SIZE * M_PI_2) * 0.9;
-        eyeX = mapRadius + eyeTargetX * r;
-        eyeY = mapRadius + eyeTargetY * r;
+        float tx = eyeTargetX, ty = eyeTargetY;
+        if(pursuit) eyeInMotion = bigSaccade = pursuitUpdate(t, &tx, &ty);
+        eyeX = mapRadius + tx * r;
+        eyeY = mapRadius + ty * r;
       }
 
+      // Record this frame's gaze, or replace it from a recording (perform.cpp)
+      bool  saccading = eyeInMotion && bigSaccade;
+      float pupil     = (pupilHold >= 0.0) ? pupilHold : irisValue; // Cue/MIDI may hold it
+      performFrame(eyeNum, &eyeX, &eyeY, &pupil, &saccading);
+
       // Eyes fixate (are slightly crossed) -- amount is filtered for boops
       int nufix = booped ? 90 : 7;
       fixate = ((fixate * 15) + nufix) / 16;
@@ -582,14 +692,28 @@ void loop() {
       eye[eyeNum].eyeY = eyeY;
 
       // pupilFactor? irisValue? TO DO: pick a name and stick with it
-      eye[eyeNum].pupilFactor = irisValue;
+      eye[eyeNum].pupilFactor = pupil;
+
+      // Iris size is per-eye and may "breathe" over time. Only the small
+      // distance LUT is recomputed, and only when the size has changed;
+      // the polar map itself is independent of iris size.
+      float iRad = eye[eyeNum].irisRadius;
+      if(irisBreathe > 0.0) {
+        uint32_t period = (uint32_t)(irisBreathePeriod * 1000.0);
+        if(period) iRad *= 1.0 + irisBreathe * sin((float)(millis() % period) * (2.0 * M_PI) / (float)period);
+      }
+      if(fabs(iRad - eye[eyeNum].lutRadius) >= 0.05) {
+        calcDistLUT(eye[eyeNum].distLUT, iRad);
+        eye[eyeNum].lutRadius = iRad;
+      }
       // Also note - irisValue is calculated at the END of this function
       // for the next frame (because the sensor must be read when there's
       // no SPI traffic to the left eye)
 
       // Similar to the autonomous eye movement above -- blink start times
       // and durations are random (within ranges).
-      if((t - timeOfLastBlink) >= timeToNextBlink) { // Start new blink?
+      // A performance being played back brings its own blinks.
+      if((performMode != PERFORM_PLAY) && ((t - timeOfLastBlink) >= timeToNextBlink)) { // Start new blink?
         timeOfLastBlink = t;
         uint32_t blinkDuration = random(36000, 72000); // ~1/28 - ~1/14 sec
         // Set up durations for both eyes (if not already winking)
@@ -602,13 +726,14 @@ void loop() {
         }
         timeToNextBlink = blinkDuration * 3 + random(4000000);
       }
+      performBlinks(eyeNum, t);
 
       float uq, lq; // So many sloppy temp vars in here for now, sorry
       if(tracking) {
         // Eyelids naturally "track" the pupils (move up or down automatically)
         int ix = (int)map2screen(mapRadius - eye[eyeNum].eyeX) + (DISPLAY_SIZE/2), // Pupil position
             iy = (int)map2screen(mapRadius - eye[eyeNum].eyeY) + (DISPLAY_SIZE/2); // on screen
-        iy += irisRadius * trackFactor;
+        iy += eye[eyeNum].lutRadius * trackFactor;
         if(eyeNum & 1) ix = DISPLAY_SIZE - 1 - ix; // Flip for right eye
         if(iy > upperOpen[ix]) {
           uq = 1.0;
@@ -628,6 +753,7 @@ void loop() {
         uq = 1.0;
         lq = 1.0;
       }
+      if(lidHold >= 0.0) uq = lq = lidHold; // Lids puppeteered (midi.cpp)
       // Dampen eyelid movements slightly
       // SAVE upper & lower lid factors per eye,
       // they need to stay consistent across frame
@@ -657,16 +783,17 @@ void loop() {
       // of both screens is about 1/2 this.
       frames++;
       if(((t - lastFrameRateReportTime) >= 1000000) && t) { // Once per sec.
-        Serial.println((frames * 1000) / (t / 1000));
+        logMsg(LOG_FPS, (frames * 1000) / (t / 1000));
         lastFrameRateReportTime = t;
       }
 
       // Once per frame (of eye #0), reset boopSum...
       if((eyeNum == 0) && (boopPin >= 0)) {
+        boopSum         = sensorSample(SENSOR_BOOP, boopSum);
         boopSumFiltered = ((boopSumFiltered * 3) + boopSum) / 4;
-        if(boopSumFiltered > boopThreshold) {
+        if(boopSumFiltered > (uint32_t)sensorSample(SENSOR_BOOP_THRESHOLD, boopThreshold)) {
           if(!booped) {
-            Serial.println("BOOP!");
+            logMsg(LOG_BOOP);
           }
           booped = true;
         } else {
@@ -675,20 +802,27 @@ void loop() {
         boopSum = 0;
       }
 
-      float mins = (float)millis() / 60000.0;
-      if(eye[eyeNum].iris.iSpin) {
-        // Spin works in fixed amount per frame (eyes may lose sync, but "wagon wheel" tricks work)
-        eye[eyeNum].iris.angle   += eye[eyeNum].iris.iSpin;
-      } else {
-        // Keep consistent timing in spin animation (eyes stay in sync, no "wagon wheel" effects)
-        eye[eyeNum].iris.angle    = (int)((float)eye[eyeNum].iris.startAngle   + eye[eyeNum].iris.spin   * mins + 0.5);
-      }
-      if(eye[eyeNum].sclera.iSpin) {
-        eye[eyeNum].sclera.angle += eye[eyeNum].sclera.iSpin;
+      // During big saccades the eye is a blur to the viewer anyway. Render
+      // only even or only odd columns (alternating "fields") so the eye's
+      // position updates twice as often, back to full frames at fixation.
+      eye[eyeNum].interlaced = interlace && saccading;
+      if(eye[eyeNum].interlaced) {
+        eye[eyeNum].field ^= 1;
+        x = eye[eyeNum].field;
       } else {
-        eye[eyeNum].sclera.angle  = (int)((float)eye[eyeNum].sclera.startAngle + eye[eyeNum].sclera.spin * mins + 0.5);
+        x = 0;
       }
 
+      // Texture rotation is tracked in 22.10 fixed point. The integer part
+      // is what the renderer uses per pixel; the fraction is dithered over
+      // successive frames (bit-reversed frame count gives a well-spread
+      // threshold sequence) so slow spins average out to the true angle
+      // rather than stepping once every several frames.
+      uint32_t ms     = millis();
+      uint32_t dither = __RBIT(frames) >> 22; // 0 to 1023
+      spinTexture(&eye[eyeNum].iris  , ms, dither);
+      spinTexture(&eye[eyeNum].sclera, ms, dither);
+
       // END ONCE-PER-FRAME EYE ANIMATION ----------------------------------
 
     } // end first-scanline check
@@ -706,6 +840,7 @@ void loop() {
     iPupilFactor = (int)((float)eye[eyeNum].iris.height * 256 * (1.0 / eye[eyeNum].pupilFactor));
 
     int y1, y2;
+    int a1, a2; // Eye coverage (0-256) of the edge pixels at y1 and y2
     int lidColumn = (eyeNum & 1) ? (DISPLAY_SIZE - 1 - x) : x; // Reverse eyelid columns for left eye
 
     DmacDescriptor *d = &eye[eyeNum].column[eye[eyeNum].colIdx].descriptor[0];
@@ -718,13 +853,20 @@ void loop() {
       d->SRCADDR.reg       = (uint32_t)&eyelidIndex;
       d->DESCADDR.reg      = 0; // No linked descriptor
     } else {
-      y1 = lowerClosed[lidColumn] + (int)(0.5 + lowerLidFactor *
+      // Lid edges are computed in 24.8 fixed point, offset by half a pixel
+      // so the integer part is the same rounded y1/y2 as always and the
+      // fraction tells how much of that edge pixel the eye covers.
+      int f1 = (lowerClosed[lidColumn] << 8) + (int)(128.5 + lowerLidFactor * 256.0 *
         (float)((int)lowerOpen[lidColumn] - (int)lowerClosed[lidColumn]));
-      y2 = upperClosed[lidColumn] + (int)(0.5 + upperLidFactor *
+      int f2 = (upperClosed[lidColumn] << 8) + (int)(128.5 + upperLidFactor * 256.0 *
         (float)((int)upperOpen[lidColumn] - (int)upperClosed[lidColumn]));
+      y1 = f1 >> 8;
+      y2 = f2 >> 8;
+      a1 = 256 - (f1 & 255); // Lower lid covers bottom part of pixel y1
+      a2 = f2 & 255;         // Upper lid covers top part of pixel y2
       if(y1 > DISPLAY_SIZE-1)    y1 = DISPLAY_SIZE-1; // Clip results in case lidfactor
-      else if(y1 < 0) y1 = 0;   // is beyond the usual 0.0 to 1.0 range
-      if(y2 > DISPLAY_SIZE-1)    y2 = DISPLAY_SIZE-1;
+      else if(y1 < 0) { y1 = 0; a1 = 256; } // is beyond the usual 0.0 to 1.0 range
+      if(y2 > DISPLAY_SIZE-1) { y2 = DISPLAY_SIZE-1; a2 = 256; }
       else if(y2 < 0) y2 = 0;
       if(y1 >= y2) {
         // Eyelid is fully or partially closed, enough that there are no
@@ -762,6 +904,7 @@ void loop() {
 #endif
         // Render column 'x' into eye's next available renderBuf
         uint16_t *ptr = eye[eyeNum].column[eye[eyeNum].colIdx].renderBuf;
+        uint32_t  renderStart = DWT->CYCCNT; // For STATUS cycles/pixel
         int xx = xPositionOverMap + x;
         int y;
 
@@ -774,6 +917,7 @@ void loop() {
 
         // tablegen.cpp explains a bit of the displacement mapping trick.
         uint8_t *displaceX, *displaceY;
+        const int8_t *distLUT = eye[eyeNum].distLUT; // Radial code -> dist
         int8_t   xmul; // Sign of X displacement: +1 or -1
         int      doff; // Offset into displacement arrays
         if(x < (DISPLAY_SIZE/2)) {  // Left half of screen (quadrants 2, 3)
@@ -785,6 +929,8 @@ void loop() {
           displaceY = &displace[(x - (DISPLAY_SIZE/2)) * (DISPLAY_SIZE/2)];
           xmul      =  1; // X displacement is always positive
         }
+        const uint8_t *rim     = foveate ? rimMap : NULL; // Rim detail bitmap
+        int            rimBase = displaceY - displace;    // Column's offset in it
 
         for(; y<=y2; y++) { // For each pixel of open eye in this column...
           int yy = yPositionOverMap + y;
@@ -797,6 +943,14 @@ void loop() {
             doff = y - (DISPLAY_SIZE/2);
             dy   =  displaceY[doff];
           }
+          if(rim && (y & 1) && (y > y1)) { // Foveation: reduced detail at rim
+            int r = rimBase + doff;
+            if(rim[r >> 3] & (1 << (r & 7))) {
+              *ptr = ptr[-1]; // Repeat neighbor pixel
+              ptr++;
+              continue;
+            }
+          }
           dx = displaceX[doff * (DISPLAY_SIZE/2)];
           if(dx < 255) {      // Inside eyeball area
             dx *= xmul;       // Flip sign of x offset if in quadrants 2 or 3
@@ -812,14 +966,14 @@ void loop() {
                   my   -= mapRadius;
                   moff  = my * mapRadius + mx; // Offset into map arrays
                   angle = polarAngle[moff];
-                  dist  = polarDist[moff];
+                  dist  = distLUT[polarDist[moff]];
                 } else {                // Quadrant 2
                   // ROTATE angle by 90 degrees (270 degrees clockwise; 768)
                   // MIRROR dist on X axis
                   mx    = mapRadius - 1 - mx;
                   my   -= mapRadius;
                   angle = polarAngle[mx * mapRadius + my] + 768;
-                  dist  = polarDist[ my * mapRadius + mx];
+                  dist  = distLUT[polarDist[ my * mapRadius + mx]];
                 }
               } else {
                 if(mx < mapRadius) {  // Quadrant 3
@@ -829,30 +983,46 @@ void loop() {
                   my    = mapRadius - 1 - my;
                   moff  = my * mapRadius + mx;
                   angle = polarAngle[moff] + 512;
-                  dist  = polarDist[ moff];
+                  dist  = distLUT[polarDist[ moff]];
                 } else {                // Quadrant 4
                   // ROTATE angle by 270 degrees (90 degrees clockwise; 256)
                   // MIRROR dist on Y axis
                   mx   -= mapRadius;
                   my    = mapRadius - 1 - my;
                   angle = polarAngle[mx * mapRadius + my] + 256;
-                  dist  = polarDist[ my * mapRadius + mx];
+                  dist  = distLUT[polarDist[ my * mapRadius + mx]];
                 }
               }
               // Convert angle/dist to texture map coords
               if(dist >= 0) { // Sclera
                 angle = ((angle + eye[eyeNum].sclera.angle) & 1023) ^ eye[eyeNum].sclera.mirror;
-                int tx = angle * eye[eyeNum].sclera.width  / 1024; // Texture map x/y
-                int ty = dist  * eye[eyeNum].sclera.height / 128;
-                *ptr++ = eye[eyeNum].sclera.data[ty * eye[eyeNum].sclera.width + tx];
+                if(eye[eyeNum].sclera.filter) {
+                  // Fractional bits come from the map's own resolution
+                  // (1024 angles, 128 distances) relative to texture size.
+                  int u = angle * eye[eyeNum].sclera.width, // 22.10
+                      v = dist  * eye[eyeNum].sclera.height; // 25.7
+                  *ptr++ = bilerp565(eye[eyeNum].sclera.data, eye[eyeNum].sclera.width,
+                    eye[eyeNum].sclera.height, u >> 10, (u >> 5) & 31, v >> 7, (v >> 2) & 31);
+                } else {
+                  int tx = angle * eye[eyeNum].sclera.width  / 1024; // Texture map x/y
+                  int ty = dist  * eye[eyeNum].sclera.height / 128;
+                  *ptr++ = eye[eyeNum].sclera.data[ty * eye[eyeNum].sclera.width + tx];
+                }
               } else if(dist > -128) { // Iris or pupil
-                int ty = dist * iPupilFactor / -32768;
+                int v  = dist * -iPupilFactor; // 17.15
+                int ty = v >> 15;
                 if(ty >= eye[eyeNum].iris.height) { // Pupil
                   *ptr++ = eye[eyeNum].pupilColor;
                 } else { // Iris
                   angle = ((angle + eye[eyeNum].iris.angle) & 1023) ^ eye[eyeNum].iris.mirror;
-                  int tx = angle * eye[eyeNum].iris.width / 1024;
-                  *ptr++ = eye[eyeNum].iris.data[ty * eye[eyeNum].iris.width + tx];
+                  if(eye[eyeNum].iris.filter) {
+                    int u = angle * eye[eyeNum].iris.width; // 22.10
+                    *ptr++ = bilerp565(eye[eyeNum].iris.data, eye[eyeNum].iris.width,
+                      eye[eyeNum].iris.height, u >> 10, (u >> 5) & 31, ty, (v >> 10) & 31);
+                  } else {
+                    int tx = angle * eye[eyeNum].iris.width / 1024;
+                    *ptr++ = eye[eyeNum].iris.data[ty * eye[eyeNum].iris.width + tx];
+                  }
                 }
               } else {
                 *ptr++ = eye[eyeNum].backColor; // Back of eye
@@ -865,6 +1035,21 @@ void loop() {
           }
         }
 
+        // Anti-alias the two lid edges: blend the first and last rendered
+        // pixels toward the eyelid color by their lid coverage. Always
+        // exactly two blends per column regardless of display size.
+        {
+#if NUM_DESCRIPTORS == 1
+          uint16_t *edge = eye[eyeNum].column[eye[eyeNum].colIdx].renderBuf;
+#else
+          uint16_t *edge = eye[eyeNum].column[eye[eyeNum].colIdx].renderBuf - y1;
+#endif
+          edge[y1] = blend565(edge[y1], eyelidColor, a1 >> 3);
+          edge[y2] = blend565(edge[y2], eyelidColor, a2 >> 3);
+        }
+        renderCycles += DWT->CYCCNT - renderStart;
+        renderPixels += y2 - y1 + 1;
+
 #if NUM_DESCRIPTORS == 1
         // Render upper eyelid if needed
         for(; y<DISPLAY_SIZE; y++) *ptr++ = eyelidColor;
@@ -889,13 +1074,13 @@ void loop() {
 
   // If DMA for this eye is currently busy, don't block, try next eye...
   if(eye[eyeNum].dma_busy) {
-    if((micros() - eye[eyeNum].dmaStartTime) < DMA_TIMEOUT) return;
+    if((micros() - eye[eyeNum].dmaStartTime) < DMA_TIMEOUT) return true;
     // If we reach this point in the code, an SPI DMA transfer has taken
     // noticably longer than expected and is probably stalled (see comments
     // in the DMAbuddy.h file and above the DMA_TIMEOUT declaration earlier
     // in this code). Take action!
     // digitalWrite(13, HIGH);
-    Serial.printf("Eye #%d stalled, resetting DMA channel...\n", eyeNum);
+    logMsg(LOG_DMA_STALL, eyeNum);
     eye[eyeNum].dma.fix();
     // If this somehow proves to be inadequate, we still have the Nuclear
     // Option of just completely restarting the sketch from the beginning,
@@ -905,16 +1090,11 @@ void loop() {
   }
 
   // At this point, above checks confirm that column is ready and DMA is free
-  if(!x) { // If it's the first column...
-    // End prior SPI transaction...
-    digitalWrite(eye[eyeNum].cs, HIGH); // Deselect
-    eye[eyeNum].spi->endTransaction();
-    // Initialize new SPI transaction & address window...
-    eye[eyeNum].spi->beginTransaction(settings);
-    digitalWrite(eye[eyeNum].cs, LOW);  // Chip select
-    eye[eyeNum].display->setAddrWindow((eye[eyeNum].display->width() - DISPLAY_SIZE) / 2, (eye[eyeNum].display->height() - DISPLAY_SIZE) / 2, DISPLAY_SIZE, DISPLAY_SIZE);
-    delayMicroseconds(1);
-    digitalWrite(eye[eyeNum].dc, HIGH); // Data mode
+  if(!c) { // If it's the first column...
+    // SPI transaction stays open between frames (each eye has its own
+    // bus), so this is just the address window, leaving DC in data mode.
+    displaySelect(&eye[eyeNum]);
+    displayWindow(&eye[eyeNum], 0, DISPLAY_SIZE);
     if(eyeNum == (NUM_EYES-1)) {
       // Handle pupil scaling
       if(lightSensorPin >= 0) {
@@ -925,7 +1105,7 @@ void loop() {
           // pupils will react even if the opposite eye is stimulated.
           // Meaning we can get away with using a single light sensor for
           // both eyes. This comment has nothing to do with the code.
-          uint16_t rawReading = arcada.readLightSensor();
+          uint16_t rawReading = sensorSample(SENSOR_LIGHT, arcada.readLightSensor());
           if(rawReading <= 1023) {
             if(rawReading < lightSensorMin)      rawReading = lightSensorMin; // Clamp light sensor range
             else if(rawReading > lightSensorMax) rawReading = lightSensorMax; // to within usable range
@@ -977,17 +1157,19 @@ void loop() {
         }
         if(buttonState & (ARCADA_BUTTONMASK_UP | ARCADA_BUTTONMASK_A | ARCADA_BUTTONMASK_DOWN)) {
           currentPitch = voicePitch(currentPitch);
-          if(waveform) voiceMod(modulate, waveform);
-          Serial.print("Voice pitch: ");
-          Serial.println(currentPitch);
+          logMsg(LOG_PITCH, (int32_t)(currentPitch * 100.0 + 0.5));
         }
       }
 #endif
+      // Re-index assets after the USB host has been at the drive, once
+      // it's been quiet a moment (so a multi-file copy is one rebuild).
+      if(arcada.recentUSB()) filesystem_change_flag = true;
+      else if(filesystem_change_flag) handle_filesystem_change();
       user_loop();
       if (reloadRequested) {
         reloadEyeConfig(reloadConfigPath);
         reloadRequested = false;
-        return; // Let loop() restart fresh
+        return false; // Let loop() restart fresh
       }
     }
   } // end first-column check
@@ -997,13 +1179,21 @@ void loop() {
     boopSum += readBoop();
   }
 
+  if(eye[eyeNum].interlaced) {
+    // Columns aren't contiguous in a field; each needs its own 1-line
+    // address window.
+    displayWindow(&eye[eyeNum], x, 1);
+  }
+
   memcpy(eye[eyeNum].dptr, &eye[eyeNum].column[eye[eyeNum].colIdx].descriptor[0], sizeof(DmacDescriptor));
   eye[eyeNum].dma_busy       = true;
   eye[eyeNum].dma.startJob();
   eye[eyeNum].dmaStartTime   = micros();
-  if(++eye[eyeNum].colNum >= DISPLAY_SIZE) { // If last line sent...
+  if(++eye[eyeNum].colNum >= (eye[eyeNum].interlaced ? (DISPLAY_SIZE / 2) : DISPLAY_SIZE)) { // If last line sent...
     eye[eyeNum].colNum      = 0;    // Wrap to beginning
+    midiFrameSent(eyeNum);          // For MIDI-to-screen latency
   }
   eye[eyeNum].colIdx       ^= 1;    // Alternate 0/1 line structs
   eye[eyeNum].column_ready = false; // OK to render next line
+  return false;
 }
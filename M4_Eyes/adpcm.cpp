@@ -0,0 +1,78 @@
+// SPDX-FileCopyrightText: 2024 Monster Mask Open Claw Project
+//
+// SPDX-License-Identifier: MIT
+
+// IMA-ADPCM decoder for sound files (WAV format 0x11, mono). Four bits per
+// sample instead of eight, so half the flash space and read bandwidth of
+// the 8-bit PCM the player otherwise takes (a quarter of 16-bit PCM's),
+// plus a little for block headers. Audio is stored in independent blocks
+// (blockAlign bytes each, from the WAV fmt chunk), each a 4-byte header
+// holding the first sample and step index, then two samples per byte, low
+// nibble first; one block decodes to (blockAlign - 4) * 2 + 1 samples.
+// Decoding is integer-only: each nibble adds or subtracts a fraction of
+// the current step size (shifts, no multiply) and nudges the step index.
+// tools/wav2adpcm.py makes these files from ordinary WAVs.
+
+#include "globals.h"
+
+static const uint16_t stepTable[89] = {
+      7,     8,     9,    10,    11,    12,    13,    14,    16,    17,
+     19,    21,    23,    25,    28,    31,    34,    37,    41,    45,
+     50,    55,    60,    66,    73,    80,    88,    97,   107,   118,
+    130,   143,   157,   173,   190,   209,   230,   253,   279,   307,
+    337,   371,   408,   449,   494,   544,   598,   658,   724,   796,
+    876,   963,  1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+   2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,
+   5894,  6484,  7132,  7845,  8630,  9493, 10442, 11487, 12635, 13899,
+  15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767 };
+
+static const int8_t indexTable[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+uint32_t adpcmBlocks    = 0; // Blocks decoded...
+uint32_t adpcmCycles    = 0; // ...CPU cycles spent on them...
+uint32_t adpcmCyclesMax = 0; // ...and the most for any one
+
+// Decode one block of 'len' bytes (normally blockAlign, possibly less for
+// the last block of a file) to unsigned 8-bit samples for the DACs.
+// Returns number of samples written to dst, 0 if block is invalid.
+uint16_t adpcmDecodeBlock(const uint8_t *src, uint16_t len, uint8_t *dst) {
+  if(len < 4) return 0;
+  uint32_t startTime = DWT->CYCCNT;
+  int32_t  pred      = (int16_t)(src[0] | (src[1] << 8));
+  int32_t  index     = src[2];
+  if(index > 88) return 0;
+  uint8_t *out = dst;
+  *out++ = (pred >> 8) + 128;
+
+  const uint8_t *end = src + len;
+  for(src += 4; src < end; src++) {
+    uint8_t byte = *src;
+    for(uint8_t half=0; half<2; half++, byte >>= 4) {
+      uint8_t n    = byte & 0x0F;
+      int32_t step = stepTable[index];
+      int32_t diff = step >> 3;
+      if(n & 1) diff += step >> 2;
+      if(n & 2) diff += step >> 1;
+      if(n & 4) diff += step;
+      if(n & 8) {
+        if((pred -= diff) < -32768) pred = -32768;
+      } else {
+        if((pred += diff) >  32767) pred =  32767;
+      }
+      index += indexTable[n & 7];
+      if(index < 0)       index = 0;
+      else if(index > 88) index = 88;
+      *out++ = (pred >> 8) + 128;
+    }
+  }
+
+  uint32_t elapsed = DWT->CYCCNT - startTime;
+  adpcmBlocks++;
+  adpcmCycles += elapsed;
+  if(elapsed > adpcmCyclesMax) adpcmCyclesMax = elapsed;
+  return out - dst;
+}
+
+void adpcmStatsReset(void) {
+  adpcmBlocks = adpcmCycles = adpcmCyclesMax = 0;
+}
@@ -0,0 +1,204 @@
+// SPDX-FileCopyrightText: 2024 Monster Mask Open Claw Project
+//
+// SPDX-License-Identifier: MIT
+
+// Asset index: one walk of the filesystem (at startup, and again after
+// the USB host has changed things) records every file's size, first
+// sector (if stored contiguously) and, for BMPs, image dimensions. Path
+// lookups are then a hash probe rather than a FAT directory search, and
+// image loaders get dimensions without opening each BMP a second time.
+// Only a 32-bit hash and the length of each path are stored, not the path
+// itself, to keep this to 5K of RAM; a false match needs both to collide.
+
+#include "globals.h"
+#include <string.h>
+#include <ctype.h>
+
+extern Adafruit_Arcada   arcada;
+extern Adafruit_SPIFlash Arcada_QSPI_Flash; // Block device under the filesystem
+
+#define ASSET_SLOTS     256 // Must be power of 2, 4/3 of file count (eyes/ has 92)
+#define ASSET_PATH_MAX   64 // Longest path indexed, including NUL
+#define ASSET_MAX_DEPTH   3 // Subdirectory levels walked below root
+
+static assetInfo assetTable[ASSET_SLOTS];
+static uint16_t  assetCount    = 0;
+static bool      assetOverflow = false; // Some files not indexed
+
+// FNV-1a hash of path, case-insensitive (as FAT is), leading '/' ignored.
+// 0 marks an empty slot, so a (very unlikely) zero hash is bumped to 1.
+// The path's length (likewise) goes in len.
+static uint32_t assetHash(const char *path, size_t *len) {
+  uint32_t h = 2166136261UL;
+  if(*path == '/') path++;
+  const char *start = path;
+  for(; *path; path++) {
+    h ^= (uint8_t)tolower(*path);
+    h *= 16777619UL;
+  }
+  *len = path - start;
+  return h ? h : 1;
+}
+
+static void assetAdd(const char *path, File &file) {
+  if(assetCount >= (ASSET_SLOTS * 3 / 4)) { // Keep probe chains short
+    assetOverflow = true;
+    return;
+  }
+  size_t   pathLen; // Under ASSET_PATH_MAX, or assetWalk() wouldn't get here
+  uint32_t hash = assetHash(path, &pathLen);
+  uint16_t i    = hash & (ASSET_SLOTS - 1);
+  while(assetTable[i].hash) i = (i + 1) & (ASSET_SLOTS - 1);
+
+  assetInfo *a = &assetTable[i];
+  uint32_t   endSector;
+  a->hash    = hash;
+  a->pathLen = pathLen;
+  a->size   = file.fileSize();
+  if(!file.contiguousRange(&a->sector, &endSector)) a->sector = 0;
+  a->width  = a->height = 0;
+
+  int len = strlen(path);
+  if((len > 4) && !strcasecmp(&path[len - 4], ".bmp")) {
+    uint8_t header[26]; // Through the width & height fields
+    if((file.read(header, sizeof header) == sizeof header) &&
+       (header[0] == 'B') && (header[1] == 'M')) {
+      int32_t w, h;
+      memcpy(&w, &header[18], 4); // Little-endian like the M4
+      memcpy(&h, &header[22], 4);
+      a->width  = abs(w);
+      a->height = abs(h); // Negative = top-down BMP
+    }
+  }
+  assetCount++;
+}
+
+// Recursively index one directory. 'path' holds the directory's path
+// (with trailing '/', or empty for root), 'len' its length.
+static void assetWalk(File &dir, char *path, int len, uint8_t depth) {
+  File entry;
+  while(entry.openNext(&dir, O_RDONLY)) {
+    yield(); // Periodic yield() makes sure mass storage filesystem stays alive
+    if(!entry.getName(&path[len], ASSET_PATH_MAX - len)) {
+      assetOverflow = true; // Path too long to index
+    } else if(path[len] != '.') { // Skip hidden files (e.g. macOS "._" litter)
+      if(entry.isDir()) {
+        int dlen = strlen(path);
+        if((depth < ASSET_MAX_DEPTH) && (dlen < (ASSET_PATH_MAX - 2))) {
+          path[dlen++] = '/';
+          path[dlen]   = 0;
+          assetWalk(entry, path, dlen, depth + 1);
+        }
+      } else {
+        assetAdd(path, entry);
+      }
+    }
+    entry.close();
+  }
+  path[len] = 0;
+}
+
+void assetIndexBuild(void) {
+  char     path[ASSET_PATH_MAX] = "";
+  uint32_t startTime = millis();
+  memset(assetTable, 0, sizeof assetTable);
+  assetCount    = 0;
+  assetOverflow = false;
+  File root = arcada.open("/");
+  if(root) {
+    assetWalk(root, path, 0, 0);
+    root.close();
+  } else {
+    assetOverflow = true; // No index; every lookup falls back to FAT
+  }
+  Serial.printf("Asset index: %d files%s, %d ms\n", assetCount,
+    assetOverflow ? " (incomplete)" : "", (int)(millis() - startTime));
+}
+
+// Called when filesystem_change_flag is set: at startup, and after the
+// USB host has finished touching the drive.
+void handle_filesystem_change(void) {
+  blockCacheInvalidate();
+  assetIndexBuild();
+  filesystem_change_flag = false;
+}
+
+// Return index info for path, or NULL if not found.
+const assetInfo *assetFind(const char *path) {
+  if(!path) return NULL;
+  size_t   pathLen;
+  uint32_t hash = assetHash(path, &pathLen);
+  if(pathLen >= ASSET_PATH_MAX) return NULL; // Longer than any indexed
+  for(uint16_t i = hash & (ASSET_SLOTS - 1); assetTable[i].hash;
+      i = (i + 1) & (ASSET_SLOTS - 1)) {
+    if((assetTable[i].hash == hash) && (assetTable[i].pathLen == pathLen)) {
+      return &assetTable[i];
+    }
+  }
+  return NULL;
+}
+
+// arcada.exists() equivalent. A miss is only trusted if the index holds
+// every file; otherwise ask the filesystem.
+bool assetExists(const char *path) {
+  if(assetFind(path)) return true;
+  return assetOverflow ? arcada.exists(path) : false;
+}
+
+// Get BMP dimensions from the index, else from the file itself.
+ImageReturnCode assetDimensions(char *filename, int32_t *w, int32_t *h) {
+  const assetInfo *a = assetFind(filename);
+  if(a && a->width) {
+    *w = a->width;
+    *h = a->height;
+    return IMAGE_SUCCESS;
+  }
+  if(a || !assetOverflow) return IMAGE_ERR_FILE_NOT_FOUND; // Not a BMP, or absent
+  Adafruit_ImageReader *reader = arcada.getImageReader();
+  return reader ? reader->bmpDimensions(filename, w, h) : IMAGE_ERR_FILE_NOT_FOUND;
+}
+
+// Read from a contiguous file straight out of QSPI flash, bypassing
+// SdFat's cluster chain and its 512-byte sector cache: one flash read
+// per call, however large. Returns bytes read, 0 if the file isn't
+// contiguous or the index may be stale (USB host at work), in which
+// case the caller should use the regular file API.
+uint32_t assetRead(const assetInfo *a, uint32_t offset, void *dst, uint32_t len) {
+  if(!a || !a->sector || filesystem_change_flag || (offset >= a->size)) return 0;
+  if(len > (a->size - offset)) len = a->size - offset;
+  return Arcada_QSPI_Flash.readBuffer(a->sector * 512 + offset, (uint8_t *)dst, len);
+}
+
+// Serial LOADBENCH command: read a whole file through SdFat and through
+// the raw path above, report throughput of each.
+void assetBenchmark(const char *path) {
+  const uint32_t   chunk = 4096;
+  const assetInfo *a     = assetFind(path);
+  uint8_t         *buf;
+  if(!a) {
+    Serial.printf("LOADBENCH:NOTFOUND:%s\n", path);
+    return;
+  }
+  if(!(buf = (uint8_t *)malloc(chunk))) {
+    Serial.println("LOADBENCH:NOMEM");
+    return;
+  }
+  uint32_t t, fatUs = 0, rawUs = 0, total = 0;
+  File file = arcada.open(path, O_READ);
+  if(file) {
+    t = micros();
+    while(file.read(buf, chunk) > 0);
+    fatUs = micros() - t;
+    file.close();
+  }
+  if(a->sector) {
+    t = micros();
+    for(uint32_t pos = 0; pos < a->size; pos += chunk) total += assetRead(a, pos, buf, chunk);
+    rawUs = micros() - t;
+  }
+  free(buf);
+  Serial.printf("LOADBENCH:%s,bytes=%lu,contiguous=%s,fatKBps=%lu,rawKBps=%lu\n",
+    path, (unsigned long)a->size, a->sector ? "yes" : "no",
+    fatUs ? (unsigned long)((uint64_t)a->size * 1000 / 1024 * 1000 / fatUs) : 0UL,
+    (rawUs && (total == a->size)) ? (unsigned long)((uint64_t)a->size * 1000 / 1024 * 1000 / rawUs) : 0UL);
+}
@@ -0,0 +1,114 @@
+// SPDX-FileCopyrightText: 2024 Monster Mask Open Claw Project
+//
+// SPDX-License-Identifier: MIT
+
+// Small LRU sector cache between the FAT filesystem and the QSPI flash.
+// SdFat keeps only one sector cached itself, so loading a config and its
+// textures keeps re-reading the same directory, FAT and BMP header
+// sectors; a mood reload then does it all over again. This sits in as
+// the filesystem's block device and serves repeats from RAM.
+// Writes go through to flash (and update any cached copy). USB mass
+// storage talks to the flash directly, so the cache is dropped whenever
+// the host has been at the drive (see filesystem_change_flag).
+
+#include "globals.h"
+
+extern Adafruit_Arcada   arcada;
+extern Adafruit_SPIFlash Arcada_QSPI_Flash;   // Underlying block device
+extern FatFileSystem     Arcada_QSPI_FileSys; // Arcada's filesystem
+
+// Number of 512-byte sectors cached. Each costs 512 bytes of RAM, plus
+// a few for bookkeeping. Single-sector reads only are cached; big
+// multi-sector reads (bulk image data) pass straight through so they
+// don't evict the small, frequently-used sectors.
+#define BLOCK_CACHE_SECTORS 8
+
+uint32_t blockCacheHits   = 0;
+uint32_t blockCacheMisses = 0;
+
+class BlockCache : public FsBlockDeviceInterface {
+ public:
+  BlockCache(void) { invalidate(); }
+  bool isBusy(void) { return false; } // Flash reads are blocking
+  uint32_t sectorCount(void) { return Arcada_QSPI_Flash.sectorCount(); }
+  bool syncDevice(void) { return Arcada_QSPI_Flash.syncBlocks(); }
+
+  bool readSector(uint32_t sector, uint8_t *dst) {
+    if(filesystem_change_flag) { // Host may have changed flash under us
+      invalidate();
+      return Arcada_QSPI_Flash.readBlocks(sector, dst, 1);
+    }
+    int8_t i = find(sector);
+    if(i >= 0) {
+      blockCacheHits++;
+    } else {
+      blockCacheMisses++;
+      i = oldest();
+      tag[i] = NONE; // In case read fails
+      if(!Arcada_QSPI_Flash.readBlocks(sector, data[i], 1)) return false;
+      tag[i] = sector;
+    }
+    lastUse[i] = ++clock;
+    memcpy(dst, data[i], 512);
+    return true;
+  }
+
+  bool readSectors(uint32_t sector, uint8_t *dst, size_t ns) {
+    if(ns == 1) return readSector(sector, dst);
+    return Arcada_QSPI_Flash.readBlocks(sector, dst, ns);
+  }
+
+  bool writeSector(uint32_t sector, const uint8_t *src) {
+    return writeSectors(sector, src, 1);
+  }
+
+  bool writeSectors(uint32_t sector, const uint8_t *src, size_t ns) {
+    for(size_t n=0; n<ns; n++) { // Keep any cached copies current
+      int8_t i = find(sector + n);
+      if(i >= 0) memcpy(data[i], &src[n * 512], 512);
+    }
+    return Arcada_QSPI_Flash.writeBlocks(sector, src, ns);
+  }
+
+  void invalidate(void) {
+    for(uint8_t i=0; i<BLOCK_CACHE_SECTORS; i++) tag[i] = NONE;
+  }
+
+ private:
+  static const uint32_t NONE = 0xFFFFFFFF;
+  int8_t find(uint32_t sector) {
+    for(uint8_t i=0; i<BLOCK_CACHE_SECTORS; i++) {
+      if(tag[i] == sector) return i;
+    }
+    return -1;
+  }
+  int8_t oldest(void) { // Least recently used (or any empty) slot
+    uint8_t o = 0;
+    for(uint8_t i=0; i<BLOCK_CACHE_SECTORS; i++) {
+      if(tag[i] == NONE) return i;
+      if((int32_t)(lastUse[i] - lastUse[o]) < 0) o = i;
+    }
+    return o;
+  }
+  uint8_t  data[BLOCK_CACHE_SECTORS][512];
+  uint32_t tag[BLOCK_CACHE_SECTORS];
+  uint32_t lastUse[BLOCK_CACHE_SECTORS];
+  uint32_t clock = 0;
+};
+
+static BlockCache blockCache;
+
+// Re-mount Arcada's filesystem on top of the cache. Call once after
+// arcada.filesysBegin[MSD](). If that fails for some reason, mount it
+// back on the flash directly and carry on uncached.
+bool blockCacheBegin(void) {
+  blockCache.invalidate();
+  if(Arcada_QSPI_FileSys.begin(&blockCache)) return true;
+  Serial.println("Block cache mount failed, continuing without");
+  Arcada_QSPI_FileSys.begin(&Arcada_QSPI_Flash);
+  return false;
+}
+
+void blockCacheInvalidate(void) {
+  blockCache.invalidate();
+}
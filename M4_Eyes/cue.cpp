@@ -0,0 +1,341 @@
+// SPDX-FileCopyrightText: 2024 Monster Mask Open Claw Project
+//
+// SPDX-License-Identifier: MIT
+
+// Cue list show control. A text cue file is parsed once, at load, into an
+// array of small binary cues sorted by time; during the show cueFrame(),
+// called at the start of each frame, just compares the show clock with the
+// next cue's time, so a frame costs the same whether the list holds ten
+// cues or a thousand. A cue fires in the frame whose start is nearest its
+// time (up to half a frame early), so it lands within a frame of the mark.
+//
+// The show clock is one of:
+//   internal  milliseconds since CUE:go
+//   audio     the position of the audio file playing, from the playback
+//             interrupt's sample count (audioSamples / audioSampleRate),
+//             so cues follow the soundtrack even if frames stall. Holds
+//             while nothing plays; a new file restarts it from zero.
+//   external  positions sent with CUE:time:<ms> (e.g. from a show
+//             controller's timecode), run on between updates
+// A clock stepping back more than CUE_REWIND_MS re-arms the cues after
+// the new position; smaller steps back are ignored.
+//
+// Cue file: one cue per line, '#' starts a comment.
+//   clock internal|audio|external  Show clock (default internal)
+//   <time> blink [ms]              Blink both eyes (closing time, default 50)
+//   <time> look <x> <y>            Hold gaze here, -1.0 to 1.0 as eyeTargetX/Y
+//   <time> look auto               Back to the config's eye movement
+//   <time> pupil <0.0-1.0>         Snap pupil to this point in its range
+//   <time> pupil auto              Back to light sensor/autonomous pupil
+//   <time> mood <config path>      Switch eye config without a reboot
+// <time> is seconds, or minutes:seconds, e.g. "83.5" or "1:23.5". Cues at
+// the same time fire in file order. Look and pupil cues hold until
+// changed or CUE:off.
+
+#include "globals.h"
+#include <string.h>
+
+#define CUE_MAX         1000 // Lines per cue file
+#define CUE_POOL_MAX    1024 // Bytes of mood paths per file
+#define CUE_REWIND_MS    100 // Clock steps back further than this re-arm cues
+#define CUE_BLINK_MS      50 // Default blink closing time
+
+enum { CUE_BLINK, CUE_LOOK, CUE_LOOK_AUTO, CUE_PUPIL, CUE_PUPIL_AUTO, CUE_MOOD };
+
+typedef struct {
+  uint32_t ms;     // Show time
+  uint8_t  action; // CUE_* above
+  int16_t  a, b;   // blink: ms; look: x, y (1/10000); pupil: 1/10000;
+} cueRecord;       // mood: offset of path in pool
+
+static cueRecord *cues     = NULL;
+static char      *pool     = NULL; // Mood paths, NUL-terminated
+static uint16_t   numCues  = 0;
+static uint16_t   next     = 0;    // Index of next cue to fire
+static uint32_t   startMs;         // Internal clock: millis() at CUE:go
+static uint32_t   extMs, extAt;    // External clock: last position, millis() then
+static bool       extSet;          // External clock: a position has been sent
+static uint32_t   clockMs;         // Show clock at the last frame
+static uint32_t   lastFrameUs;
+static uint32_t   frameUs  = 0;    // Average frame time, for the half-frame lead
+uint8_t           cueMode  = CUE_OFF;
+uint8_t           cueClock = CUE_CLOCK_INTERNAL;
+uint16_t          cueErrorLine;    // Line of the last load error (0 = file/RAM)
+uint32_t          cueFired = 0;
+int32_t           cueMaxLateMs = 0; // Furthest from its mark a cue has fired
+
+// Loading ------------------------------------------------------------------
+
+// Parse "<seconds>" or "<minutes>:<seconds>" to ms. False if not a time.
+static bool parseTime(const char *s, uint32_t *ms) {
+  char  *end;
+  float  v = strtod(s, &end);
+  if((end == s) || (v < 0.0)) return false;
+  if(*end == ':') {
+    const char *sec = end + 1;
+    float       f   = strtod(sec, &end);
+    if((end == sec) || (f < 0.0)) return false;
+    v = v * 60.0 + f;
+  }
+  if(*end) return false;
+  *ms = (uint32_t)(v * 1000.0 + 0.5);
+  return true;
+}
+
+static bool parseUnit(const char *s, float lo, int16_t *v) {
+  char  *end;
+  float  f = strtod(s, &end);
+  if((end == s) || *end || (f < lo) || (f > 1.0)) return false;
+  *v = (int16_t)(f * 10000.0 + (f < 0.0 ? -0.5 : 0.5));
+  return true;
+}
+
+// Parse one line into cues[numCues]. False on a syntax error.
+static bool parseLine(char *line, uint16_t maxCues, uint16_t *poolUsed) {
+  char *hash = strchr(line, '#');
+  if(hash) *hash = 0;
+  char *word[4], *save;
+  uint8_t n = 0;
+  for(char *w = strtok_r(line, " \t\r\n", &save); w && (n < 4); w = strtok_r(NULL, " \t\r\n", &save)) {
+    word[n++] = w;
+  }
+  if(!n) return true; // Blank or comment
+  if(!strcasecmp(word[0], "clock")) {
+    if(n != 2) return false;
+    if(!strcasecmp(word[1], "internal"))      cueClock = CUE_CLOCK_INTERNAL;
+    else if(!strcasecmp(word[1], "audio"))    cueClock = CUE_CLOCK_AUDIO;
+    else if(!strcasecmp(word[1], "external")) cueClock = CUE_CLOCK_EXTERNAL;
+    else return false;
+    return true;
+  }
+  if((n < 2) || (numCues >= maxCues)) return false;
+  cueRecord *c = &cues[numCues];
+  if(!parseTime(word[0], &c->ms)) return false;
+  c->a = c->b = 0;
+  if(!strcasecmp(word[1], "blink")) {
+    c->action = CUE_BLINK;
+    c->a      = CUE_BLINK_MS;
+    if(n > 3) return false;
+    if(n == 3) {
+      long ms = strtol(word[2], &save, 10);
+      if(*save || (ms < 1) || (ms > 1000)) return false;
+      c->a = ms;
+    }
+  } else if(!strcasecmp(word[1], "look")) {
+    if((n == 3) && !strcasecmp(word[2], "auto")) {
+      c->action = CUE_LOOK_AUTO;
+    } else {
+      c->action = CUE_LOOK;
+      if((n != 4) || !parseUnit(word[2], -1.0, &c->a) || !parseUnit(word[3], -1.0, &c->b)) return false;
+    }
+  } else if(!strcasecmp(word[1], "pupil")) {
+    if(n != 3) return false;
+    if(!strcasecmp(word[2], "auto")) {
+      c->action = CUE_PUPIL_AUTO;
+    } else {
+      c->action = CUE_PUPIL;
+      if(!parseUnit(word[2], 0.0, &c->a)) return false;
+    }
+  } else if(!strcasecmp(word[1], "mood")) {
+    uint16_t len = (n == 3) ? strlen(word[2]) + 1 : 0;
+    if(!len || (len > sizeof reloadConfigPath) || ((*poolUsed + len) > CUE_POOL_MAX)) return false;
+    c->action = CUE_MOOD;
+    c->a      = *poolUsed;
+    memcpy(&pool[*poolUsed], word[2], len);
+    *poolUsed += len;
+  } else {
+    return false;
+  }
+  // Keep the list sorted as it's built. Files are normally in time order,
+  // so this rarely moves anything; equal times stay in file order.
+  cueRecord add = *c;
+  uint16_t  i   = numCues++;
+  for(; i && (cues[i - 1].ms > add.ms); i--) cues[i] = cues[i - 1];
+  cues[i] = add;
+  return true;
+}
+
+// Parse a cue file, replacing any list already loaded (and stopping it).
+// Returns the number of cues, or -1 with cueErrorLine set.
+int16_t cueLoad(const char *filename) {
+  cueStop();
+  free(cues);
+  free(pool);
+  cues         = NULL;
+  pool         = NULL;
+  numCues      = 0;
+  cueClock     = CUE_CLOCK_INTERNAL;
+  cueErrorLine = 0;
+  File file    = arcada.open(filename, O_READ);
+  if(!file) return -1;
+  // Lines are an upper bound on cues, so count them first rather than
+  // holding RAM for the most a file could have
+  uint32_t lines = 1;
+  for(int c; (c = file.read()) >= 0; ) lines += (c == '\n');
+  if(lines > CUE_MAX) lines = CUE_MAX;
+  file.seekSet(0);
+  cues = (cueRecord *)malloc(lines * sizeof(cueRecord));
+  pool = (char *)malloc(CUE_POOL_MAX);
+  if(!cues || !pool) {
+    file.close();
+    free(cues);
+    free(pool);
+    cues = NULL;
+    pool = NULL;
+    return -1;
+  }
+  char     line[96];
+  uint16_t len = 0, lineNum = 0, poolUsed = 0;
+  bool     ok  = true;
+  for(;;) {
+    int c = file.read();
+    if((c >= 0) && (c != '\n')) {
+      if(len < (sizeof line - 1)) line[len++] = c;
+      else                        ok = false; // Too long, reported at its end
+      continue;
+    }
+    if((c < 0) && !len) break; // End of file
+    line[len] = 0;
+    len       = 0;
+    lineNum++;
+    if(!ok || !parseLine(line, lines, &poolUsed)) {
+      ok = false;
+      break;
+    }
+    if(c < 0) break;
+  }
+  file.close();
+  if(!ok) {
+    cueErrorLine = lineNum;
+    numCues      = 0;
+    return -1;
+  }
+  // Give back what the file didn't need
+  if(numCues) cues = (cueRecord *)realloc(cues, numCues * sizeof(cueRecord));
+  if(poolUsed) {
+    pool = (char *)realloc(pool, poolUsed);
+  } else {
+    free(pool);
+    pool = NULL;
+  }
+  return numCues;
+}
+
+// Running ------------------------------------------------------------------
+
+// Current show clock, ms
+static uint32_t showClock(void) {
+  uint32_t now = millis();
+  switch(cueClock) {
+   case CUE_CLOCK_AUDIO:
+    if(!audioSampleRate) return clockMs; // Nothing playing, hold
+    return (uint32_t)((uint64_t)audioSamples * 1000 / audioSampleRate);
+   case CUE_CLOCK_EXTERNAL:
+    return extSet ? extMs + (now - extAt) : 0;
+   default:
+    return now - startMs;
+  }
+}
+
+// First cue at or after 'ms', by binary search
+static uint16_t cueAt(uint32_t ms) {
+  uint16_t lo = 0, hi = numCues;
+  while(lo < hi) {
+    uint16_t mid = (lo + hi) / 2;
+    if(cues[mid].ms < ms) lo = mid + 1;
+    else                  hi = mid;
+  }
+  return lo;
+}
+
+static void fire(const cueRecord *c, uint32_t t) {
+  switch(c->action) {
+   case CUE_BLINK:
+    for(uint8_t e=0; e<NUM_EYES; e++) {
+      eye[e].blink.state     = ENBLINK;
+      eye[e].blink.startTime = t;
+      eye[e].blink.duration  = c->a * 1000;
+    }
+    break;
+   case CUE_LOOK:
+    holdGaze(HOLD_CUE); // Gaze goes through pursuit.cpp as usual,
+    eyeTargetX = c->a / 10000.0; // which saccades to a distant target
+    eyeTargetY = c->b / 10000.0;
+    break;
+   case CUE_LOOK_AUTO:
+    releaseGaze(HOLD_CUE); // MIDI keeps gaze if it has it too
+    break;
+   case CUE_PUPIL:
+    holdPupil(HOLD_CUE, irisMin + irisRange * c->a / 10000.0);
+    break;
+   case CUE_PUPIL_AUTO:
+    releasePupil(HOLD_CUE);
+    break;
+   case CUE_MOOD:
+    // Takes effect at the end of this frame (see renderStep())
+    strcpy(reloadConfigPath, &pool[c->a]);
+    reloadRequested = true;
+    break;
+  }
+}
+
+// Call at the start of each eyeball's frame, before its gaze and pupil
+// are worked out, with the current time (micros()).
+void cueFrame(uint8_t eyeNum, uint32_t t) {
+  if((cueMode != CUE_RUN) || eyeNum) return;
+  if(lastFrameUs) frameUs = (frameUs * 7 + (t - lastFrameUs)) / 8;
+  lastFrameUs = t;
+
+  uint32_t now = showClock();
+  if((int32_t)(clockMs - now) > CUE_REWIND_MS) next = cueAt(now); // Went back
+  else if((int32_t)(now - clockMs) < 0)        now  = clockMs;    // Jitter
+  clockMs = now;
+
+  uint32_t lead  = frameUs / 2000; // Half a frame, ms
+  bool     fired = false;
+  while((next < numCues) && ((int32_t)(cues[next].ms - now) <= (int32_t)lead)) {
+    int32_t late = now - cues[next].ms;
+    if(abs(late) > abs(cueMaxLateMs)) cueMaxLateMs = late;
+    logMsg(LOG_CUE, next, cues[next].ms, late);
+    fire(&cues[next++], t);
+    cueFired++;
+    fired = true;
+  }
+  if(fired && (next >= numCues)) logMsg(LOG_CUE_DONE, cueFired, cueMaxLateMs);
+}
+
+// Start the loaded list from the top. False if nothing is loaded.
+bool cueGo(void) {
+  if(!numCues) return false;
+  cueStop();
+  startMs      = millis();
+  clockMs      = 0;
+  next         = 0;
+  lastFrameUs  = 0;
+  cueFired     = 0;
+  cueMaxLateMs = 0;
+  if(cueClock == CUE_CLOCK_AUDIO) {
+    clockMs = showClock();
+    next    = cueAt(clockMs); // Audio already under way: join it there
+  }
+  cueMode = CUE_RUN;
+  return true;
+}
+
+// External clock position (ms), e.g. from CUE:time
+void cueTime(uint32_t ms) {
+  extMs  = ms;
+  extAt  = millis();
+  extSet = true;
+}
+
+// Stop and hand gaze and pupil back
+void cueStop(void) {
+  releaseGaze(HOLD_CUE);
+  releasePupil(HOLD_CUE);
+  cueMode = CUE_OFF;
+}
+
+uint16_t cueCount(void) { return numCues; }
+uint16_t cueNext(void) { return next; }
+uint32_t cueClockMs(void) { return clockMs; }
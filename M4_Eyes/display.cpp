@@ -0,0 +1,97 @@
+// SPDX-FileCopyrightText: 2024 Monster Mask Open Claw Project
+//
+// SPDX-License-Identifier: MIT
+
+// Fast address-window setup for the eye displays. setAddrWindow() goes
+// through several layers of Adafruit_SPITFT calls and a byte-at-a-time
+// SPI.transfer() that waits on each received byte, and the old frame
+// start also closed and reopened the SPI transaction every frame. Since
+// each eye has its own SPI bus, the transaction (and chip select) now
+// stays open from frame to frame, and the CASET/RASET/RAMWR bytes are
+// built once per rotation and written straight to the SERCOM DATA
+// register, with DC driven through the PORT set/clear registers.
+// These few bytes aren't worth a DMA job: DC has to change between each
+// command and its parameters, so the CPU would be waiting on it anyway.
+
+#include "globals.h"
+#include <stddef.h> // offsetof()
+
+extern SPISettings settings; // Defined in M4_Eyes.ino
+
+// _xstart and _ystart (panel RAM offset for the current rotation) are
+// protected members of Adafruit_ST77xx; a subclass can read them.
+// Never instantiated, only used to view an existing display object.
+class ST77xxBuddy : public Adafruit_ST77xx {
+ public:
+  int16_t xStart(void) { return _xstart; }
+  int16_t yStart(void) { return _ystart; }
+};
+
+// Call after display->setRotation(), as the window origin depends on it.
+void displayFastSetup(eyeStruct *e) {
+  ST77xxBuddy *tft = (ST77xxBuddy *)e->display;
+  uint16_t     x0  = (e->display->width()  - DISPLAY_SIZE) / 2 + tft->xStart();
+  uint16_t     x1  = x0 + DISPLAY_SIZE - 1;
+
+  // SPIClass doesn't expose its SERCOM, but does expose the address of
+  // its DATA register, from which the SERCOM base follows.
+  e->sercom = (Sercom *)((uint8_t *)e->spi->getDataRegister() - offsetof(SercomSpi, DATA));
+  e->csPort = digitalPinToPort(e->cs);
+  e->csMask = digitalPinToBitMask(e->cs);
+  e->dcPort = digitalPinToPort(e->dc);
+  e->dcMask = digitalPinToBitMask(e->dc);
+  e->winY   = (e->display->height() - DISPLAY_SIZE) / 2 + tft->yStart();
+
+  e->addrWindow[0]  = ST77XX_CASET;
+  e->addrWindow[1]  = x0 >> 8;
+  e->addrWindow[2]  = x0;
+  e->addrWindow[3]  = x1 >> 8;
+  e->addrWindow[4]  = x1;
+  e->addrWindow[5]  = ST77XX_RASET; // 6-9 filled in by displayWindow()
+  e->addrWindow[10] = ST77XX_RAMWR;
+}
+
+// Start the SPI transaction and select the display, if not already.
+void displaySelect(eyeStruct *e) {
+  if(!e->spiActive) {
+    e->spi->beginTransaction(settings);
+    e->csPort->OUTCLR.reg = e->csMask; // Chip select
+    e->spiActive = true;
+  }
+}
+
+// End the SPI transaction, e.g. before other code uses the display.
+void displayRelease(eyeStruct *e) {
+  e->csPort->OUTSET.reg = e->csMask; // Deselect
+  e->spi->endTransaction();
+  e->spiActive = false;
+}
+
+// Set the address window to 'rows' rows (rotated coordinates) starting
+// 'row' rows into the eye's DISPLAY_SIZE square, leaving DC high (data
+// mode) for the pixel DMA to follow. Waits on TXC rather than DRE before
+// each DC change so the last bit of the prior byte (or prior column's
+// DMA) is clear of the shift register first.
+void displayWindow(eyeStruct *e, uint8_t row, uint16_t rows) {
+  SercomSpi *spi = &e->sercom->SPI;
+  uint8_t   *w   = e->addrWindow;
+  uint16_t   y0  = e->winY + row, y1 = y0 + rows - 1;
+  w[6] = y0 >> 8;
+  w[7] = y0;
+  w[8] = y1 >> 8;
+  w[9] = y1;
+
+  for(uint8_t cmd=0; cmd<3; cmd++) { // CASET, RASET, RAMWR
+    while(!spi->INTFLAG.bit.TXC);
+    e->dcPort->OUTCLR.reg = e->dcMask; // Command mode
+    spi->DATA.reg = *w++;
+    while(!spi->INTFLAG.bit.TXC);
+    e->dcPort->OUTSET.reg = e->dcMask; // Data mode
+    if(cmd < 2) {
+      for(uint8_t i=0; i<4; i++) {
+        while(!spi->INTFLAG.bit.DRE);
+        spi->DATA.reg = *w++;
+      }
+    }
+  }
+}
@@ -86,7 +86,7 @@ void loadConfig(char *filename) {
   uint8_t rotation = 3;
 
   if(file = arcada.open(filename, FILE_READ)) {
-    StaticJsonDocument<2048> doc;
+    StaticJsonDocument<3072> doc; // Room for a voiceFX list
 
     yield();
     DeserializationError error = deserializeJson(doc, file);
@@ -105,6 +105,26 @@ void loadConfig(char *filename) {
       slitPupilRadius = dwim(doc["slitPupilRadius"]);
       gazeMax         = dwim(doc["gazeMax"], gazeMax);
       JsonVariant v;
+      v = doc["irisBreathe"];       // Iris size oscillation, e.g. 0.1 = +/-10%
+      if(v.is<float>()) irisBreathe = fabs(v.as<float>());
+      v = doc["irisBreathePeriod"]; // Seconds per cycle
+      if(v.is<float>()) irisBreathePeriod = fabs(v.as<float>());
+      v = doc["foveate"]; // Reduced detail at eyeball rim, default on
+      if(v.is<bool>() || v.is<int>()) foveate = v;
+      v = doc["interlace"]; // Half-column fields during big saccades, default on
+      if(v.is<bool>() || v.is<int>()) interlace = v;
+      v = doc["pursuit"]; // Filtered, predictive gaze when user code aims the eyes
+      if(v.is<bool>() || v.is<int>()) pursuit = v;
+      v = doc["pursuitAlpha"];
+      if(v.is<float>()) pursuitAlpha = constrain(v.as<float>(), 0.0, 1.0);
+      v = doc["pursuitBeta"];
+      if(v.is<float>()) pursuitBeta = constrain(v.as<float>(), 0.0, 1.0);
+      v = doc["pursuitLatency"]; // Milliseconds
+      if(v.is<float>()) pursuitLatency = fabs(v.as<float>());
+      v = doc["pursuitSaccade"];
+      if(v.is<float>()) pursuitSaccade = fabs(v.as<float>());
+      v = doc["logLevel"]; // 0 = debug, 1 = info, 2 = warnings, 3 = errors
+      if(v.is<int>()) logLevel = v.as<int>();
       v = doc["coverage"];
       if(v.is<int>() || v.is<float>()) coverage = v.as<float>();
       v = doc["upperEyelid"];
@@ -160,11 +180,13 @@ void loadConfig(char *filename) {
                   irisMirror   = 0,
                   scleraMirror = 0,
                   irisAngle    = 0,
-                  scleraAngle  = 0,
-                  irisiSpin    = 0,
+                  scleraAngle  = 0;
+      int32_t     irisiSpin    = 0,  // 22.10 fixed point
                   scleraiSpin  = 0;
       float       irisSpin     = 0.0,
                   scleraSpin   = 0.0;
+      bool        irisFilter   = false,
+                  scleraFilter = false;
       JsonVariant iristv       = doc["irisTexture"],
                   scleratv     = doc["scleraTexture"];
 
@@ -185,10 +207,17 @@ void loadConfig(char *filename) {
       if(v.is<float>()) irisSpin   = v.as<float>() * -1024.0;
       v = doc["scleraSpin"];
       if(v.is<float>()) scleraSpin = v.as<float>() * -1024.0;
+      // Per-frame spin may be fractional (e.g. 0.25 = one unit every 4 frames)
       v = doc["irisiSpin"];
-      if(v.is<int>()) irisiSpin    = v.as<int>();
+      if(v.is<float>()) irisiSpin   = (int32_t)(v.as<float>() * 1024.0);
       v = doc["scleraiSpin"];
-      if(v.is<int>()) scleraiSpin  = v.as<int>();
+      if(v.is<float>()) scleraiSpin = (int32_t)(v.as<float>() * 1024.0);
+      // Bilinear texture filtering costs extra cycles per pixel, so it's
+      // off unless requested; mostly worthwhile on large, low-res irises.
+      v = doc["irisFilter"];
+      if(v.is<bool>() || v.is<int>()) irisFilter   = v;
+      v = doc["scleraFilter"];
+      if(v.is<bool>() || v.is<int>()) scleraFilter = v;
       v = doc["irisMirror"];
       if(v.is<bool>() || v.is<int>()) irisMirror   = v ? 1023 : 0;
       v = doc["scleraMirror"];
@@ -217,6 +246,8 @@ void loadConfig(char *filename) {
         eye[e].sclera.spin   = scleraSpin;
         eye[e].iris.iSpin    = irisiSpin;
         eye[e].sclera.iSpin  = scleraiSpin;
+        eye[e].iris.filter   = irisFilter;
+        eye[e].sclera.filter = scleraFilter;
         // iris and sclera filenames are strdup'd for each eye rather than
         // sharing a common pointer, reason being that it gets really messy
         // below when overriding one or the other and trying to do the right
@@ -229,10 +260,14 @@ void loadConfig(char *filename) {
 
 #if NUM_EYES > 1
       // Process any distinct per-eye settings...
-      // NOT EVERYTHING IS CONFIGURABLE PER-EYE. Color and texture stuff, yes.
-      // Other things like iris size or pupil shape are not, reason being that
-      // there isn't enough RAM for the polar angle/dist tables for two eyes.
+      // NOT EVERYTHING IS CONFIGURABLE PER-EYE. Color, texture and iris size
+      // stuff, yes. Other things like eye size or pupil shape are not, reason
+      // being that there isn't enough RAM for the polar angle/dist tables for
+      // two eyes. (Iris size works per-eye because it's applied through a
+      // small LUT rather than the tables; see calcDistLUT().)
       for(uint8_t e=0; e<NUM_EYES; e++) {
+        v = doc[eye[e].name]["irisRadius"];
+        if(v.is<float>()) eye[e].irisRadius = fabs(v.as<float>());
         eye[e].pupilColor    = dwim(doc[eye[e].name]["pupilColor"]  , eye[e].pupilColor);
         eye[e].backColor     = dwim(doc[eye[e].name]["backColor"]   , eye[e].backColor);
         eye[e].iris.color    = dwim(doc[eye[e].name]["irisColor"]   , eye[e].iris.color);
@@ -250,9 +285,13 @@ void loadConfig(char *filename) {
         v = doc[eye[e].name]["scleraSpin"];
         if(v.is<float>()) eye[e].sclera.spin = v.as<float>() * -1024.0;
         v = doc[eye[e].name]["irisiSpin"];
-        if(v.is<int>()) eye[e].iris.iSpin   = v.as<int>();
+        if(v.is<float>()) eye[e].iris.iSpin   = (int32_t)(v.as<float>() * 1024.0);
         v = doc[eye[e].name]["scleraiSpin"];
-        if(v.is<int>()) eye[e].sclera.iSpin = v.as<int>();
+        if(v.is<float>()) eye[e].sclera.iSpin = (int32_t)(v.as<float>() * 1024.0);
+        v = doc[eye[e].name]["irisFilter"];
+        if(v.is<bool>() || v.is<int>()) eye[e].iris.filter   = v;
+        v = doc[eye[e].name]["scleraFilter"];
+        if(v.is<bool>() || v.is<int>()) eye[e].sclera.filter = v;
         v = doc[eye[e].name]["irisMirror"];
         if(v.is<bool>() || v.is<int>()) eye[e].iris.mirror   = v ? 1023 : 0;
         v = doc[eye[e].name]["scleraMirror"];
@@ -271,6 +310,11 @@ void loadConfig(char *filename) {
         eye[e].rotation &= 3;
       }
 #endif
+      // Fixed-point rotation starts from the (possibly per-eye) start angle
+      for(e=0; e<NUM_EYES; e++) {
+        eye[e].iris.fineAngle   = (uint32_t)eye[e].iris.startAngle   << 10;
+        eye[e].sclera.fineAngle = (uint32_t)eye[e].sclera.startAngle << 10;
+      }
 #if defined(ADAFRUIT_MONSTER_M4SK_EXPRESS)
       v = doc["voice"];
       if(v.is<bool>()) voiceOn = v.as<bool>();
@@ -285,6 +329,45 @@ void loadConfig(char *filename) {
         else if(!strncasecmp(v, "sa", 2)) waveform = 4;
         else                              waveform = 0;
       }
+      v = doc["agcTarget"]; // Fraction of full scale, e.g. 0.4
+      if(v.is<float>()) agcTarget = fabs(v.as<float>());
+      v = doc["agcMaxGain"];
+      if(v.is<float>()) agcMaxGain = fabs(v.as<float>());
+      v = doc["agcAttack"];
+      if(v.is<float>()) agcAttack = fabs(v.as<float>());
+      v = doc["agcRelease"];
+      if(v.is<float>()) agcRelease = fabs(v.as<float>());
+      v = doc["noiseGate"]; // Fraction of full scale, e.g. 0.01
+      if(v.is<float>()) noiseGate = fabs(v.as<float>());
+      v = doc["voiceFX"]; // Effect chain, in order (voicefx.cpp)
+      if(v.is<JsonArray>()) {
+        numVoiceFX = 0;
+        for(uint8_t i=0; i<v.size(); i++) {
+          const char *name = v[i]["type"] | "";
+          int8_t      type = fxType(name);
+          if(type < 0) {
+            Serial.printf("Unknown voice effect '%s', skipped\n", name);
+          } else if(numVoiceFX >= FX_MAX) {
+            Serial.printf("More than %d voice effects, chain refused\n", FX_MAX);
+            numVoiceFX = 0;
+            break;
+          } else {
+            fxSpec *fx   = &voiceFX[numVoiceFX++];
+            fx->type     = type;
+            fx->freq     = v[i]["freq"]     | -1.0;
+            fx->mix      = v[i]["mix"]      | -1.0;
+            fx->bits     = v[i]["bits"]     | -1.0;
+            fx->ms       = v[i]["ms"]       | -1.0;
+            fx->feedback = v[i]["feedback"] | -1.0;
+            fx->drive    = v[i]["drive"]    | -1.0;
+          }
+        }
+      }
+      v = doc["jawLookahead"]; // Milliseconds, jaw servo ahead of audio
+      // (user_fizzgig.cpp cuts this to what its delay line holds at the WAV's rate)
+      if(v.is<int>()) jawLookahead = constrain(v.as<int>(), 0, 1000);
+      v = doc["jawGain"];
+      if(v.is<float>()) jawGain = fabs(v.as<float>());
 #endif // ADAFRUIT_MONSTER_M4SK_EXPRESS
     }
     file.close();
@@ -312,6 +395,9 @@ void loadConfig(char *filename) {
   else            irisRadius = abs(irisRadius);
   slitPupilRadius = abs(slitPupilRadius);
   if(slitPupilRadius > irisRadius) slitPupilRadius = irisRadius;
+  for(uint8_t e=0; e<NUM_EYES; e++) { // Per-eye iris size defaults to global
+    if(eye[e].irisRadius <= 0.0) eye[e].irisRadius = irisRadius;
+  }
 
   if(coverage < 0.0)      coverage = 0.0;
   else if(coverage > 1.0) coverage = 1.0;
@@ -343,7 +429,7 @@ ImageReturnCode loadEyelid(char *filename,
 
   // This is the "booster seat" described in m4eyes.ino
   yield();
-  if(reader->bmpDimensions(filename, &w, &h) == IMAGE_SUCCESS) {
+  if(assetDimensions(filename, &w, &h) == IMAGE_SUCCESS) { // From asset index
     tempBytes = ((w + 7) / 8) * h; // Bitmap size in bytes
     if (maxRam > tempBytes) {
       if((tempPtr = (uint8_t *)malloc(maxRam - tempBytes)) != NULL) {
@@ -381,6 +467,7 @@ ImageReturnCode loadEyelid(char *filename,
       int         bytesPerLine = (image.width() + 7) / 8;
       for(x=sx1; x <= sx2; x++, ix++) { // For each column...
         yield();
+        if(audioService) audioService();
         // Get initial pointer into image buffer
         uint8_t *ptr  = &buffer[iy * bytesPerLine + ix / 8];
         uint8_t  mask = 0x80 >> (ix & 7); // Column mask
@@ -412,6 +499,143 @@ ImageReturnCode loadEyelid(char *filename,
   return status;
 }
 
+// TEXTURE FLASH -----------------------------------------------------------
+
+// Arcada's writeDataToFlash() only ever appends, so textures a mood
+// reload stops using would strand their flash until reboot. All texture
+// writes come through textureFlashWrite(), which notes the span of flash
+// they occupy. textureFlashReclaim() rewinds to the start of that span,
+// which also takes in whatever flash Arcada has left; writes from then on
+// erase and reprogram it directly (as Arcada does internally) and never
+// append again. The caller must make sure nothing still points at the old
+// textures.
+
+#define TEX_FLASH_PAGE   512 // NVM page, the programming unit
+#define TEX_FLASH_BLOCK 8192 // NVM block, the erase unit
+
+static uint8_t *texFlashStart = NULL; // Span of flash holding textures
+static uint8_t *texFlashEnd   = NULL;
+static uint8_t *texFlashNext  = NULL; // Rewrite position, NULL = append
+
+#define TEX_FLASH_ROUND(p) \
+  ((uint8_t *)(((uintptr_t)(p) + TEX_FLASH_BLOCK - 1) & ~(uintptr_t)(TEX_FLASH_BLOCK - 1)))
+
+static void flashCommand(uint16_t cmd) {
+  while(!NVMCTRL->STATUS.bit.READY);
+  NVMCTRL->CTRLB.reg = NVMCTRL_CTRLB_CMDEX_KEY | cmd;
+  while(!NVMCTRL->STATUS.bit.READY);
+}
+
+// Program len bytes at block-aligned dst, erasing blocks as it enters them
+static void flashRewrite(uint8_t *dst, const uint8_t *src, uint32_t len) {
+  bool cache0 = NVMCTRL->CTRLA.bit.CACHEDIS0,
+       cache1 = NVMCTRL->CTRLA.bit.CACHEDIS1;
+  NVMCTRL->CTRLA.bit.CACHEDIS0 = 1; // Keep stale lines out of the NVM cache
+  NVMCTRL->CTRLA.bit.CACHEDIS1 = 1;
+  NVMCTRL->CTRLA.bit.WMODE     = NVMCTRL_CTRLA_WMODE_MAN_Val;
+  for(uint32_t offset=0; offset<len; offset += TEX_FLASH_PAGE) {
+    if(!(offset & (TEX_FLASH_BLOCK - 1))) {
+      NVMCTRL->ADDR.reg = (uintptr_t)&dst[offset];
+      flashCommand(NVMCTRL_CTRLB_CMD_EB);
+    }
+    flashCommand(NVMCTRL_CTRLB_CMD_PBC);
+    // Page buffer takes 32-bit writes only; pad a short tail with 0xFF
+    volatile uint32_t *out = (volatile uint32_t *)&dst[offset];
+    uint32_t n = min(len - offset, (uint32_t)TEX_FLASH_PAGE);
+    for(uint32_t i=0; i<n; i += 4) {
+      uint32_t word = 0xFFFFFFFF;
+      memcpy(&word, &src[offset + i], min(n - i, (uint32_t)4));
+      *out++ = word;
+    }
+    flashCommand(NVMCTRL_CTRLB_CMD_WP);
+  }
+  NVMCTRL->CTRLA.bit.CACHEDIS0 = cache0;
+  NVMCTRL->CTRLA.bit.CACHEDIS1 = cache1;
+  bool cmcc = CMCC->SR.bit.CSTS; // Invalidate the core's cache too
+  CMCC->CTRL.bit.CEN = 0;
+  while(CMCC->SR.bit.CSTS);
+  CMCC->MAINT0.bit.INVALL = 1;
+  CMCC->CTRL.bit.CEN = cmcc;
+}
+
+static uint8_t *textureFlashWrite(uint8_t *src, uint32_t len) {
+  uint8_t *p;
+  if(texFlashNext) { // Reclaimed, the span is all there is
+    if(texFlashNext + len > texFlashEnd) return NULL;
+    flashRewrite(p = texFlashNext, src, len);
+    texFlashNext = TEX_FLASH_ROUND(texFlashNext + len);
+  } else if((p = arcada.writeDataToFlash(src, len))) {
+    if(!texFlashStart || (p < texFlashStart)) texFlashStart = p;
+    if(p + len > texFlashEnd)                 texFlashEnd   = p + len;
+  }
+  return p;
+}
+
+void textureFlashReclaim(void) {
+  if(!texFlashStart) return;
+  if(!texFlashNext) { // First time, take over Arcada's unused flash too.
+    // Its writes each start a fresh block, so that begins at the next one.
+    texFlashEnd = TEX_FLASH_ROUND(texFlashEnd) +
+      (arcada.availableFlash() & ~(TEX_FLASH_BLOCK - 1));
+  }
+  texFlashNext = TEX_FLASH_ROUND(texFlashStart);
+}
+
+// Fast path for textures stored contiguously as uncompressed 24-bit BMPs
+// (most of them): rows are read straight from QSPI flash with assetRead()
+// and converted to big-endian 565, skipping SdFat and ImageReader.
+// Anything else returns IMAGE_ERR_FORMAT and goes the regular route.
+static ImageReturnCode loadTextureRaw(const assetInfo *asset,
+  uint16_t **data, uint16_t *width, uint16_t *height) {
+  uint8_t  header[34]; // Through the compression field
+  int32_t  w, h, offset, compression;
+  uint16_t bpp;
+
+  if((assetRead(asset, 0, header, sizeof header) != sizeof header) ||
+     (header[0] != 'B') || (header[1] != 'M')) return IMAGE_ERR_FORMAT;
+  memcpy(&offset     , &header[10], 4);
+  memcpy(&w          , &header[18], 4);
+  memcpy(&h          , &header[22], 4);
+  memcpy(&bpp        , &header[28], 2);
+  memcpy(&compression, &header[30], 4);
+  if((bpp != 24) || compression || (w <= 0) || !h) return IMAGE_ERR_FORMAT;
+  bool     flip     = (h > 0); // BMPs are normally stored bottom-to-top
+  if(h < 0) h = -h;
+  uint32_t rowBytes = (w * 3 + 3) & ~3; // Rows are padded to 4 bytes
+
+  uint16_t *dst = (uint16_t *)malloc(w * h * 2); // Image first, see "booster seat"
+  uint8_t  *row = (uint8_t *)malloc(w * 3);
+  if(!row || !dst) {
+    if(row) free(row);
+    if(dst) free(dst);
+    return IMAGE_ERR_MALLOC;
+  }
+  ImageReturnCode status = IMAGE_SUCCESS;
+  for(int32_t y=0; y<h; y++) {
+    if(!(y & 15)) yield(); // Periodic yield() makes sure mass storage filesystem stays alive
+    if(audioService) audioService(); // Audio refills between rows, not in its ISR
+    int32_t srcRow = flip ? (h - 1 - y) : y;
+    if(assetRead(asset, offset + srcRow * rowBytes, row, w * 3) != (uint32_t)(w * 3)) {
+      status = IMAGE_ERR_FORMAT;
+      break;
+    }
+    uint8_t  *in  = row;
+    uint16_t *out = &dst[y * w];
+    for(int32_t x=0; x<w; x++, in += 3) { // BGR order in file
+      *out++ = __builtin_bswap16(((in[2] & 0xF8) << 8) | ((in[1] & 0xFC) << 3) | (in[0] >> 3));
+    }
+  }
+  free(row);
+  if(status == IMAGE_SUCCESS) {
+    *width  = w;
+    *height = h;
+    *data   = (uint16_t *)textureFlashWrite((uint8_t *)dst, w * h * 2);
+    if(!*data) status = IMAGE_ERR_MALLOC; // Flash full
+  }
+  free(dst);
+  return status;
+}
+
 ImageReturnCode loadTexture(char *filename, uint16_t **data,
   uint16_t *width, uint16_t *height, uint32_t maxRam) {
   Adafruit_Image  image; // Image object is on stack, pixel data is on heap
@@ -428,7 +652,7 @@ ImageReturnCode loadTexture(char *filename, uint16_t **data,
   }
   
   // This is the "booster seat" described in m4eyes.ino
-  if(reader->bmpDimensions(filename, &w, &h) == IMAGE_SUCCESS) {
+  if(assetDimensions(filename, &w, &h) == IMAGE_SUCCESS) { // From asset index
     tempBytes = w * h * 2; // Image size in bytes (converted to 16bpp)
     if (maxRam > tempBytes) {
       if((tempPtr = (uint8_t *)malloc(maxRam - tempBytes)) != NULL) {
@@ -442,15 +666,23 @@ ImageReturnCode loadTexture(char *filename, uint16_t **data,
   }
 
   yield();
-  if((status = reader->loadBMP(filename, image)) == IMAGE_SUCCESS) {
+  if(audioService) audioService(); // Top up before a BMP load it can't break into
+  const assetInfo *asset = assetFind(filename);
+  // Only a texture the raw path can't read goes to ImageReader; anything
+  // else (e.g. IMAGE_ERR_MALLOC, flash full) would just fail there again.
+  status = IMAGE_ERR_FORMAT;
+  if(asset && asset->sector) status = loadTextureRaw(asset, data, width, height);
+  if((status == IMAGE_ERR_FORMAT) &&
+     ((status = reader->loadBMP(filename, image)) == IMAGE_SUCCESS)) {
     if(image.getFormat() == IMAGE_16) { // MUST be 16-bit image
       Serial.println("Texture loaded!");
       GFXcanvas16 *canvas = (GFXcanvas16 *)image.getCanvas();
       canvas->byteSwap(); // Match screen endianism for direct DMA xfer
       *width  = image.width();
       *height = image.height();
-      *data = (uint16_t *)arcada.writeDataToFlash((uint8_t *)canvas->getBuffer(),
+      *data = (uint16_t *)textureFlashWrite((uint8_t *)canvas->getBuffer(),
         (int)*width * (int)*height * 2);
+      if(!*data) status = IMAGE_ERR_MALLOC; // Flash full (e.g. after mood changes)
     } else {
       status = IMAGE_ERR_FORMAT; // Don't just return, need to dealloc...
     }
@@ -35,6 +35,8 @@ GLOBAL_VAR uint32_t  stackReserve        GLOBAL_INIT(5192);   // See image-loadi
 GLOBAL_VAR int       eyeRadius           GLOBAL_INIT(0);      // 0 = Use default in loadConfig()
 GLOBAL_VAR int       eyeDiameter;                             // Calculated from eyeRadius later
 GLOBAL_VAR int       irisRadius          GLOBAL_INIT(60);     // Approx size in screen pixels
+GLOBAL_VAR float     irisBreathe         GLOBAL_INIT(0.0);    // Iris size oscillation, fraction of radius
+GLOBAL_VAR float     irisBreathePeriod   GLOBAL_INIT(4.0);    // Seconds per iris size cycle
 GLOBAL_VAR int       slitPupilRadius     GLOBAL_INIT(0);      // 0 = round pupil
 GLOBAL_VAR uint8_t   eyelidIndex         GLOBAL_INIT(0x00);   // From table: learn.adafruit.com/assets/61921
 GLOBAL_VAR uint16_t  eyelidColor         GLOBAL_INIT(0x0000); // Expand eyelidIndex to 16-bit
@@ -57,8 +59,11 @@ GLOBAL_VAR float     coverage            GLOBAL_INIT(0.6);
 GLOBAL_VAR int       mapRadius;          // calculated in loadConfig()
 GLOBAL_VAR int       mapDiameter;        // calculated in loadConfig()
 GLOBAL_VAR uint8_t  *displace            GLOBAL_INIT(NULL);
+GLOBAL_VAR uint8_t  *rimMap              GLOBAL_INIT(NULL); // 1 bit/pixel, see calcRimMap()
+GLOBAL_VAR bool      foveate             GLOBAL_INIT(true); // Half-rate render of eye rim
+GLOBAL_VAR bool      interlace           GLOBAL_INIT(true); // Interlaced fields in big saccades
 GLOBAL_VAR uint8_t  *polarAngle          GLOBAL_INIT(NULL);
-GLOBAL_VAR int8_t   *polarDist           GLOBAL_INIT(NULL);
+GLOBAL_VAR uint8_t  *polarDist           GLOBAL_INIT(NULL); // Radial code, see calcMap()
 GLOBAL_VAR uint8_t   upperOpen[MAX_DISPLAY_SIZE];
 GLOBAL_VAR uint8_t   upperClosed[MAX_DISPLAY_SIZE];
 GLOBAL_VAR uint8_t   lowerOpen[MAX_DISPLAY_SIZE];
@@ -68,6 +73,11 @@ GLOBAL_VAR char     *lowerEyelidFilename GLOBAL_INIT(NULL);
 GLOBAL_VAR uint16_t  lightSensorMin      GLOBAL_INIT(0);
 GLOBAL_VAR uint16_t  lightSensorMax      GLOBAL_INIT(1023);
 GLOBAL_VAR float     lightSensorCurve    GLOBAL_INIT(1.0);
+GLOBAL_VAR uint8_t   logLevel            GLOBAL_INIT(1);      // Min severity logged (1 = LOG_INFO)
+GLOBAL_VAR uint64_t  renderCycles        GLOBAL_INIT(0);      // CPU cycles spent rendering eye pixels
+GLOBAL_VAR uint32_t  renderPixels        GLOBAL_INIT(0);      // Eye pixels rendered (STATUS resets both)
+GLOBAL_VAR uint32_t  textureLoadCycles   GLOBAL_INIT(0);      // setup() texture + eyelid loading
+GLOBAL_VAR uint32_t  tableGenCycles      GLOBAL_INIT(0);      // setup() calcMap() + calcDisplacement()
 GLOBAL_VAR float     irisMin             GLOBAL_INIT(0.45);
 GLOBAL_VAR float     irisRange           GLOBAL_INIT(0.35);
 GLOBAL_VAR bool      tracking            GLOBAL_INIT(true);
@@ -78,6 +88,17 @@ GLOBAL_VAR uint32_t  gazeMax             GLOBAL_INIT(3000000); // Max wait time
 GLOBAL_VAR bool      moveEyesRandomly    GLOBAL_INIT(true);   // Clear to suppress random eye motion and let user code control it
 GLOBAL_VAR float     eyeTargetX          GLOBAL_INIT(0.0);  // Then set these continuously in user_loop.
 GLOBAL_VAR float     eyeTargetY          GLOBAL_INIT(0.0);  // Range is from -1.0 to +1.0.
+GLOBAL_VAR bool      pursuit             GLOBAL_INIT(true); // Filter and predict eyeTarget (pursuit.cpp)
+GLOBAL_VAR float     pursuitAlpha        GLOBAL_INIT(0.5);  // Filter position gain, 0-1 (lower = smoother)
+GLOBAL_VAR float     pursuitBeta         GLOBAL_INIT(0.2);  // Filter velocity gain, 0-1
+GLOBAL_VAR float     pursuitLatency      GLOBAL_INIT(50.0); // Sensor latency (ms) to predict ahead, plus frame time
+GLOBAL_VAR float     pursuitSaccade      GLOBAL_INIT(0.5);  // Target jump (eyeTarget units) that saccades instead
+GLOBAL_VAR float     pupilHold           GLOBAL_INIT(-1.0); // Pupil set by a cue or MIDI, negative = none
+#define HOLD_CUE  0x01 // Gaze/pupil holder bits (hold.cpp)
+#define HOLD_MIDI 0x02
+GLOBAL_VAR uint8_t   gazeHolders         GLOBAL_INIT(0);    // HOLD_* bits, 0 = moveEyesRandomly as configured
+GLOBAL_VAR uint8_t   pupilHolders        GLOBAL_INIT(0);    // HOLD_* bits, 0 = pupilHold negative
+GLOBAL_VAR float     lidHold             GLOBAL_INIT(-1.0); // Lid opening (0-1) set by MIDI, negative = none
 
 // Pin definition stuff will go here
 
@@ -98,7 +119,20 @@ GLOBAL_VAR float     defaultPitch        GLOBAL_INIT(1.0);
 GLOBAL_VAR float     gain                GLOBAL_INIT(1.0);
 GLOBAL_VAR uint8_t   waveform            GLOBAL_INIT(0);
 GLOBAL_VAR uint32_t  modulate            GLOBAL_INIT(30); // Dalek pitch
+GLOBAL_VAR float     agcTarget           GLOBAL_INIT(0.0);   // Mic AGC level, 0 = off (pdmvoice.cpp)
+GLOBAL_VAR float     agcMaxGain          GLOBAL_INIT(4.0);
+GLOBAL_VAR float     agcAttack           GLOBAL_INIT(5.0);   // Milliseconds
+GLOBAL_VAR float     agcRelease          GLOBAL_INIT(300.0); // Milliseconds
+GLOBAL_VAR float     noiseGate           GLOBAL_INIT(0.0);   // Mic level muted below, 0 = off
+GLOBAL_VAR uint16_t  jawLookahead        GLOBAL_INIT(60);  // ms jaw servo leads audio (user_fizzgig.cpp)
+GLOBAL_VAR float     jawGain             GLOBAL_INIT(2.0); // Audio envelope to jaw opening
 #endif
+// Any audio file player advances these, for the cue list's audio clock
+GLOBAL_VAR volatile uint32_t audioSamples    GLOBAL_INIT(0); // Played since file start
+GLOBAL_VAR volatile uint32_t audioSampleRate GLOBAL_INIT(0); // 0 = nothing playing
+// A player that refills from flash outside its interrupt sets this; long
+// loads (mood reload textures) call it between pieces so audio keeps up
+GLOBAL_VAR void (*audioService)(void)        GLOBAL_INIT(NULL);
 
 // EYE-RELATED STRUCTURES --------------------------------------------------
 
@@ -146,11 +180,81 @@ typedef struct {
   uint16_t  width;
   uint16_t  height;
   uint16_t  startAngle; // INITIAL rotation 0-1023 CCW
-  uint16_t  angle;      // CURRENT rotation 0-1023 CCW
+  uint16_t  angle;      // CURRENT rotation 0-1023 CCW (dithered, used per pixel)
+  uint32_t  fineAngle;  // CURRENT rotation, 22.10 fixed point (1024 = 1 unit)
   uint16_t  mirror;     // 0 = normal, 1023 = flip X axis
-  uint16_t  iSpin;      // Per-frame fixed integer spin, overrides 'spin' value
+  int32_t   iSpin;      // Per-frame fixed spin (22.10), overrides 'spin' value
+  bool      filter;     // true = bilinear sampling, else nearest texel
 } texture;
 
+// Deferred log messages (see log.cpp). Only the ID and arguments are
+// queued; format strings live in a table there, in this same order.
+enum {
+  LOG_FPS, LOG_BOOP, LOG_DMA_STALL, LOG_PITCH, LOG_HEAT,
+  LOG_RELOAD_CACHE_FULL, LOG_RELOAD_CACHE_HIT, LOG_RELOAD_TEXTURE,
+  LOG_RELOAD_TEXTURE_FAIL, LOG_RELOAD_INIT, LOG_RELOAD_START,
+  LOG_RELOAD_DMA_TIMEOUT, LOG_RELOAD_CONFIG, LOG_RELOAD_EYELIDS,
+  LOG_RELOAD_DONE, LOG_DROPPED, LOG_SENSOR_REPLAY_DONE, LOG_PERFORM_DONE,
+  LOG_CUE, LOG_CUE_DONE, LOG_RELOAD_RECLAIM, LOG_NUM_IDS
+};
+enum { LOG_DEBUG, LOG_INFO, LOG_WARN, LOG_ERROR }; // Severity levels
+
+// Sensor IDs for record/replay (see sensorlog.cpp). Stored in log files,
+// so append new ones at the end.
+enum {
+  SENSOR_LIGHT, SENSOR_BOOP, SENSOR_BOOP_THRESHOLD, SENSOR_HEAT_X,
+  SENSOR_HEAT_Y, SENSOR_HEAT_MAGNITUDE, SENSOR_PIR, SENSOR_ACCEL_CLICK,
+  SENSOR_NUM_IDS
+};
+enum { SENSOR_OFF, SENSOR_RECORD, SENSOR_REPLAY }; // sensorLogMode
+#define SENSOR_LOG_FILE "/sensors.log" // Default record/replay file
+
+enum { PERFORM_OFF, PERFORM_RECORD, PERFORM_PLAY }; // performMode (perform.cpp)
+#define PERFORM_FILE "/performance.m4p" // Default performance file
+
+enum { CUE_OFF, CUE_RUN };                                   // cueMode (cue.cpp)
+enum { CUE_CLOCK_INTERNAL, CUE_CLOCK_AUDIO, CUE_CLOCK_EXTERNAL }; // cueClock
+#define CUE_FILE "/cues.txt" // Default cue list
+
+// Audio output and resampling (see resample.cpp). Every source is
+// resampled to this one DAC rate: 48 MHz / 1024, the PDM mic's own rate.
+#define AUDIO_OUT_RATE 46875
+#define RS_TAPS            8 // FIR length, input samples
+typedef struct {
+  int16_t  hist[RS_TAPS * 2]; // Last RS_TAPS inputs, each stored twice
+  uint8_t  head;              // Oldest input, next to be replaced
+  uint32_t pos;               // Output position, 16.16; >= 1.0 needs input
+  uint32_t step;              // Input samples per output sample, 16.16
+} resampler;
+
+// Voice effect chain (see voicefx.cpp), one spec per "voiceFX" entry in
+// config.eye. Parameters an effect doesn't use, or that aren't given, are
+// negative (effect's default).
+#define FX_MAX 8 // Most effects in the chain
+enum { FX_RING, FX_CRUSH, FX_LOWPASS, FX_HIGHPASS, FX_ECHO, FX_DISTORT, FX_NUM_TYPES };
+typedef struct {
+  uint8_t type;     // FX_* above
+  float   freq;     // Hz: ring oscillator, filter cutoff, crush sample rate
+  float   mix;      // Wet fraction, 0.0-1.0: ring, echo
+  float   bits;     // crush: bits kept, 1-16
+  float   ms;       // echo: delay
+  float   feedback; // echo: 0.0-0.95
+  float   drive;    // distort: gain into the clipper, 1-32
+} fxSpec;
+#if defined(ADAFRUIT_MONSTER_M4SK_EXPRESS)
+GLOBAL_VAR fxSpec    voiceFX[FX_MAX];
+GLOBAL_VAR uint8_t   numVoiceFX          GLOBAL_INIT(0);
+#endif
+
+// Asset index entry (see assets.cpp)
+typedef struct {
+  uint32_t hash;          // FNV-1a hash of path, 0 = empty slot
+  uint32_t size;          // File size in bytes
+  uint32_t sector;        // First sector if stored contiguously, else 0
+  int16_t  width, height; // BMP dimensions, 0 if not a BMP
+  uint8_t  pathLen;       // Path length (no leading '/'), checked with hash
+} assetInfo;
+
 // Each eye then uses the following structure. Each eye must be on its own
 // SPI bus with distinct control lines (unlike the Uncanny Eyes code where
 // they take turns on one bus). Two of the column structures as described
@@ -169,15 +273,28 @@ typedef struct {
   DMAbuddy         dma;          // DMA channel object with fix() function
   DmacDescriptor  *dptr;         // DMA channel descriptor pointer
   uint32_t         dmaStartTime; // For DMA timeout handler
-  uint8_t          colNum;       // Column counter (0-239)
+  uint8_t          colNum;       // Column counter (0-239, 0-119 if interlaced)
   uint8_t          colIdx;       // Alternating 0/1 index into column[] array
   bool             dma_busy;     // true = DMA transfer in progress
   bool             column_ready; // true = next column is already rendered
+  bool             spiActive;    // true = SPI transaction open, CS asserted
+  Sercom          *sercom;       // SERCOM behind spi, for direct writes
+  PortGroup       *csPort;       // PORT group and bit for CS pin
+  uint32_t         csMask;
+  PortGroup       *dcPort;       // PORT group and bit for DC pin
+  uint32_t         dcMask;
+  uint16_t         winY;         // First display RAM row of eye square
+  uint8_t          addrWindow[11]; // CASET/RASET/RAMWR command sequence
+  bool             interlaced;   // true = current frame is a half-column field
+  uint8_t          field;        // Interlaced field: 0 = even columns, 1 = odd
   uint16_t         pupilColor;   // 16-bit 565 RGB, big-endian
   uint16_t         backColor;    // 16-bit 565 RGB, big-endian
   texture          iris;         // iris texture map
   texture          sclera;       // sclera texture map
   uint8_t          rotation;     // Screen rotation (GFX lib)
+  float            irisRadius;   // Iris size, screen pixels (0 = use global)
+  float            lutRadius;    // Iris size distLUT[] was last built for
+  int8_t           distLUT[256]; // polarDist code -> sclera/iris distance
 
   // Stuff carried over from Uncanny Eyes code. It now needs to be
   // independent per-eye because we interleave between drawing the
@@ -205,40 +322,156 @@ typedef struct {
 
 // FUNCTION PROTOTYPES -----------------------------------------------------
 
-// Functions in file.cpp
-extern int             file_setup(bool msc=true);
-extern void            handle_filesystem_change();
+// Functions in adpcm.cpp
+extern uint16_t         adpcmDecodeBlock(const uint8_t *src, uint16_t len, uint8_t *dst);
+extern void             adpcmStatsReset(void);
+extern uint32_t         adpcmBlocks, adpcmCycles, adpcmCyclesMax;
+
+// Functions in assets.cpp
+extern void             assetIndexBuild(void);
+extern void             handle_filesystem_change(void);
+extern const assetInfo *assetFind(const char *path);
+extern bool             assetExists(const char *path);
+extern ImageReturnCode  assetDimensions(char *filename, int32_t *w, int32_t *h);
+extern uint32_t         assetRead(const assetInfo *a, uint32_t offset, void *dst, uint32_t len);
+extern void             assetBenchmark(const char *path);
 // This is set true when filesystem contents have changed.
 // Set true initially so the program starts with the "changed" task.
 extern bool            filesystem_change_flag GLOBAL_INIT(true);
+
+// Functions in blockcache.cpp
+extern bool            blockCacheBegin(void);
+extern void            blockCacheInvalidate(void);
+extern uint32_t        blockCacheHits, blockCacheMisses;
+
+// Functions in cue.cpp
+extern int16_t         cueLoad(const char *filename);
+extern bool            cueGo(void);
+extern void            cueStop(void);
+extern void            cueTime(uint32_t ms);
+extern void            cueFrame(uint8_t eyeNum, uint32_t t);
+extern uint16_t        cueCount(void);
+extern uint16_t        cueNext(void);
+extern uint32_t        cueClockMs(void);
+extern uint8_t         cueMode, cueClock;
+extern uint16_t        cueErrorLine;
+extern uint32_t        cueFired;
+extern int32_t         cueMaxLateMs;
+
+// Functions in display.cpp
+extern void            displayFastSetup(eyeStruct *e);
+extern void            displaySelect(eyeStruct *e);
+extern void            displayRelease(eyeStruct *e);
+extern void            displayWindow(eyeStruct *e, uint8_t row, uint16_t rows);
+
+// Functions in file.cpp
+extern int             file_setup(bool msc=true);
 extern void            loadConfig(char *filename);
 extern ImageReturnCode loadEyelid(char *filename, uint8_t *minArray, uint8_t *maxArray, uint8_t init, uint32_t maxRam);
 extern ImageReturnCode loadTexture(char *filename, uint16_t **data, uint16_t *width, uint16_t *height, uint32_t maxRam);
+extern void            textureFlashReclaim(void);
+
+// Functions in hold.cpp
+extern bool            holdGaze(uint8_t holder);
+extern void            releaseGaze(uint8_t holder);
+extern void            holdPupil(uint8_t holder, float size);
+extern void            releasePupil(uint8_t holder);
+
+// Functions in log.cpp
+extern void            logMsg(uint8_t id, int32_t a=0, int32_t b=0, int32_t c=0);
+extern void            logStr(uint8_t id, const char *s);
+extern void            logDrain(void);
+extern uint32_t        logDropped;
 
 // Functions in memory.cpp
 extern uint32_t        availableRAM(void);
 extern uint32_t        availableNVM(void);
 extern uint8_t        *writeDataToFlash(uint8_t *src, uint32_t len);
 
+// Functions in midi.cpp
+extern void            midiBegin(void);
+extern void            midiFrame(uint8_t eyeNum, uint32_t t);
+extern void            midiFrameSent(uint8_t eyeNum);
+extern void            midiStatsReset(void);
+extern uint32_t        midiEvents, midiDropped, midiQueueMax;
+extern uint32_t        midiLatencyCount, midiLatencyTotal, midiLatencyMax;
+
 // Functions in pdmvoice.cpp
 #if defined(ADAFRUIT_MONSTER_M4SK_EXPRESS)
 extern bool              voiceSetup(bool modEnable);
 extern float             voicePitch(float p);
 extern void              voiceGain(float g);
 extern void              voiceMod(uint32_t freq, uint8_t waveform);
+extern void              voiceAGC(float target, float maxGain, float attack, float release, float gate);
+extern volatile int32_t  voiceAgcGain; // 4096 = 1.0
+extern volatile bool     voiceGateOpen;
+extern volatile uint32_t voiceAgcCycles, voiceAgcSamples;
 extern volatile uint16_t voiceLastReading;
+extern volatile uint32_t voiceSplices;
 #endif // ADAFRUIT_MONSTER_M4SK_EXPRESS
 
+// Functions in perform.cpp
+extern void            performFrame(uint8_t eyeNum, float *x, float *y, float *p, bool *s);
+extern void            performBlinks(uint8_t eyeNum, uint32_t t);
+extern bool            performRecord(const char *filename);
+extern bool            performPlay(const char *filename);
+extern void            performStop(void);
+extern void            performService(void);
+extern uint8_t         performMode;
+extern uint32_t        performFrames, performBytes, performOverruns;
+
+// Functions in pursuit.cpp
+extern bool            pursuitUpdate(uint32_t t, float *x, float *y);
+
+// Functions in resample.cpp
+extern void            rsBegin(void);
+extern int16_t         rsInterp(const int16_t *x, uint16_t frac);
+extern uint32_t        rsStep(float ratio);
+extern void            rsInit(resampler *r, float ratio);
+extern void            rsPush(resampler *r, int16_t s);
+extern int16_t         rsOut(resampler *r);
+#define rsNeedsInput(r) ((r)->pos >= 0x10000)
+
+// Functions in sensorlog.cpp
+extern int32_t         sensorSample(uint8_t id, int32_t value);
+extern bool            sensorLogRecord(const char *filename);
+extern bool            sensorLogReplay(const char *filename);
+extern void            sensorLogStop(void);
+extern void            sensorLogService(void);
+extern uint8_t         sensorLogMode;
+extern uint32_t        sensorLogRecords, sensorLogDropped;
+
 // Functions in tablegen.cpp
 extern void            calcDisplacement(void);
 extern void            calcMap(void);
-extern float           screen2map(int in);
+extern void            calcRimMap(void);
+extern void            calcDistLUT(int8_t *lut, float iRadius);
+extern float           screen2map(float in);
 extern float           map2screen(int in);
 
+// Functions in usbsched.cpp
+extern void            usbSliceDone(void);
+extern bool            usbServiceDue(bool idle);
+extern uint32_t        usbLoadPercent(void);
+extern void            usbStatsReset(void);
+extern uint32_t        usbSlices, usbSliceMax, usbSliceTotal, usbGapMax, usbBackoffs;
+
 // Functions in user.cpp
 extern void            user_setup(void);
 extern void            user_loop(void);
 
+// Functions in voicefx.cpp
+#if defined(ADAFRUIT_MONSTER_M4SK_EXPRESS)
+extern bool              fxSetup(const fxSpec *spec, uint8_t n);
+extern int8_t            fxType(const char *name);
+extern const char       *fxName(uint8_t i);
+extern int16_t           fxProcess(int16_t s);
+extern void              fxStatsReset(void);
+extern volatile uint8_t  fxStages;
+extern volatile uint32_t fxBlocks, fxCycles[FX_MAX], fxCyclesMax[FX_MAX];
+extern uint32_t          fxSetupCycles[FX_MAX];
+#endif // ADAFRUIT_MONSTER_M4SK_EXPRESS
+
 // Mood reload system
 GLOBAL_VAR volatile bool reloadRequested   GLOBAL_INIT(false);
 GLOBAL_VAR char          reloadConfigPath[64];
@@ -0,0 +1,42 @@
+// SPDX-FileCopyrightText: 2024 Monster Mask Open Claw Project
+//
+// SPDX-License-Identifier: MIT
+
+// Gaze and pupil holds. The cue list and MIDI can each take over gaze or
+// pupil size, independently and in any order; each holder has a HOLD_*
+// bit in gazeHolders/pupilHolders, and the hold lasts until every holder
+// has let go. The first to take gaze saves moveEyesRandomly and the last
+// to release it puts it back, so one can't strand or steal the other's.
+
+#include "globals.h"
+
+static bool savedRandom; // moveEyesRandomly before the first gaze hold
+
+// Take gaze for holder, which then sets eyeTargetX/Y (gaze goes through
+// pursuit.cpp as usual). Returns true if holder didn't already have it.
+bool holdGaze(uint8_t holder) {
+  if(gazeHolders & holder) return false;
+  if(!gazeHolders) {
+    savedRandom      = moveEyesRandomly;
+    moveEyesRandomly = false;
+  }
+  gazeHolders |= holder;
+  return true;
+}
+
+void releaseGaze(uint8_t holder) {
+  if(!(gazeHolders & holder)) return;
+  gazeHolders &= ~holder;
+  if(!gazeHolders) moveEyesRandomly = savedRandom;
+}
+
+// Pupil is whatever the latest holder set, until all have released it
+void holdPupil(uint8_t holder, float size) {
+  pupilHolders |= holder;
+  pupilHold     = size;
+}
+
+void releasePupil(uint8_t holder) {
+  pupilHolders &= ~holder;
+  if(!pupilHolders) pupilHold = -1.0;
+}
@@ -0,0 +1,110 @@
+// SPDX-FileCopyrightText: 2024 Monster Mask Open Claw Project
+//
+// SPDX-License-Identifier: MIT
+
+// Deferred logging. Serial.print() over USB CDC can block when the host
+// isn't reading, which is no good in the middle of rendering. logMsg()
+// and logStr() instead queue a message ID plus its arguments in a small
+// ring buffer; formatting and output happen in logDrain(), called from
+// loop() when it's handing time to USB anyway, and only as much as the
+// CDC transmit buffer can take without waiting. If the queue fills,
+// new messages are counted and dropped rather than waited on.
+
+#include "globals.h"
+#include <string.h>
+
+#define LOG_QUEUE_SIZE  32 // Messages, must be power of 2
+#define LOG_STR_MAX     32 // Max string argument length, including NUL
+#define LOG_DRAIN_MAX    4 // Max messages output per logDrain() call
+
+// Format strings and severity by logId, in the same order as the enum
+// in globals.h. Messages take either one string or up to 3 int args.
+static const struct {
+  uint8_t     level;
+  bool        str;  // true if message takes a string argument
+  const char *fmt;
+} logFormat[] = {
+  { LOG_INFO , false, "%ld\n"                                       }, // LOG_FPS
+  { LOG_INFO , false, "BOOP!\n"                                     }, // LOG_BOOP
+  { LOG_WARN , false, "Eye #%ld stalled, resetting DMA channel...\n" }, // LOG_DMA_STALL
+  { LOG_INFO , false, "Voice pitch: %ld%%\n"                        }, // LOG_PITCH
+  { LOG_INFO , false, "%ld %ld %ld\n"                               }, // LOG_HEAT
+  { LOG_WARN , false, "RELOAD: Texture cache full, not caching\n"   }, // LOG_RELOAD_CACHE_FULL
+  { LOG_DEBUG, true , "RELOAD: Texture cache hit: %s\n"            }, // LOG_RELOAD_CACHE_HIT
+  { LOG_INFO , true , "RELOAD: Loading texture: %s\n"              }, // LOG_RELOAD_TEXTURE
+  { LOG_ERROR, true , "RELOAD: Texture load failed: %s\n"          }, // LOG_RELOAD_TEXTURE_FAIL
+  { LOG_INFO , false, "RELOAD: Mood reload system initialized\n"    }, // LOG_RELOAD_INIT
+  { LOG_INFO , true , "RELOAD: Starting reload with config: %s\n"  }, // LOG_RELOAD_START
+  { LOG_WARN , false, "RELOAD: DMA timeout on eye %ld, forcing\n"   }, // LOG_RELOAD_DMA_TIMEOUT
+  { LOG_INFO , false, "RELOAD: Config loaded, loading textures...\n" }, // LOG_RELOAD_CONFIG
+  { LOG_INFO , false, "RELOAD: Loading eyelids...\n"                }, // LOG_RELOAD_EYELIDS
+  { LOG_INFO , false, "RELOAD: Complete! Free RAM: %ld\n"           }, // LOG_RELOAD_DONE
+  { LOG_WARN , false, "(%ld log messages dropped)\n"                }, // LOG_DROPPED
+  { LOG_INFO , false, "SENSORS:REPLAYDONE,records=%ld\n"            }, // LOG_SENSOR_REPLAY_DONE
+  { LOG_INFO , false, "PERFORM:DONE,frames=%ld\n"                   }, // LOG_PERFORM_DONE
+  { LOG_INFO , false, "CUE:FIRE,index=%ld,ms=%ld,lateMs=%ld\n"      }, // LOG_CUE
+  { LOG_INFO , false, "CUE:DONE,fired=%ld,maxLateMs=%ld\n"          }, // LOG_CUE_DONE
+  { LOG_INFO , false, "RELOAD: Texture flash full, reclaiming\n"    }, // LOG_RELOAD_RECLAIM
+};
+
+static struct {
+  uint8_t id;
+  int32_t arg[3];
+  char    str[LOG_STR_MAX];
+} logQueue[LOG_QUEUE_SIZE];
+static uint16_t logHead = 0, logTail = 0; // Head = next write, tail = next read
+static uint32_t logDroppedUnreported = 0;
+uint32_t        logDropped = 0;           // Total since boot, for STATUS
+
+static bool logPush(uint8_t id, const char *s, int32_t a, int32_t b, int32_t c) {
+  if((id >= LOG_NUM_IDS) || (logFormat[id].level < logLevel)) return false;
+  if((uint16_t)(logHead - logTail) >= LOG_QUEUE_SIZE) { // Full
+    logDropped++;
+    logDroppedUnreported++;
+    return false;
+  }
+  uint16_t i       = logHead & (LOG_QUEUE_SIZE - 1);
+  logQueue[i].id     = id;
+  logQueue[i].arg[0] = a;
+  logQueue[i].arg[1] = b;
+  logQueue[i].arg[2] = c;
+  if(s) {
+    strncpy(logQueue[i].str, s, LOG_STR_MAX - 1);
+    logQueue[i].str[LOG_STR_MAX - 1] = 0;
+  } else {
+    logQueue[i].str[0] = 0;
+  }
+  logHead++;
+  return true;
+}
+
+void logMsg(uint8_t id, int32_t a, int32_t b, int32_t c) {
+  logPush(id, NULL, a, b, c);
+}
+
+void logStr(uint8_t id, const char *s) {
+  logPush(id, s ? s : "", 0, 0, 0);
+}
+
+// Output up to LOG_DRAIN_MAX queued messages, stopping early if the
+// serial transmit buffer doesn't have room for the next one.
+void logDrain(void) {
+  char line[80];
+  if(logDroppedUnreported && ((uint16_t)(logHead - logTail) < LOG_QUEUE_SIZE)) {
+    uint32_t n = logDroppedUnreported;
+    logDroppedUnreported = 0;
+    logMsg(LOG_DROPPED, n);
+  }
+  for(uint8_t n=0; (n < LOG_DRAIN_MAX) && (logTail != logHead); n++) {
+    uint16_t i   = logTail & (LOG_QUEUE_SIZE - 1);
+    uint8_t  id  = logQueue[i].id;
+    int      len = logFormat[id].str ?
+      snprintf(line, sizeof line, logFormat[id].fmt, logQueue[i].str) :
+      snprintf(line, sizeof line, logFormat[id].fmt, (long)logQueue[i].arg[0],
+        (long)logQueue[i].arg[1], (long)logQueue[i].arg[2]);
+    if(len >= (int)sizeof line) len = sizeof line - 1;
+    if(Serial && (Serial.availableForWrite() < len)) break; // Try again later
+    Serial.write((const uint8_t *)line, len);
+    logTail++;
+  }
+}
@@ -0,0 +1,205 @@
+// SPDX-FileCopyrightText: 2024 Monster Mask Open Claw Project
+//
+// SPDX-License-Identifier: MIT
+
+// USB MIDI puppeteering. The mask shows up as a MIDI device alongside the
+// drive and serial port, so a show controller or any MIDI control surface
+// can drive it directly. Messages are parsed in TinyUSB's receive callback
+// (the USB task, run between loop() calls) into a small lock-free queue:
+// the callback only ever writes the head and midiFrame(), at the start of
+// each eyeball's frame, only the tail, so neither side waits for the other
+// and nothing is lost to a frame in progress. Any channel:
+//   CC 16           Gaze X, 0-127 = -1.0 to +1.0 as eyeTargetX
+//   CC 17           Gaze Y, likewise eyeTargetY
+//   CC 18           Pupil, 0-127 = smallest to largest in its range
+//   CC 19           Eyelids, 0 = shut, 127 = wide open
+//   CC 20           127 (>= 64) hands gaze, pupil and lids back
+//   Note 60 (C4)    Blink; velocity sets speed (harder = faster)
+//   Note 61, 62     Wink eye 0, eye 1
+//   Program change  Mood (midiMoods[] below), without a reboot
+// A CC takes over that control until released with CC 20 (gaze goes
+// through pursuit.cpp, so it's smoothed and big jumps saccade). Gaze and
+// pupil are shared with the cue list (hold.cpp): each lets go of its own
+// hold, and the control goes back once neither holds it.
+//
+// Latency: each message is stamped in the callback. For one message at a
+// time, the time until both eyes have finished sending a frame begun after
+// it was applied is measured, i.e. until it's on both screens.
+
+#include "globals.h"
+#include <Adafruit_TinyUSB.h>
+#include <string.h>
+
+#define MIDI_QUEUE_SIZE 64 // Events, must be power of 2
+#define CC_GAZE_X       16
+#define CC_GAZE_Y       17
+#define CC_PUPIL        18
+#define CC_LIDS         19
+#define CC_RELEASE      20
+#define NOTE_BLINK      60 // Then one note per eye
+
+// Program change number -> mood config (eyes/moods). The emulator's
+// scenarios/mood-midi.emu loads each in turn; keep it in step with this.
+static const char *midiMoods[] = {
+  "moods/happy/config.eye",     "moods/sad/config.eye",
+  "moods/angry/config.eye",     "moods/scared/config.eye",
+  "moods/surprised/config.eye", "moods/suspicious/config.eye",
+  "moods/sleepy/config.eye",    "moods/love/config.eye",
+  "moods/crazy/config.eye",
+};
+#define NUM_MIDI_MOODS (sizeof midiMoods / sizeof midiMoods[0])
+
+typedef struct {
+  uint32_t us;     // micros() when received
+  uint8_t  status; // Channel voice message, channel bits cleared
+  uint8_t  data1, data2;
+} midiEvent;
+
+static Adafruit_USBD_MIDI usbMidi;
+static midiEvent          queue[MIDI_QUEUE_SIZE];
+static volatile uint16_t  head = 0, tail = 0; // Free-running; head is only
+                                              // written by the callback,
+                                              // tail only by midiFrame()
+static uint32_t           stampUs;           // Message being timed...
+static uint8_t            waitStart   = 0;   // ...eyes yet to start a frame with it
+static uint8_t            waitSent    = 0;   // ...eyes yet to finish that frame
+uint32_t                  midiEvents  = 0;
+uint32_t                  midiDropped = 0;   // Queue full
+uint32_t                  midiLatencyCount, midiLatencyTotal, midiLatencyMax; // uS
+uint32_t                  midiQueueMax;      // uS, callback to frame start
+
+// Call early in setup(), before USB enumeration is far along
+void midiBegin(void) {
+  usbMidi.setStringDescriptor("M4 Eyes");
+  usbMidi.begin();
+  if(TinyUSBDevice.mounted()) { // Already enumerated: again, with MIDI
+    TinyUSBDevice.detach();
+    delay(10);
+    TinyUSBDevice.attach();
+  }
+}
+
+// TinyUSB receive callback, USB task context
+extern "C" void tud_midi_rx_cb(uint8_t itf) {
+  (void)itf;
+  uint8_t packet[4];
+  while(tud_midi_available() && tud_midi_packet_read(packet)) {
+    // USB-MIDI packet: cable/code index, then the MIDI message itself.
+    // Only note on, CC and program change are of interest.
+    uint8_t cin = packet[0] & 0x0F;
+    if((cin != 0x9) && (cin != 0xB) && (cin != 0xC)) continue;
+    uint16_t h = head;
+    if((uint16_t)(h - tail) >= MIDI_QUEUE_SIZE) {
+      midiDropped++;
+      continue;
+    }
+    midiEvent *e = &queue[h & (MIDI_QUEUE_SIZE - 1)];
+    e->us     = micros();
+    e->status = packet[1] & 0xF0;
+    e->data1  = packet[2];
+    e->data2  = packet[3];
+    __DMB(); // Event is written before it's published
+    head = h + 1;
+  }
+}
+
+static void release(void) {
+  releaseGaze(HOLD_MIDI);
+  releasePupil(HOLD_MIDI);
+  lidHold = -1.0;
+}
+
+static void blink(uint8_t mask, uint8_t velocity, uint32_t t) {
+  uint32_t duration = 100000 - velocity * 70000 / 127; // 100 to 30 ms
+  for(uint8_t e=0; e<NUM_EYES; e++) {
+    if(mask & (1 << e)) {
+      eye[e].blink.state     = ENBLINK;
+      eye[e].blink.startTime = t;
+      eye[e].blink.duration  = duration;
+    }
+  }
+}
+
+static void apply(const midiEvent *e, uint32_t t) {
+  float v = e->data2 / 127.0;
+  switch(e->status) {
+   case 0x90: // Note on
+    if(!e->data2) break; // Velocity 0 is note off
+    if(e->data1 == NOTE_BLINK) blink((1 << NUM_EYES) - 1, e->data2, t);
+    else if((e->data1 > NOTE_BLINK) && (e->data1 <= (NOTE_BLINK + NUM_EYES))) {
+      blink(1 << (e->data1 - NOTE_BLINK - 1), e->data2, t);
+    }
+    break;
+   case 0xB0: // Control change
+    switch(e->data1) {
+     case CC_GAZE_X:
+     case CC_GAZE_Y:
+      if(holdGaze(HOLD_MIDI)) eyeTargetX = eyeTargetY = 0.0;
+      if(e->data1 == CC_GAZE_X) eyeTargetX = v * 2.0 - 1.0;
+      else                      eyeTargetY = v * 2.0 - 1.0;
+      break;
+     case CC_PUPIL:
+      holdPupil(HOLD_MIDI, irisMin + irisRange * v);
+      break;
+     case CC_LIDS:
+      lidHold = v;
+      break;
+     case CC_RELEASE:
+      if(e->data2 >= 64) release();
+      break;
+    }
+    break;
+   case 0xC0: // Program change
+    if(e->data1 < NUM_MIDI_MOODS) {
+      strcpy(reloadConfigPath, midiMoods[e->data1]); // Reloads at end of frame
+      reloadRequested = true;
+    }
+    break;
+  }
+}
+
+// Call at the start of each eyeball's frame, before its gaze, pupil and
+// lids are worked out, with the current time (micros()).
+void midiFrame(uint8_t eyeNum, uint32_t t) {
+  if((waitStart | waitSent) && ((t - stampUs) > 1000000)) {
+    waitStart = waitSent = 0; // Frames interrupted (e.g. mood reload), give up
+  }
+  if(waitStart & (1 << eyeNum)) { // Timed message is in this eye's frame
+    waitStart &= ~(1 << eyeNum);
+    waitSent  |= 1 << eyeNum;
+  }
+  uint16_t h = head;
+  if(h == tail) return;
+  __DMB(); // Events are read after seeing the head that published them
+  while(tail != h) {
+    const midiEvent *e = &queue[tail & (MIDI_QUEUE_SIZE - 1)];
+    uint32_t wait = t - e->us;
+    if(wait > midiQueueMax) midiQueueMax = wait;
+    if(!waitStart && !waitSent) { // Time this one
+      stampUs   = e->us;
+      waitStart = ((1 << NUM_EYES) - 1) & ~(1 << eyeNum);
+      waitSent  = 1 << eyeNum;
+    }
+    apply(e, t);
+    midiEvents++;
+    tail = tail + 1;
+  }
+}
+
+// Call when an eyeball's frame has been sent to its screen
+void midiFrameSent(uint8_t eyeNum) {
+  if(!(waitSent & (1 << eyeNum))) return;
+  waitSent &= ~(1 << eyeNum);
+  if(!waitStart && !waitSent) {
+    uint32_t us = micros() - stampUs;
+    midiLatencyCount++;
+    midiLatencyTotal += us;
+    if(us > midiLatencyMax) midiLatencyMax = us;
+  }
+}
+
+// Counters for MIDI status, reset after each report
+void midiStatsReset(void) {
+  midiEvents = midiDropped = 0;
+  midiLatencyCount = midiLatencyTotal = midiLatencyMax = midiQueueMax = 0;
+}
@@ -16,7 +16,6 @@
 #define TYP_PITCH_HZ  175
 
 static void  voiceOutCallback(void);
-static float actualPlaybackRate;
 
 // PDM mic allows 1.0 to 3.25 MHz max clock (2.4 typical).
 // SPI native max is is 24 MHz, so available speeds are 12, 6, 3 MHz.
@@ -25,7 +24,8 @@ static float actualPlaybackRate;
 // 2 interrupts/sample = 46,875 Hz audio sample rate
 const float sampleRate = (float)SPI_BITRATE / 64.0;
 // sampleRate is float in case factors change to make it not divide evenly.
-// It DOES NOT CHANGE over time, only playbackRate does.
+// It DOES NOT CHANGE over time. Output is always at AUDIO_OUT_RATE; pitch
+// is how fast playback moves through the recording (see resample.cpp).
 
 // Although SPI lib now has an option to get an SPI object's SERCOM number
 // at run time, the interrupt handler MUST be declared at compile time...
@@ -35,7 +35,7 @@ const float sampleRate = (float)SPI_BITRATE / 64.0;
 
 Adafruit_ZeroPDMSPI pdmspi(&PDM_SPI);
 
-static float          playbackRate     = sampleRate;
+static uint32_t       playbackStep     = 0x10000; // Recording samples per output, 16.16
 static uint16_t      *recBuf           = NULL;
 // recBuf currently gets allocated (in voiceSetup()) for two full cycles of
 // the lowest pitch we're likely to encounter. Right now it doesn't really
@@ -43,12 +43,46 @@ static uint16_t      *recBuf           = NULL;
 // this'll become more useful.
 // 46,875 sampling rate from mic, 65 Hz lowest pitch -> 2884 bytes.
 static const uint16_t recBufSize       = (uint16_t)(sampleRate / (float)MIN_PITCH_HZ * 2.0 + 0.5);
+static const uint32_t recBufEnd        = (uint32_t)recBufSize << 16;
 static int16_t        recIndex         = 0;
-static int16_t        playbackIndex    = 0;
+static uint32_t       playbackPos      = 0;     // Into recBuf, 16.16
 
 volatile uint16_t     voiceLastReading = 32768;
 volatile uint16_t     voiceMin         = 32768;
 volatile uint16_t     voiceMax         = 32768;
+volatile uint32_t     voiceSplices     = 0;     // Playback jumps started
+
+// Automatic gain control and noise gate, on the mic samples before they're
+// recorded (so before pitch shifting, which would otherwise bring up the
+// hiss along with everything else). Per sample it's only a DC offset
+// subtraction, a peak check and a multiply; once per AGC_BLOCK samples
+// the block's peak updates a level follower (attack/release times) and,
+// while the gate is open, the gain is set to bring that level to the
+// target. The gate has its own faster follower, so it shuts promptly
+// after loud sounds rather than waiting out the AGC's long release. Gain
+// is held while the gate is shut, so it doesn't wind up to maximum on the
+// background noise.
+#define AGC_BLOCK       32   // Samples per gain update, 0.68 ms
+#define AGC_UNITY       4096 // Gain 1.0 (gains are 4.12 fixed point)
+#define GATE_RELEASE_MS 20   // Gate level fall time and fade-out time
+static bool           agcOn            = false;
+static int32_t        agcTargetLevel   = 0;     // Level to aim for, 0 = AGC off
+static int32_t        agcGainMax       = AGC_UNITY;
+static int32_t        gateLevel        = 0;     // Gate opens at this level, 0 = no gate
+static int32_t        agcAttackK, agcReleaseK;  // Per block, 65536 = instant
+static int32_t        gateReleaseK;
+static int32_t        agcDC            = 32768 << 8; // Mic DC offset (24.8)
+static int32_t        agcLevel         = 0;     // Peak level follower
+static int32_t        gateEnv          = 0;     // Faster one for the gate
+static int32_t        agcGain          = AGC_UNITY;
+static int32_t        gateGain         = AGC_UNITY;
+static uint32_t       agcSum           = 0;     // Block sum, for DC
+static int32_t        agcPeak          = 0;     // Block peak
+static uint8_t        agcCount         = 0;     // Samples in block so far
+volatile int32_t      voiceAgcGain     = AGC_UNITY; // Applied gain incl. gate
+volatile bool         voiceGateOpen    = true;
+volatile uint32_t     voiceAgcCycles   = 0;     // Cost, reset by user code
+volatile uint32_t     voiceAgcSamples  = 0;
 
 #define MOD_MIN 20 // Lowest supported modulation frequency (lower = more RAM use)
 static uint8_t        modWave          = 0;     // Modulation wave type (none, sine, square, tri, saw)
@@ -73,7 +107,7 @@ static const uint16_t interp    = jump / 4; // Interp time = 1/4 waveform
 static bool           jumping   = false;
 static uint16_t       jumpCount = 1;
 static int16_t        jumpThreshold;
-static int16_t        playbackIndexJumped;
+static uint32_t       playbackPosJumped;
 static uint16_t       nextOut   = 2048;
 
 float voicePitch(float p);
@@ -89,14 +123,15 @@ bool voiceSetup(bool modEnable) {
 
   // Allocate buffer for voice modulation, if enabled
   if(modEnable) {
-    // 250 comes from min period in voicePitch()
-    modBuf = (uint8_t *)malloc((int)(48000000.0 / 250.0 / MOD_MIN + 0.5));
+    modBuf = (uint8_t *)malloc(AUDIO_OUT_RATE / MOD_MIN + 1);
     // If malloc fails, program will continue without modulation
   }
 
+  rsBegin();                 // Resampling filters
   pdmspi.begin(sampleRate);  // Set up PDM microphone
   analogWriteResolution(12); // Set up analog output
-  voicePitch(1.0);           // Set timer interval
+  voicePitch(1.0);
+  arcada.timerCallback(AUDIO_OUT_RATE, voiceOutCallback);
 
   return true; // Success
 }
@@ -107,20 +142,15 @@ bool voiceSetup(bool modEnable) {
 // 0.5 = halve frequency (1 octave down)
 // 1.0 = normal playback
 // 2.0 = double frequency (1 octave up)
-// Available pitch adjustment range depends on various hardware factors
-// (SPI speed, timer/counter resolution, etc.), and the actual pitch
-// adjustment (after appying constraints) will be returned.
+// Pitch is the resampling ratio from recording to output, so the output
+// rate stays put. Range is 0.25 to 4.0 (rsStep()), and the actual pitch
+// adjustment (after applying constraints and fixed-point rounding) will
+// be returned.
 float voicePitch(float p) {
-  float   desiredPlaybackRate = sampleRate * p;
-  // Clip to sensible range
-  if(desiredPlaybackRate < 19200)       desiredPlaybackRate = 19200;  // ~0.41X
-  else if(desiredPlaybackRate > 192000) desiredPlaybackRate = 192000; // ~4.1X
-  arcada.timerCallback(desiredPlaybackRate, voiceOutCallback);
-  // Making this assumption here knowing Arcada will use 1:1 prescale:
-  int32_t period = (int32_t)(48000000.0 / desiredPlaybackRate);
-  actualPlaybackRate = 48000000.0 / (float)period;
-  p = (actualPlaybackRate / sampleRate); // New pitch
+  uint32_t step = rsStep(p * sampleRate / (float)AUDIO_OUT_RATE);
+  p             = (float)step / 65536.0 * (float)AUDIO_OUT_RATE / sampleRate;
   jumpThreshold = (int)(jump * p + 0.5);
+  playbackStep  = step;
   return p;
 }
 
@@ -130,15 +160,36 @@ void voiceGain(float g) {
   pdmspi.setMicGain(g); // Handles its own clipping
 }
 
+// SET AGC AND NOISE GATE --------------------------------------------------
+
+// target:  level AGC aims for, fraction of full scale (0 = AGC off)
+// maxGain: most AGC will amplify (1.0 to 8.0)
+// attack, release: level follower rise and fall times, in milliseconds
+// gate:    level below which the mic is muted, fraction of full scale
+//          (0 = no gate). Closes at half this, for hysteresis.
+void voiceAGC(float target, float maxGain, float attack, float release, float gate) {
+  agcOn          = false; // Interrupt leaves it alone while changing
+  float blockMs  = AGC_BLOCK * 1000.0 / sampleRate;
+  agcTargetLevel = (int32_t)(constrain(target, 0.0, 1.0) * 32767.0);
+  agcGainMax     = (int32_t)(constrain(maxGain, 1.0, 8.0) * AGC_UNITY);
+  gateLevel      = (int32_t)(constrain(gate, 0.0, 1.0) * 32767.0);
+  agcAttackK     = (int32_t)(65536.0 * (1.0 - exp(-blockMs / max(attack, blockMs))));
+  agcReleaseK    = (int32_t)(65536.0 * (1.0 - exp(-blockMs / max(release, blockMs))));
+  gateReleaseK   = (int32_t)(65536.0 * (1.0 - exp(-blockMs / GATE_RELEASE_MS)));
+  agcGain        = gateGain = voiceAgcGain = AGC_UNITY;
+  voiceGateOpen  = true;
+  agcOn          = (agcTargetLevel > 0) || (gateLevel > 0);
+}
+
 // SET MODULATION ----------------------------------------------------------
 
-// This needs to be called after any call to voicePitch() -- the modulation
-// table is not currently auto-regenerated. Maybe that'll change.
+// The modulation table is at the fixed output rate, so it doesn't need
+// regenerating when pitch changes.
 
 void voiceMod(uint32_t freq, uint8_t waveform) {
   if(modBuf) { // Ignore if no modulation buffer allocated
     if(freq < MOD_MIN) freq = MOD_MIN;
-    modLen = (uint32_t)(actualPlaybackRate / freq + 0.5);
+    modLen = (AUDIO_OUT_RATE + freq / 2) / freq;
     if(modLen   < 2) modLen   = 2;
     if(waveform > 4) waveform = 4;
     modWave = waveform;
@@ -171,6 +222,30 @@ void voiceMod(uint32_t freq, uint8_t waveform) {
 
 // INTERRUPT HANDLERS ------------------------------------------------------
 
+// End of an AGC block: update level, gate and gain
+static void agcBlock(void) {
+  agcDC    += ((int32_t)((agcSum / AGC_BLOCK) << 8) - agcDC) >> 7; // ~90 ms
+  agcLevel += ((int64_t)(agcPeak - agcLevel) * ((agcPeak > agcLevel) ? agcAttackK : agcReleaseK)) >> 16;
+  if(gateLevel) {
+    if(agcPeak > gateEnv) gateEnv  = agcPeak;
+    else                  gateEnv += ((int64_t)(agcPeak - gateEnv) * gateReleaseK) >> 16;
+    if(gateEnv >= gateLevel)         voiceGateOpen = true;
+    else if(gateEnv < gateLevel / 2) voiceGateOpen = false;
+  }
+  if(agcTargetLevel && voiceGateOpen) {
+    int32_t g = agcLevel ? (agcTargetLevel << 12) / agcLevel : agcGainMax;
+    agcGain   = (g > agcGainMax) ? agcGainMax : (g < AGC_UNITY / 8) ? AGC_UNITY / 8 : g;
+  }
+  // Gate opens over the attack time and fades out over GATE_RELEASE_MS
+  int32_t to    = voiceGateOpen ? AGC_UNITY : 0;
+  gateGain     += ((to - gateGain) * (voiceGateOpen ? agcAttackK : gateReleaseK)) >> 16;
+  if(abs(to - gateGain) < AGC_UNITY / 256) gateGain = to; // Steps round to 0 near the end
+  voiceAgcGain  = (agcGain * gateGain) >> 12;
+  agcSum        = 0;
+  agcPeak       = 0;
+  agcCount      = 0;
+}
+
 void PDM_SERCOM_HANDLER(void) {
   uint16_t micReading = 0;
   if(pdmspi.decimateFilterWord(&micReading, true)) {
@@ -186,6 +261,19 @@ void PDM_SERCOM_HANDLER(void) {
     // some "maybe good enough approximation for a hacky microcontroller
     // project" code here, but it's pulled out for now for the sake of
     // getting something not-broken in folks' hands in a sensible timeframe.
+    if(agcOn) {
+      uint32_t startTime = DWT->CYCCNT;
+      int32_t  x         = (int32_t)micReading - (agcDC >> 8);
+      agcSum += micReading;
+      if(x > agcPeak)       agcPeak = x;
+      else if(-x > agcPeak) agcPeak = -x;
+      x = (x * voiceAgcGain) >> 12;
+      micReading = (x > 32767) ? 65535 : (x < -32768) ? 0 : (x + 32768);
+      if(++agcCount >= AGC_BLOCK) agcBlock();
+      voiceAgcCycles += DWT->CYCCNT - startTime;
+      voiceAgcSamples++;
+    }
+
     if(++recIndex >= recBufSize) recIndex = 0;
     recBuf[recIndex] = micReading;
 
@@ -205,12 +293,30 @@ void PDM_SERCOM_HANDLER(void) {
   }
 }
 
+// Recording resampled at a 16.16 position (see resample.cpp), -32768 to
+// +32767. The FIR's taps reach RS_TAPS/2 samples either side, which the
+// splice thresholds keep well clear of the recording index.
+static int16_t recAt(uint32_t pos) {
+  int16_t x[RS_TAPS];
+  int16_t i = (int16_t)(pos >> 16) - (RS_TAPS / 2 - 1);
+  if(i < 0) i += recBufSize;
+  for(uint8_t k=0; k<RS_TAPS; k++) {
+    x[k] = (int32_t)recBuf[i] - 32768;
+    if(++i >= recBufSize) i = 0;
+  }
+  return rsInterp(x, pos & 0xFFFF);
+}
+
+static inline uint32_t advance(uint32_t pos) {
+  pos += playbackStep;
+  return (pos >= recBufEnd) ? (pos - recBufEnd) : pos;
+}
+
 static void voiceOutCallback(void) {
 
   // Modulation is done on the output (rather than the input) because
   // pitch-shifting modulated input would cause weird waveform
-  // discontinuities. This does require recalculating the modulation table
-  // any time the pitch changes though.
+  // discontinuities.
   if(modWave) {
     nextOut = (((int32_t)nextOut - 2048) * (modBuf[modIndex] + 1) / 256) + 2048;
     if(++modIndex >= modLen) modIndex = 0;
@@ -221,41 +327,49 @@ static void voiceOutCallback(void) {
   analogWrite(A1, nextOut);
   // Then we can take whatever variable time for processing the next cycle...
 
-  if(++playbackIndex >= recBufSize) playbackIndex = 0;
+  playbackPos = advance(playbackPos);
 
+  int32_t s;
   if(jumping) {
     // A waveform-blending transition is in-progress
-    uint32_t w1 = 65536UL * jumpCount / jump, // ramp playbackIndexJumped up (14 bits)
-             w2 = 65536UL - w1;               // ramp playbackIndex down (14 bits)
-    nextOut = (recBuf[playbackIndexJumped] * w1 + recBuf[playbackIndex] * w2) >> 20; // 28 bit result->12 bits
+    int32_t w1 = 32768L * jumpCount / jump, // ramp playbackPosJumped up (15 bits)
+            w2 = 32768L - w1;               // ramp playbackPos down (15 bits)
+    s          = (recAt(playbackPosJumped) * w1 + recAt(playbackPos) * w2) >> 15;
     if(++jumpCount >= jump) {
-      playbackIndex = playbackIndexJumped;
-      jumpCount     = 1;
-      jumping       = false;
+      playbackPos = playbackPosJumped;
+      jumpCount   = 1;
+      jumping     = false;
     } else {
-      if(++playbackIndexJumped >= recBufSize) playbackIndexJumped = 0;
+      playbackPosJumped = advance(playbackPosJumped);
     }
   } else {
-    nextOut = recBuf[playbackIndex] >> 4; // 16->12 bit
-    if(playbackRate >= sampleRate) { // Sped up
+    s = recAt(playbackPos);
+    int16_t playbackIndex = playbackPos >> 16;
+    if(playbackStep >= 0x10000) { // Sped up
       // Playback may overtake recording, need to back off periodically
       int16_t dist = (recIndex >= playbackIndex) ?
         (recIndex - playbackIndex) : (recBufSize - (playbackIndex - recIndex));
       if(dist <= jumpThreshold) {
-        playbackIndexJumped = playbackIndex - jump;
-        if(playbackIndexJumped < 0) playbackIndexJumped += recBufSize;
-        jumping             = true;
+        playbackPosJumped = playbackPos + recBufEnd - ((uint32_t)jump << 16);
+        if(playbackPosJumped >= recBufEnd) playbackPosJumped -= recBufEnd;
+        jumping           = true;
+        voiceSplices++;
       }
     } else { // Slowed down
       // Playback may underflow recording, need to advance periodically
       int16_t dist = (playbackIndex >= recIndex) ?
         (playbackIndex - recIndex) : (recBufSize - 1 - (recIndex - playbackIndex));
       if(dist <= jumpThreshold) {
-        playbackIndexJumped = (playbackIndex + jump) % recBufSize;
-        jumping             = true;
+        playbackPosJumped = playbackPos + ((uint32_t)jump << 16);
+        if(playbackPosJumped >= recBufEnd) playbackPosJumped -= recBufEnd;
+        jumping           = true;
+        voiceSplices++;
       }
     }
   }
+
+  if(fxStages) s = fxProcess(s); // Effect chain (voicefx.cpp)
+  nextOut = (s + 32768) >> 4;    // 16->12 bit
 }
 
 #endif // ADAFRUIT_MONSTER_M4SK_EXPRESS
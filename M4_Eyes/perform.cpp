@@ -0,0 +1,330 @@
+// SPDX-FileCopyrightText: 2024 Monster Mask Open Claw Project
+//
+// SPDX-License-Identifier: MIT
+
+// Performance recorder and player. Whatever is steering the eyes (random
+// motion, pursuit of a sensor, serial puppeteering, buttons), performFrame()
+// sees the resulting gaze, pupil, saccade state and blinks once per frame
+// and can save them; played back, the same hooks substitute the saved
+// values frame by frame. Like sensorlog.cpp, the render path only touches
+// a RAM ring and performService(), called from loop(), moves blocks
+// between it and the file. Playback reads its first block when started,
+// so the first frame needs no load.
+//
+// Each frame is a flags byte followed by only what changed, as zigzag
+// varints: gaze X/Y deltas (1/4096 of the map radius), pupil delta (1/512),
+// a blink (eye mask, duration in ms) and a new frame interval (ms). Frames
+// with no changes are run-length coded, up to 127 in one byte, so a still
+// eye costs next to nothing and a busy one a few bytes per frame. The
+// frame interval is only re-sent when the running total strays more than
+// PERFORM_SLACK ms from the real frame times.
+
+#include "globals.h"
+#include <string.h>
+
+#define PERFORM_RING_SIZE 2048 // Bytes, must be power of 2
+#define PERFORM_BLOCK      256 // File read/write size
+#define PERFORM_MAX_FRAME   24 // Longest encoded frame
+#define PERFORM_SLACK        4 // ms
+#define PERFORM_VERSION      1
+
+#define PF_X        0x01
+#define PF_Y        0x02
+#define PF_PUPIL    0x04
+#define PF_BLINK    0x08
+#define PF_INTERVAL 0x10
+#define PF_SACCADE  0x20 // Saccade state toggled
+#define PF_RUN      0x80 // Low 7 bits = count of unchanged frames
+
+static const char performMagic[4] = { 'M', '4', 'P', 'F' };
+static uint8_t    ring[PERFORM_RING_SIZE];
+static uint16_t   ringHead = 0, ringTail = 0; // Head = next write, tail = next read
+static File       performFile;
+static bool       fileDone;
+
+// Encoder/decoder state, identical on both sides. Kept together so the
+// player can decode a frame ahead and put it back if it's not due yet.
+typedef struct {
+  int32_t  gazeX, gazeY, pupil; // Quantized
+  bool     saccade;
+  uint32_t interval;            // ms per frame
+  uint32_t frameTime;           // ms, sum of intervals so far
+  uint8_t  run;                 // Recording: unchanged frames pending;
+                                // playing: left to apply
+  uint8_t  blinkMask;           // Playing: blink to start this frame
+  uint16_t blinkMs;
+} performState;
+static performState st;
+static uint32_t     startTime;           // millis() at first frame
+static uint32_t     blinkSeen[NUM_EYES]; // Recording: startTime of each eye's
+                                         // last blink already saved
+uint8_t           performMode     = PERFORM_OFF;
+uint32_t          performFrames   = 0;
+uint32_t          performBytes    = 0;
+uint32_t          performOverruns = 0;  // Playback underruns, recording overflow
+
+// Ring helpers ---------------------------------------------------------------
+
+static inline uint16_t ringUsed(void) { return ringHead - ringTail; }
+
+static inline void putByte(uint8_t b) {
+  ring[ringHead++ & (PERFORM_RING_SIZE - 1)] = b;
+}
+
+static inline uint8_t getByte(void) {
+  return ring[ringTail++ & (PERFORM_RING_SIZE - 1)];
+}
+
+static void putVarint(int32_t v) {
+  uint32_t z = ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); // Zigzag
+  while(z >= 0x80) {
+    putByte(z | 0x80);
+    z >>= 7;
+  }
+  putByte(z);
+}
+
+static int32_t getVarint(void) {
+  uint32_t z = 0;
+  uint8_t  b, shift = 0;
+  do {
+    b      = getByte();
+    z     |= (uint32_t)(b & 0x7F) << shift;
+    shift += 7;
+  } while((b & 0x80) && (shift < 35));
+  return (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+}
+
+static void flushRun(void) {
+  if(st.run) {
+    putByte(PF_RUN | st.run);
+    st.run = 0;
+  }
+}
+
+// Per-frame hooks --------------------------------------------------------------
+
+static float pendingX, pendingY, pendingPupil; // Recording: this frame so far
+static bool  pendingSaccade;
+
+static void recordFrame(void) {
+  if(ringUsed() > (PERFORM_RING_SIZE - PERFORM_MAX_FRAME)) {
+    performOverruns++; // File writes fell behind; a gap would corrupt the
+    performStop();     // stream, so end the recording here
+    return;
+  }
+  if(!performFrames) startTime = millis(); // First frame is time 0
+  int32_t  qx  = (int32_t)((pendingX - mapRadius) * 4096.0 / mapRadius),
+           qy  = (int32_t)((pendingY - mapRadius) * 4096.0 / mapRadius),
+           qp  = (int32_t)(pendingPupil * 512.0);
+  uint32_t now = millis() - startTime, next = st.frameTime + st.interval;
+  uint8_t  flags = 0, mask = 0;
+  uint16_t ms = 0;
+  if(qx != st.gazeX)               flags |= PF_X;
+  if(qy != st.gazeY)               flags |= PF_Y;
+  if(qp != st.pupil)               flags |= PF_PUPIL;
+  if(pendingSaccade != st.saccade) flags |= PF_SACCADE;
+  for(uint8_t e=0; e<NUM_EYES; e++) {
+    if((eye[e].blink.state == ENBLINK) && (eye[e].blink.startTime != blinkSeen[e])) {
+      blinkSeen[e] = eye[e].blink.startTime;
+      mask        |= 1 << e;
+      ms           = eye[e].blink.duration / 1000;
+    }
+  }
+  if(mask) flags |= PF_BLINK;
+  if(((int32_t)(now - next) > PERFORM_SLACK) || ((int32_t)(next - now) > PERFORM_SLACK)) {
+    flags   |= PF_INTERVAL;
+    st.interval = (now > st.frameTime) ? (now - st.frameTime) : 0;
+  }
+  st.frameTime += st.interval;
+  performFrames++;
+  if(!flags) {
+    if(++st.run >= 0x7F) flushRun();
+    return;
+  }
+  flushRun();
+  putByte(flags);
+  if(flags & PF_X)        putVarint(qx - st.gazeX);
+  if(flags & PF_Y)        putVarint(qy - st.gazeY);
+  if(flags & PF_PUPIL)    putVarint(qp - st.pupil);
+  if(flags & PF_BLINK)  { putByte(mask); putVarint(ms); }
+  if(flags & PF_INTERVAL) putVarint(st.interval);
+  st.gazeX   = qx;
+  st.gazeY   = qy;
+  st.pupil   = qp;
+  st.saccade = pendingSaccade;
+}
+
+// Decode one frame into the state above. False if out of data.
+static bool decodeFrame(void) {
+  if(st.run) {
+    st.run--;
+  } else {
+    if(!fileDone && (ringUsed() < PERFORM_MAX_FRAME)) {
+      performOverruns++; // Reads fell behind; hold this frame
+      return false;
+    }
+    if(!ringUsed()) return false;
+    uint8_t flags = getByte();
+    if(flags & PF_RUN) {
+      st.run = (flags & 0x7F) - 1;
+    } else {
+      if(flags & PF_X)        st.gazeX += getVarint();
+      if(flags & PF_Y)        st.gazeY += getVarint();
+      if(flags & PF_PUPIL)    st.pupil += getVarint();
+      if(flags & PF_SACCADE)  st.saccade = !st.saccade;
+      if(flags & PF_BLINK)  { st.blinkMask |= getByte(); st.blinkMs = getVarint(); }
+      if(flags & PF_INTERVAL) st.interval = getVarint();
+    }
+  }
+  st.frameTime += st.interval;
+  performFrames++;
+  return true;
+}
+
+// Call at the start of each eyeball's frame with the position (map
+// coordinates), pupil and saccade state just worked out for it. While
+// playing, every eye gets the played values instead.
+void performFrame(uint8_t eyeNum, float *x, float *y, float *p, bool *s) {
+  if(performMode == PERFORM_OFF) return;
+  if(performMode == PERFORM_RECORD) {
+    if(!eyeNum) {
+      pendingX       = *x;
+      pendingY       = *y;
+      pendingPupil   = *p;
+      pendingSaccade = *s;
+    }
+    return;
+  }
+  if(!eyeNum) {
+    // Step through saved frames due by now, give or take half a frame, so
+    // equal frame rates step one saved frame per frame drawn. A frame's
+    // time is only known once decoded, so one too many is decoded and
+    // then put back.
+    if(!performFrames) startTime = millis(); // First frame is time 0
+    uint32_t now = millis() - startTime;
+    for(;;) {
+      performState saved = st;
+      uint16_t     tail  = ringTail;
+      if(!decodeFrame()) {
+        if(fileDone && !st.run && !ringUsed()) {
+          logMsg(LOG_PERFORM_DONE, performFrames);
+          performStop(); // Eyes carry on from live control
+          return;
+        }
+        break;
+      }
+      if((int32_t)(st.frameTime - now) > (int32_t)(st.interval / 2)) {
+        st       = saved; // Not due yet
+        ringTail = tail;
+        performFrames--;
+        break;
+      }
+    }
+  }
+  *x = mapRadius + (float)st.gazeX * mapRadius / 4096.0;
+  *y = mapRadius + (float)st.gazeY * mapRadius / 4096.0;
+  *p = (float)st.pupil / 512.0;
+  *s = st.saccade;
+}
+
+// Call after autonomous blinks have been started for this eyeball's
+// frame. Eye 0 completes the frame being recorded (so blinks land in the
+// frame they started), or starts any blink the playback has reached.
+void performBlinks(uint8_t eyeNum, uint32_t t) {
+  if(eyeNum) return;
+  if(performMode == PERFORM_RECORD) {
+    recordFrame();
+  } else if((performMode == PERFORM_PLAY) && st.blinkMask) {
+    for(uint8_t e=0; e<NUM_EYES; e++) {
+      if(st.blinkMask & (1 << e)) {
+        eye[e].blink.state     = ENBLINK;
+        eye[e].blink.startTime = t;
+        eye[e].blink.duration  = st.blinkMs * 1000;
+      }
+    }
+    st.blinkMask = 0;
+  }
+}
+
+// Start/stop, file side ------------------------------------------------------
+
+static void reset(uint8_t mode) {
+  ringHead  = ringTail = 0;
+  fileDone  = false;
+  st.gazeX     = st.gazeY = 0;
+  st.pupil     = 256;
+  st.saccade   = false;
+  st.interval  = st.frameTime = 0;
+  st.run       = st.blinkMask = 0;
+  startTime = millis(); // Reset again at the first frame
+  for(uint8_t e=0; e<NUM_EYES; e++) blinkSeen[e] = eye[e].blink.startTime;
+  performFrames = performBytes = performOverruns = 0;
+  performMode   = mode;
+}
+
+// Write one block if there's that much, or everything if 'all'
+static void ringWrite(bool all) {
+  while(ringUsed() >= (all ? 1 : PERFORM_BLOCK)) {
+    uint16_t i = ringTail & (PERFORM_RING_SIZE - 1), n = ringUsed();
+    if(n > PERFORM_BLOCK)           n = PERFORM_BLOCK;
+    if(n > (PERFORM_RING_SIZE - i)) n = PERFORM_RING_SIZE - i;
+    performFile.write(&ring[i], n);
+    ringTail     += n;
+    performBytes += n;
+    if(!all) break;
+  }
+}
+
+static void ringRead(void) {
+  // Reads are whole blocks until the last, and the block size divides
+  // the ring size, so a read never wraps.
+  if((PERFORM_RING_SIZE - ringUsed()) < PERFORM_BLOCK) return;
+  int got = performFile.read(&ring[ringHead & (PERFORM_RING_SIZE - 1)], PERFORM_BLOCK);
+  if(got > 0) {
+    ringHead     += got;
+    performBytes += got;
+  }
+  if(got < PERFORM_BLOCK) fileDone = true;
+}
+
+bool performRecord(const char *filename) {
+  performStop();
+  if(!(performFile = arcada.open(filename, O_WRITE | O_CREAT | O_TRUNC))) return false;
+  uint16_t hdr[2] = { PERFORM_VERSION, 0 };
+  performFile.write(performMagic, sizeof performMagic);
+  performFile.write(hdr, sizeof hdr);
+  reset(PERFORM_RECORD);
+  return true;
+}
+
+bool performPlay(const char *filename) {
+  char     magic[4];
+  uint16_t hdr[2];
+  performStop();
+  if(!(performFile = arcada.open(filename, O_READ))) return false;
+  if((performFile.read(magic, sizeof magic) != sizeof magic) ||
+     (performFile.read(hdr, sizeof hdr) != sizeof hdr) ||
+     memcmp(magic, performMagic, sizeof magic) || (hdr[0] != PERFORM_VERSION)) {
+    performFile.close();
+    return false;
+  }
+  reset(PERFORM_PLAY);
+  while(!fileDone && (ringUsed() <= (PERFORM_RING_SIZE - PERFORM_BLOCK))) ringRead();
+  return true;
+}
+
+void performStop(void) {
+  if(performMode == PERFORM_RECORD) {
+    flushRun();
+    ringWrite(true);
+  }
+  if(performMode != PERFORM_OFF) performFile.close();
+  performMode = PERFORM_OFF;
+}
+
+// Called from loop() between rendering
+void performService(void) {
+  if(performMode == PERFORM_RECORD)                  ringWrite(false);
+  else if((performMode == PERFORM_PLAY) && !fileDone) ringRead();
+}
@@ -0,0 +1,113 @@
+// SPDX-FileCopyrightText: 2024 Monster Mask Open Claw Project
+//
+// SPDX-License-Identifier: MIT
+
+// Smooth pursuit for user-controlled gaze (moveEyesRandomly = false).
+// Rather than mapping eyeTargetX/Y straight to eye position each frame,
+// each new target reading goes through an alpha-beta filter (position
+// plus velocity), and the eye is drawn where the filter predicts the
+// target will be when the frame is actually seen: the configured sensor
+// latency plus the measured time to draw a frame. Noisy readings are
+// smoothed, and a slow sensor no longer leaves the eyes trailing behind.
+// A reading too far from the prediction to be a smooth move starts a
+// saccade instead: an eased jump, as in the autonomous motion, that
+// lands on the moving prediction.
+//
+// A "new reading" is any change in eyeTargetX/Y; a target that stays put
+// is re-read every PURSUIT_HOLD uS so velocity decays to zero.
+
+#include "globals.h"
+
+#define PURSUIT_HOLD      250000 // uS, unchanged target counts as a new reading
+#define PURSUIT_MAX_DT    500000 // uS, longer gap restarts the filter
+#define SACCADE_BASE_US    50000 // uS, saccade duration, plus...
+#define SACCADE_PER_UNIT   60000 // ...this per unit (half the range) moved
+
+static struct {
+  float pos, vel; // Filter state, target units and units per uS
+  float last;     // Last reading, for change detection
+} axis[2];
+static uint32_t lastReadTime  = 0;     // Time of last filter update
+static uint32_t lastCallTime  = 0;
+static float    callInterval  = 0.0;   // Average uS between calls (eyeballs)
+static bool     started       = false;
+static bool     saccade       = false;
+static uint32_t saccadeStart;
+static uint32_t saccadeDuration;
+static float    saccadeFrom[2];
+static float    lastOut[2]    = { 0.0, 0.0 }; // Last position returned
+
+static void filterUpdate(uint32_t t, float x, float y) {
+  float z[2] = { x, y };
+  uint32_t dt = t - lastReadTime;
+  for(uint8_t i=0; i<2; i++) {
+    float p = axis[i].pos + axis[i].vel * dt; // Predict to now...
+    float r = z[i] - p;                       // ...and correct by residual
+    axis[i].pos  = p + pursuitAlpha * r;
+    axis[i].vel += pursuitBeta * r / dt;
+    axis[i].last = z[i];
+  }
+  lastReadTime = t;
+}
+
+static void filterReset(uint32_t t, float x, float y) {
+  axis[0].pos  = axis[0].last = x;
+  axis[1].pos  = axis[1].last = y;
+  axis[0].vel  = axis[1].vel  = 0.0;
+  lastReadTime = t;
+}
+
+// Called at the start of each eyeball's frame with the current time.
+// Sets the gaze position to draw (-1.0 to +1.0 on each axis, like
+// eyeTargetX/Y) and returns true while a saccade is in progress.
+bool pursuitUpdate(uint32_t t, float *x, float *y) {
+  if(!started) {
+    filterReset(t, eyeTargetX, eyeTargetY);
+    lastCallTime = t;
+    started      = true;
+  }
+  // Frames are drawn one eyeball at a time, so an eyeball's image is
+  // seen about NUM_EYES call intervals after its position is chosen.
+  callInterval = (callInterval * 15.0 + (float)(t - lastCallTime)) / 16.0;
+  lastCallTime = t;
+
+  uint32_t dt = t - lastReadTime;
+  if(dt >= PURSUIT_MAX_DT) {
+    filterReset(t, eyeTargetX, eyeTargetY);
+  } else if(dt && ((eyeTargetX != axis[0].last) || (eyeTargetY != axis[1].last) ||
+                   (dt >= PURSUIT_HOLD))) {
+    // Compare with where the target was expected before updating
+    float ex = eyeTargetX - (axis[0].pos + axis[0].vel * dt),
+          ey = eyeTargetY - (axis[1].pos + axis[1].vel * dt),
+          d  = sqrt(ex * ex + ey * ey);
+    if(!saccade && (d > pursuitSaccade)) {
+      // Too far to follow smoothly: jump from where the eye is now
+      saccadeFrom[0]  = lastOut[0];
+      saccadeFrom[1]  = lastOut[1];
+      saccadeStart    = t;
+      saccadeDuration = SACCADE_BASE_US + (uint32_t)(SACCADE_PER_UNIT * d);
+      saccade         = true;
+      filterReset(t, eyeTargetX, eyeTargetY);
+    } else {
+      filterUpdate(t, eyeTargetX, eyeTargetY);
+    }
+  }
+
+  float ahead = (float)(t - lastReadTime) + pursuitLatency * 1000.0 + callInterval * NUM_EYES;
+  float px    = constrain(axis[0].pos + axis[0].vel * ahead, -1.0, 1.0),
+        py    = constrain(axis[1].pos + axis[1].vel * ahead, -1.0, 1.0);
+  if(saccade) {
+    uint32_t st = t - saccadeStart;
+    if(st >= saccadeDuration) {
+      saccade = false;
+    } else {
+      float e = (float)st / (float)saccadeDuration;
+      e  = 3 * e * e - 2 * e * e * e; // Same easing as autonomous moves
+      px = saccadeFrom[0] + (px - saccadeFrom[0]) * e;
+      py = saccadeFrom[1] + (py - saccadeFrom[1]) * e;
+    }
+  }
+  *x = lastOut[0] = px;
+  *y = lastOut[1] = py;
+  return saccade;
+}
@@ -4,8 +4,10 @@
 
 // Runtime eye configuration reload with texture caching.
 // Allows switching between mood config files without rebooting.
-// Geometry (eyeRadius, irisRadius, slitPupilRadius) is kept fixed
-// to avoid regenerating the ~125KB polar lookup tables.
+// Geometry (eyeRadius, slitPupilRadius) is kept fixed to avoid
+// regenerating the ~125KB polar lookup tables. Iris size may change,
+// it only affects each eye's small distance LUT (unless the boot config
+// used a slit pupil, which bakes iris size into the tables).
 
 #include "globals.h"
 #include <string.h>
@@ -41,7 +43,7 @@ static TextureCacheEntry *findCachedTexture(const char *filename) {
 static void addCachedTexture(const char *filename, uint16_t *data,
                              uint16_t width, uint16_t height) {
   if (numCached >= MAX_CACHED_TEXTURES) {
-    Serial.println("RELOAD: Texture cache full, not caching");
+    logMsg(LOG_RELOAD_CACHE_FULL);
     return;
   }
   TextureCacheEntry *entry = &textureCache[numCached++];
@@ -54,11 +56,12 @@ static void addCachedTexture(const char *filename, uint16_t *data,
 
 // Load a texture, using cache if available.
 // Returns IMAGE_SUCCESS on success. On failure, sets data/width/height to
-// the fallback color pointer.
+// the fallback color pointer; failures for lack of flash (IMAGE_ERR_MALLOC)
+// are only logged if the caller can't retry.
 static ImageReturnCode loadTextureWithCache(char *filename, uint16_t **data,
                                             uint16_t *width, uint16_t *height,
                                             uint16_t *fallbackColor,
-                                            uint32_t maxRam) {
+                                            uint32_t maxRam, bool lastTry) {
   if (filename == NULL) {
     *data   = fallbackColor;
     *width  = 1;
@@ -68,19 +71,19 @@ static ImageReturnCode loadTextureWithCache(char *filename, uint16_t **data,
 
   TextureCacheEntry *cached = findCachedTexture(filename);
   if (cached) {
-    Serial.printf("RELOAD: Texture cache hit: %s\n", filename);
+    logStr(LOG_RELOAD_CACHE_HIT, filename);
     *data   = cached->data;
     *width  = cached->width;
     *height = cached->height;
     return IMAGE_SUCCESS;
   }
 
-  Serial.printf("RELOAD: Loading texture: %s\n", filename);
+  logStr(LOG_RELOAD_TEXTURE, filename);
   ImageReturnCode status = loadTexture(filename, data, width, height, maxRam);
   if (status == IMAGE_SUCCESS) {
     addCachedTexture(filename, *data, *width, *height);
   } else {
-    Serial.printf("RELOAD: Texture load failed: %s\n", filename);
+    if (lastTry || (status != IMAGE_ERR_MALLOC)) logStr(LOG_RELOAD_TEXTURE_FAIL, filename);
     *data   = fallbackColor;
     *width  = 1;
     *height = 1;
@@ -98,21 +101,21 @@ void initReloadState(void) {
     // so we can't seed the cache retroactively. That's OK — the first
     // mood switch will populate the cache.
   }
-  Serial.println("RELOAD: Mood reload system initialized");
+  logMsg(LOG_RELOAD_INIT);
 }
 
 void reloadEyeConfig(const char *configPath) {
   uint8_t e;
   uint32_t timeout;
 
-  Serial.printf("RELOAD: Starting reload with config: %s\n", configPath);
+  logStr(LOG_RELOAD_START, configPath);
 
   // 1. Wait for all eyes' DMA to finish
   for (e = 0; e < NUM_EYES; e++) {
     timeout = millis();
     while (eye[e].dma_busy) {
       if ((millis() - timeout) > 100) {
-        Serial.printf("RELOAD: DMA timeout on eye %d, forcing\n", e);
+        logMsg(LOG_RELOAD_DMA_TIMEOUT, e);
         eye[e].dma.fix();
         eye[e].dma_busy = false;
         break;
@@ -122,13 +125,12 @@ void reloadEyeConfig(const char *configPath) {
 
   // 2. End SPI transactions on both eyes
   for (e = 0; e < NUM_EYES; e++) {
-    digitalWrite(eye[e].cs, HIGH);  // Deselect
-    eye[e].spi->endTransaction();
+    displayRelease(&eye[e]);
   }
 
   // 3. Free old dynamic allocations (eyelid filenames, texture filenames)
-  // Note: texture data lives in flash and cannot be freed — that's what
-  // the cache is for. Eyelid filenames and texture filenames from the
+  // Note: texture data lives in flash and isn't freed here — the cache
+  // reuses it, and step 6 reclaims it all if flash runs out. Eyelid filenames and texture filenames from the
   // previous loadConfig are already freed in the original setup flow,
   // but loadConfig will strdup new ones.
   // We need to free any filenames that loadConfig will allocate.
@@ -151,18 +153,24 @@ void reloadEyeConfig(const char *configPath) {
     eye[e].iris.filename     = NULL;
     eye[e].iris.startAngle   = (e & 1) ? 512 : 0;
     eye[e].iris.angle        = eye[e].iris.startAngle;
+    eye[e].iris.fineAngle    = (uint32_t)eye[e].iris.startAngle << 10;
     eye[e].iris.mirror       = 0;
     eye[e].iris.spin         = 0.0;
     eye[e].iris.iSpin        = 0;
+    eye[e].iris.filter       = false;
     eye[e].sclera.color      = 0xFFFF;
     eye[e].sclera.data       = NULL;
     eye[e].sclera.filename   = NULL;
     eye[e].sclera.startAngle = (e & 1) ? 512 : 0;
     eye[e].sclera.angle      = eye[e].sclera.startAngle;
+    eye[e].sclera.fineAngle  = (uint32_t)eye[e].sclera.startAngle << 10;
     eye[e].sclera.mirror     = 0;
     eye[e].sclera.spin       = 0.0;
     eye[e].sclera.iSpin      = 0;
+    eye[e].sclera.filter     = false;
     eye[e].rotation          = 3;
+    eye[e].irisRadius        = 0.0;
+    eye[e].lutRadius         = -1.0; // Rebuild distLUT[] on next frame
     eye[e].blink.state       = NOBLINK;
     eye[e].blinkFactor       = 0.0;
   }
@@ -173,8 +181,18 @@ void reloadEyeConfig(const char *configPath) {
   gazeMax     = 3000000;
   irisMin     = 0.45;
   irisRange   = 0.35;
+  irisBreathe       = 0.0;
+  irisBreathePeriod = 4.0;
+  foveate           = true;
+  interlace         = true;
+  pursuit           = true;
+  pursuitAlpha      = 0.5;
+  pursuitBeta       = 0.2;
+  pursuitLatency    = 50.0;
+  pursuitSaccade    = 0.5;
+  logLevel          = LOG_INFO;
 
-  // 5. Load new config (preserves eyeRadius/irisRadius/slitPupilRadius geometry)
+  // 5. Load new config (preserves eyeRadius/slitPupilRadius geometry)
   //    Save geometry before loadConfig overwrites it
   int savedEyeRadius       = eyeRadius;
   int savedEyeDiameter     = eyeDiameter;
@@ -189,60 +207,78 @@ void reloadEyeConfig(const char *configPath) {
   // Restore fixed geometry — do NOT allow config to change these
   eyeRadius       = savedEyeRadius;
   eyeDiameter     = savedEyeDiameter;
-  irisRadius      = savedIrisRadius;
   slitPupilRadius = savedSlitPupilRadius;
+  if (slitPupilRadius > 0) { // Iris size is baked into slit pupil map
+    irisRadius = savedIrisRadius;
+    for (e = 0; e < NUM_EYES; e++) eye[e].irisRadius = irisRadius;
+  }
   mapRadius       = savedMapRadius;
   mapDiameter     = savedMapDiameter;
   coverage        = savedCoverage;
 
-  Serial.println("RELOAD: Config loaded, loading textures...");
+  logMsg(LOG_RELOAD_CONFIG);
 
-  // 6. Load textures with cache
+  // 6. Load textures with cache. If internal flash fills up, the eyes
+  //    aren't drawing, so every texture there (boot, cached, or just
+  //    loaded) can go: empty the cache, reclaim the flash, start over.
+  //    Audio players only read flash in the main loop, never their ISRs,
+  //    so audioService keeps them fed between loads without any overlap.
   uint32_t maxRam = availableRAM() - stackReserve;
   uint8_t e2;
 
-  for (e = 0; e < NUM_EYES; e++) {
-    yield();
-    // Check if this eye shares iris texture with a prior eye
-    bool shared = false;
-    for (e2 = 0; e2 < e; e2++) {
-      if ((eye[e].iris.filename && eye[e2].iris.filename) &&
-          (!strcmp(eye[e].iris.filename, eye[e2].iris.filename))) {
-        eye[e].iris.data   = eye[e2].iris.data;
-        eye[e].iris.width  = eye[e2].iris.width;
-        eye[e].iris.height = eye[e2].iris.height;
-        shared = true;
-        break;
+  for (uint8_t pass = 0; pass < 2; pass++) {
+    bool flashFull = false;
+    for (e = 0; e < NUM_EYES; e++) {
+      yield();
+      if (audioService) audioService();
+      // Check if this eye shares iris texture with a prior eye
+      bool shared = false;
+      for (e2 = 0; e2 < e; e2++) {
+        if ((eye[e].iris.filename && eye[e2].iris.filename) &&
+            (!strcmp(eye[e].iris.filename, eye[e2].iris.filename))) {
+          eye[e].iris.data   = eye[e2].iris.data;
+          eye[e].iris.width  = eye[e2].iris.width;
+          eye[e].iris.height = eye[e2].iris.height;
+          shared = true;
+          break;
+        }
+      }
+      if (!shared) {
+        flashFull |= (loadTextureWithCache(eye[e].iris.filename, &eye[e].iris.data,
+                        &eye[e].iris.width, &eye[e].iris.height,
+                        &eye[e].iris.color, maxRam, pass) == IMAGE_ERR_MALLOC);
       }
-    }
-    if (!shared) {
-      loadTextureWithCache(eye[e].iris.filename, &eye[e].iris.data,
-                           &eye[e].iris.width, &eye[e].iris.height,
-                           &eye[e].iris.color, maxRam);
-    }
 
-    // Repeat for sclera
-    shared = false;
-    for (e2 = 0; e2 < e; e2++) {
-      if ((eye[e].sclera.filename && eye[e2].sclera.filename) &&
-          (!strcmp(eye[e].sclera.filename, eye[e2].sclera.filename))) {
-        eye[e].sclera.data   = eye[e2].sclera.data;
-        eye[e].sclera.width  = eye[e2].sclera.width;
-        eye[e].sclera.height = eye[e2].sclera.height;
-        shared = true;
-        break;
+      // Repeat for sclera
+      shared = false;
+      for (e2 = 0; e2 < e; e2++) {
+        if ((eye[e].sclera.filename && eye[e2].sclera.filename) &&
+            (!strcmp(eye[e].sclera.filename, eye[e2].sclera.filename))) {
+          eye[e].sclera.data   = eye[e2].sclera.data;
+          eye[e].sclera.width  = eye[e2].sclera.width;
+          eye[e].sclera.height = eye[e2].sclera.height;
+          shared = true;
+          break;
+        }
+      }
+      if (!shared) {
+        flashFull |= (loadTextureWithCache(eye[e].sclera.filename, &eye[e].sclera.data,
+                        &eye[e].sclera.width, &eye[e].sclera.height,
+                        &eye[e].sclera.color, maxRam, pass) == IMAGE_ERR_MALLOC);
       }
     }
-    if (!shared) {
-      loadTextureWithCache(eye[e].sclera.filename, &eye[e].sclera.data,
-                           &eye[e].sclera.width, &eye[e].sclera.height,
-                           &eye[e].sclera.color, maxRam);
+    if (!flashFull) break;
+    if (!pass) {
+      logMsg(LOG_RELOAD_RECLAIM);
+      numCached = 0;
+      textureFlashReclaim();
     }
   }
 
   // 7. Load eyelids
-  Serial.println("RELOAD: Loading eyelids...");
+  logMsg(LOG_RELOAD_EYELIDS);
   yield();
+  if (audioService) audioService();
   loadEyelid(upperEyelidFilename ?
     upperEyelidFilename : (char *)"upper.bmp",
     upperClosed, upperOpen, DISPLAY_SIZE - 1, maxRam);
@@ -261,13 +297,15 @@ void reloadEyeConfig(const char *configPath) {
   // 9. Reset rendering state
   for (e = 0; e < NUM_EYES; e++) {
     eye[e].colNum       = DISPLAY_SIZE; // Force wraparound to first column
+    eye[e].interlaced   = false;
     eye[e].colIdx       = 0;
     eye[e].dma_busy     = false;
     eye[e].column_ready = false;
     eye[e].eyeX         = mapRadius;
     eye[e].eyeY         = mapRadius;
     eye[e].display->setRotation(eye[e].rotation);
+    displayFastSetup(&eye[e]);
   }
 
-  Serial.printf("RELOAD: Complete! Free RAM: %d\n", availableRAM());
+  logMsg(LOG_RELOAD_DONE, availableRAM());
 }
@@ -0,0 +1,97 @@
+// SPDX-FileCopyrightText: 2024 Monster Mask Open Claw Project
+//
+// SPDX-License-Identifier: MIT
+
+// Fixed-point polyphase resampler. All audio goes out to the DACs at one
+// fixed rate, AUDIO_OUT_RATE, whatever rate it was recorded or stored at:
+// WAV files at their own sample rate, the voice changer's mic at its PDM
+// decimation rate with pitch shift as a resampling ratio. So the playback
+// timer never has to be reprogrammed per source, and sources at different
+// rates can share it.
+//
+// Each output sample is an RS_TAPS-point FIR over the input around its
+// fractional position, using whichever of RS_PHASES precomputed filters
+// is nearest that fraction (windowed sinc, Q15, each phase normalized to
+// unity DC gain). One filter bank, built once, is shared by everything.
+// Its cutoff suits upsampling and ratios near 1; reading input more than
+// a little faster than real time (pitch well up) isn't band-limited, and
+// aliases as simply playing the input faster always did.
+//
+// rsInterp() does one output from taps in a buffer of the caller's; the
+// resampler struct wraps it for sources that are pushed a sample at a time.
+
+#include "globals.h"
+#include <string.h>
+
+#define RS_PHASE_BITS 6
+#define RS_PHASES     (1 << RS_PHASE_BITS)
+#define RS_CUTOFF     0.45 // Fraction of input sample rate
+
+static int16_t rsCoef[RS_PHASES][RS_TAPS];
+static bool    rsCoefReady = false;
+
+// Build filter bank, if not already. Float math, so call before starting
+// any interrupt that uses rsInterp(); rsInit() calls it too.
+void rsBegin(void) {
+  if(rsCoefReady) return;
+  for(uint8_t p=0; p<RS_PHASES; p++) {
+    float frac = (float)p / RS_PHASES, h[RS_TAPS], sum = 0.0;
+    for(uint8_t k=0; k<RS_TAPS; k++) {
+      // Tap k is this many input samples from the output position:
+      float t = (float)k - (RS_TAPS / 2 - 1) - frac;
+      float x = M_PI * 2.0 * RS_CUTOFF * t;
+      float w = 0.42 + 0.5 * cos(M_PI * t / (RS_TAPS / 2)) +
+                0.08 * cos(2.0 * M_PI * t / (RS_TAPS / 2)); // Blackman
+      h[k]    = ((fabs(x) < 1.0e-6) ? 1.0 : (sin(x) / x)) * w;
+      sum    += h[k];
+    }
+    for(uint8_t k=0; k<RS_TAPS; k++) {
+      rsCoef[p][k] = (int16_t)lrintf(h[k] / sum * 32767.0);
+    }
+  }
+  rsCoefReady = true;
+}
+
+// One output sample from RS_TAPS input samples x[] (oldest first), at
+// 'frac' (0-65535) of the way from x[RS_TAPS/2-1] to x[RS_TAPS/2].
+int16_t rsInterp(const int16_t *x, uint16_t frac) {
+  const int16_t *c   = rsCoef[frac >> (16 - RS_PHASE_BITS)];
+  int32_t        sum = 0;
+  for(uint8_t k=0; k<RS_TAPS; k++) sum += x[k] * c[k];
+  sum >>= 15;
+  if(sum > 32767)       return 32767;
+  else if(sum < -32768) return -32768;
+  return sum;
+}
+
+// Convert 'ratio' input samples per output sample to 16.16 fixed point,
+// clipped to sensible range, e.g. a 22,050 Hz WAV is 22050.0 /
+// AUDIO_OUT_RATE. 2.0 plays input twice as fast (an octave up).
+uint32_t rsStep(float ratio) {
+  if(ratio < 0.25)     ratio = 0.25;
+  else if(ratio > 4.0) ratio = 4.0;
+  return (uint32_t)(ratio * 65536.0 + 0.5);
+}
+
+// Reset a pushed-input resampler to silence at the given ratio.
+void rsInit(resampler *r, float ratio) {
+  rsBegin();
+  memset(r->hist, 0, sizeof r->hist);
+  r->head = 0;
+  r->pos  = 0;
+  r->step = rsStep(ratio);
+}
+
+// Add the next input sample. Call while rsNeedsInput() is true, then
+// rsOut() for the output sample.
+void rsPush(resampler *r, int16_t s) {
+  r->hist[r->head] = r->hist[r->head + RS_TAPS] = s; // Twice, so taps are contiguous
+  if(++r->head >= RS_TAPS) r->head = 0;
+  r->pos -= 0x10000;
+}
+
+int16_t rsOut(resampler *r) {
+  int16_t s = rsInterp(&r->hist[r->head], r->pos & 0xFFFF);
+  r->pos += r->step;
+  return s;
+}
@@ -0,0 +1,171 @@
+// SPDX-FileCopyrightText: 2024 Monster Mask Open Claw Project
+//
+// SPDX-License-Identifier: MIT
+
+// Sensor record and replay. Each place a sensor is read passes its value
+// through sensorSample(). While recording, a changed value is stamped with
+// milliseconds since the start and queued in a small RAM ring; nothing
+// touches the filesystem there. sensorLogService(), called from loop()
+// alongside logDrain(), writes the queue out in blocks. While replaying,
+// sensorLogService() keeps the ring filled from the file, and
+// sensorSample() returns the most recent recorded value for that sensor
+// instead of the live one, so filtering, threshold and auto-ranging
+// changes can be compared against identical inputs. Sensors with nothing
+// in the recording read live as usual.
+//
+// File format: an 8-byte header ("M4SL", version, record size) then
+// fixed-size sensorRecord structs, little-endian as in RAM.
+
+#include "globals.h"
+#include <string.h>
+
+#define SENSOR_RING_SIZE   64 // Records, must be power of 2
+#define SENSOR_WRITE_MIN   32 // Write to file once this many are queued...
+#define SENSOR_WRITE_MS   500 // ...or the oldest has waited this long
+#define SENSOR_SYNC_MS   5000 // Update the file's directory entry this often
+#define SENSOR_VERSION      1
+
+typedef struct {
+  uint32_t ms;          // Since start of recording
+  uint8_t  id;          // SENSOR_* from globals.h
+  uint8_t  reserved[3];
+  int32_t  value;
+} sensorRecord;
+
+static const char   sensorMagic[4] = { 'M', '4', 'S', 'L' };
+static sensorRecord ring[SENSOR_RING_SIZE];
+static uint16_t     ringHead = 0, ringTail = 0; // Head = next write, tail = next read
+static File         logFile;
+static uint32_t     startMs, lastWriteMs, lastSyncMs;
+static int32_t      value[SENSOR_NUM_IDS];      // Last recorded/replayed
+static bool         have[SENSOR_NUM_IDS];
+static bool         fileDone;                   // Replay: no more to read
+uint8_t             sensorLogMode    = SENSOR_OFF;
+uint32_t            sensorLogRecords = 0;       // Written or replayed
+uint32_t            sensorLogDropped = 0;       // Ring full while recording
+
+static void ringWrite(void) {
+  // Contiguous run from the tail, up to the end of the ring array
+  uint16_t n = ringHead - ringTail, i = ringTail & (SENSOR_RING_SIZE - 1);
+  if(n > (SENSOR_RING_SIZE - i)) n = SENSOR_RING_SIZE - i;
+  if(n) {
+    logFile.write(&ring[i], n * sizeof(sensorRecord));
+    ringTail         += n;
+    sensorLogRecords += n;
+  }
+  lastWriteMs = millis();
+}
+
+static void ringRead(void) {
+  uint16_t n = SENSOR_RING_SIZE - (uint16_t)(ringHead - ringTail),
+           i = ringHead & (SENSOR_RING_SIZE - 1);
+  if(n > (SENSOR_RING_SIZE - i)) n = SENSOR_RING_SIZE - i;
+  if(n < (SENSOR_RING_SIZE / 4)) return; // Wait for room for a decent block
+  int got = logFile.read(&ring[i], n * sizeof(sensorRecord));
+  if(got > 0) ringHead += got / sizeof(sensorRecord);
+  if(got < (int)(n * sizeof(sensorRecord))) fileDone = true;
+}
+
+// Apply replay records that are due, up to the current time
+static void replayDue(void) {
+  uint32_t now = millis() - startMs;
+  while(ringTail != ringHead) {
+    sensorRecord *r = &ring[ringTail & (SENSOR_RING_SIZE - 1)];
+    if((int32_t)(r->ms - now) > 0) break;
+    if(r->id < SENSOR_NUM_IDS) {
+      value[r->id] = r->value;
+      have[r->id]  = true;
+    }
+    ringTail++;
+    sensorLogRecords++;
+  }
+}
+
+int32_t sensorSample(uint8_t id, int32_t v) {
+  if(sensorLogMode == SENSOR_REPLAY) {
+    replayDue();
+    return have[id] ? value[id] : v;
+  }
+  if((sensorLogMode == SENSOR_RECORD) && (!have[id] || (v != value[id]))) {
+    if((uint16_t)(ringHead - ringTail) >= SENSOR_RING_SIZE) {
+      sensorLogDropped++; // Not marked as had, so it's tried again next time
+      return v;
+    }
+    sensorRecord *r = &ring[ringHead & (SENSOR_RING_SIZE - 1)];
+    r->ms    = millis() - startMs;
+    r->id    = id;
+    r->value = v;
+    ringHead++;
+    value[id] = v;
+    have[id]  = true;
+  }
+  return v;
+}
+
+static void reset(uint8_t mode) {
+  ringHead = ringTail = 0;
+  memset(have, 0, sizeof have);
+  fileDone         = false;
+  sensorLogRecords = sensorLogDropped = 0;
+  startMs          = lastWriteMs = lastSyncMs = millis();
+  sensorLogMode    = mode;
+}
+
+bool sensorLogRecord(const char *filename) {
+  sensorLogStop();
+  if(!(logFile = arcada.open(filename, O_WRITE | O_CREAT | O_TRUNC))) return false;
+  uint16_t hdr[2] = { SENSOR_VERSION, sizeof(sensorRecord) };
+  logFile.write(sensorMagic, sizeof sensorMagic);
+  logFile.write(hdr, sizeof hdr);
+  reset(SENSOR_RECORD);
+  return true;
+}
+
+bool sensorLogReplay(const char *filename) {
+  char     magic[4];
+  uint16_t hdr[2];
+  sensorLogStop();
+  if(!(logFile = arcada.open(filename, O_READ))) return false;
+  if((logFile.read(magic, sizeof magic) != sizeof magic) ||
+     (logFile.read(hdr, sizeof hdr) != sizeof hdr) || memcmp(magic, sensorMagic, sizeof magic) ||
+     (hdr[0] != SENSOR_VERSION) || (hdr[1] != sizeof(sensorRecord))) {
+    logFile.close();
+    return false;
+  }
+  reset(SENSOR_REPLAY);
+  ringRead();
+  return true;
+}
+
+void sensorLogStop(void) {
+  if(sensorLogMode == SENSOR_RECORD) {
+    while(ringTail != ringHead) ringWrite(); // Up to two runs if it wraps
+  }
+  if(sensorLogMode != SENSOR_OFF) logFile.close();
+  sensorLogMode = SENSOR_OFF;
+}
+
+// Filesystem side of both modes, called from loop() between rendering.
+// Writes go through SdFat's sector cache and the file is only synced
+// every few seconds, so most calls don't reach the flash.
+void sensorLogService(void) {
+  if(sensorLogMode == SENSOR_RECORD) {
+    uint32_t now = millis();
+    if(((uint16_t)(ringHead - ringTail) >= SENSOR_WRITE_MIN) ||
+       ((ringHead != ringTail) && ((now - lastWriteMs) >= SENSOR_WRITE_MS))) {
+      ringWrite();
+    }
+    if((now - lastSyncMs) >= SENSOR_SYNC_MS) {
+      logFile.sync();
+      lastSyncMs = now;
+    }
+  } else if(sensorLogMode == SENSOR_REPLAY) {
+    replayDue();
+    if(!fileDone) {
+      ringRead();
+    } else if(ringTail == ringHead) {
+      logMsg(LOG_SENSOR_REPLAY_DONE, sensorLogRecords);
+      sensorLogStop(); // Back to live readings
+    }
+  }
+}
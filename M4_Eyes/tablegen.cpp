@@ -51,22 +51,55 @@ void calcDisplacement() {
         }
       }
     }
+    calcRimMap();
+  }
+}
+
+// Near the rim of the eyeball the displacement squeezes several map
+// pixels into each screen pixel, detail there is mostly lost anyway.
+// This makes a 1-bit-per-pixel map (same quarter-screen layout as the
+// displacement map as used for Y lookups, i.e. index = x * size + y)
+// flagging pixels where the vertical gradient exceeds about 2 map pixels
+// per screen pixel. The renderer draws every other such pixel by
+// repeating its neighbor. Pixels next to the eye boundary aren't
+// flagged, so the eye edge itself stays exact.
+void calcRimMap(void) {
+  int h = DISPLAY_SIZE / 2;
+  if(rimMap = (uint8_t *)calloc((h * h + 7) / 8, 1)) {
+    for(int x=0; x<h; x++) {
+      uint8_t *col = &displace[x * h];
+      for(int y=1; y<(h-1); y++) {
+        if((col[y-1] < 255) && (col[y] < 255) && (col[y+1] < 255) &&
+           (((int)col[y+1] - (int)col[y-1]) >= 2)) { // 1 + d/2 >= 2
+          int i = x * h + y;
+          rimMap[i >> 3] |= 1 << (i & 7);
+        }
+      }
+    }
   }
 }
 
 void calcMap(void) {
   int pixels = mapRadius * mapRadius;
   if(polarAngle = (uint8_t *)malloc(pixels * 2)) { // Single alloc for both tables
-    polarDist = (int8_t *)&polarAngle[pixels];     // Offset to second table
+    polarDist = &polarAngle[pixels];               // Offset to second table
 
     // CALCULATE POLAR ANGLE & DISTANCE
 
+    // polarDist holds a geometry-neutral radial distance code: 0 at the
+    // center of the map to 254 at mapRadius, 255 = outside the map. Iris
+    // size is NOT baked in here; each eye has a small distLUT[] (see
+    // calcDistLUT() below) mapping this code to the signed sclera/iris
+    // distance the renderer wants, so iris size can differ per eye and
+    // change frame to frame at the cost of one byte lookup per pixel.
+    // Slit pupils are the exception, their shape isn't radial...see below.
+
     float mapRadius2  = mapRadius * mapRadius;  // Radius squared
     float iRad        = screen2map(irisRadius); // Iris size in in polar map pixels
     float irisRadius2 = iRad * iRad;            // Iris size squared
 
     uint8_t *anglePtr = polarAngle;
-    int8_t  *distPtr  = polarDist;
+    uint8_t *distPtr  = polarDist;
 
     // Like the displacement map, only the first quadrant is calculated,
     // and the other three quadrants are mirrored/rotated from this.
@@ -81,30 +114,40 @@ void calcMap(void) {
         d2 = dx * dx + dy2;        // Distance to center of map, squared
         if(d2 > mapRadius2) {      // If it exceeds 1/2 map size, squared,
           *anglePtr++ = 0;         // then mark as out-of-eye-bounds
-          *distPtr++  = -128;
+          *distPtr++  = 255;
         } else {                   // else pixel is within eye area...
           angle  = atan2(dy, dx);  // -pi to +pi (0 to +pi/2 in 1st quadrant)
           angle  = M_PI_2 - angle; // Clockwise, 0 at top
           angle *= 512.0 / M_PI;   // 0 to <256 in 1st quadrant
           *anglePtr++ = (uint8_t)angle;
-          d = sqrt(d2);
-          if(d2 > irisRadius2) {
-            // Point is in sclera
-            d = (mapRadius - d) / (mapRadius - iRad);
-            d *= 127.0;
-            *distPtr++ = (int8_t)d; // 0 to 127
-          } else {
-            // Point is in iris (-dist to indicate such)
-            d = (iRad - d) / iRad;
-            d *= -127.0;
-            *distPtr++ = (int8_t)d - 1; // -1 to -127
-          }
+          d = sqrt(d2) * 255.0 / (float)mapRadius;
+          *distPtr++ = (d < 254.0) ? (uint8_t)d : 254; // 0 to 254
         }
       }
     }
 
-    // If slit pupil is enabled, override iris area of polarDist map.
+    // If slit pupil is enabled, the iris area can't be expressed as a
+    // radial distance. In this case the map reverts to holding the signed
+    // sclera/iris distance (+128) for the boot-time irisRadius, and every
+    // eye's distLUT[] is a plain -128 offset; iris size is then fixed.
     if(slitPupilRadius > 0) {
+      for(y=0; y < mapRadius; y++) {
+        yield(); // Periodic yield() makes sure mass storage filesystem stays alive
+        dy  = y + 0.5;
+        dy2 = dy * dy;
+        for(x=0; x < mapRadius; x++) {
+          dx = x + 0.5;
+          d2 = dx * dx + dy2;
+          if(d2 > mapRadius2) {
+            d = -128;
+          } else if(d2 > irisRadius2) { // Point is in sclera
+            d = (mapRadius - sqrt(d2)) / (mapRadius - iRad) * 127.0;
+          } else {                      // Point is in iris (-dist to indicate such)
+            d = (iRad - sqrt(d2)) / iRad * -127.0 - 1.0;
+          }
+          polarDist[y * mapRadius + x] = (uint8_t)((int8_t)d + 128);
+        }
+      }
       // Iterate over each pixel in the iris section of the polar map...
       for(y=0; y < mapRadius; y++) {
         yield(); // Periodic yield() makes sure mass storage filesystem stays alive
@@ -137,7 +180,7 @@ void calcMap(void) {
               dx = xp - xc;       // X component of...
               d2 = dx * dx + dy2; // Distance from pixel to left 'xc' point
               if(d2 <= r2) {      // If point is within circle...
-                polarDist[y * mapRadius + x] = (int8_t)(-1 - i); // Set to distance 'i'
+                polarDist[y * mapRadius + x] = 128 - 1 - i; // Set to distance 'i'
                 break;
               }
             }
@@ -148,8 +191,33 @@ void calcMap(void) {
   }
 }
 
+// Fill a 256-entry table translating polarDist codes to the signed
+// distance used in rendering: 0 to 127 in the sclera (127 at the iris
+// edge), -1 to -127 in the iris (-1 at the edge, -127 at center), -128
+// outside the map. iRadius is the iris size in screen pixels. Cheap
+// enough (256 entries) to redo every frame if iris size is animating.
+void calcDistLUT(int8_t *lut, float iRadius) {
+  int i;
+  if(slitPupilRadius > 0) { // Map holds signed distance already (+128)
+    for(i=0; i<256; i++) lut[i] = i - 128;
+    return;
+  }
+  if(iRadius > eyeRadius) iRadius = eyeRadius;
+  else if(iRadius < 1.0)  iRadius = 1.0;
+  float iRad = screen2map(iRadius); // Iris size in polar map pixels
+  for(i=0; i<255; i++) {
+    float d = ((float)i + 0.5) * (float)mapRadius / 255.0; // Center of code's range
+    if(d > iRad) { // Sclera
+      lut[i] = (int8_t)((mapRadius - d) / (mapRadius - iRad) * 127.0);
+    } else {       // Iris
+      lut[i] = (int8_t)((iRad - d) / iRad * -127.0) - 1;
+    }
+  }
+  lut[255] = -128; // Off map
+}
+
 // Scale a measurement in screen pixels to polar map pixels
-float screen2map(int in) {
+float screen2map(float in) {
   return atan2(in, sqrt(eyeRadius * eyeRadius - in * in)) / M_PI_2 * mapRadius;
 }
 
@@ -0,0 +1,81 @@
+// SPDX-FileCopyrightText: 2024 Monster Mask Open Claw Project
+//
+// SPDX-License-Identifier: MIT
+
+// Scheduling of USB servicing relative to eye rendering. The Arduino core
+// runs the TinyUSB task (mass storage, serial) in yield() after each
+// return from loop(); loop() asks usbServiceDue() after every column
+// whether to return yet. USB gets serviced:
+//   - when the renderer is waiting on DMA anyway, if at least
+//     USB_MIN_GAP uS have passed since the last service,
+//   - unconditionally after USB_MAX_GAP uS (the guaranteed rate),
+// and if a service slice ran longer than USB_BACKOFF_THRESHOLD (host was
+// busy with mass storage), the next one may wait up to USB_BACKOFF_GAP so
+// the eyes get a chance to catch up. Nothing here can cut a slice short:
+// the core's yield() runs the TinyUSB task to completion, so the length
+// of a slice is only measured after the fact, and a long one is paid for
+// by spacing out the ones that follow. Gap and slice times are tracked
+// for STATUS.
+
+#include "globals.h"
+
+#define USB_MIN_GAP            250 // uS, don't service more often than this
+#define USB_MAX_GAP           1000 // uS, always service at least this often
+#define USB_BACKOFF_THRESHOLD  500 // uS, slices longer than this trigger backoff
+#define USB_BACKOFF_GAP       3000 // uS, max interval following a long slice
+
+static uint32_t usbReturnTime  = 0;     // When loop() last returned
+static uint32_t usbServiceTime = 0;     // When the last slice ended
+static uint32_t usbGapLimit    = USB_MAX_GAP;
+static bool     usbStarted     = false; // First slice is not measured
+
+uint32_t usbSlices      = 0; // Stats since last STATUS (usbStatsReset())
+uint32_t usbSliceMax    = 0; // uS
+uint32_t usbSliceTotal  = 0; // uS
+uint32_t usbGapMax      = 0; // uS
+uint32_t usbBackoffs    = 0;
+static uint32_t usbStatsStart = 0;
+
+// Call on entry to loop(): the USB slice (core's yield()) just ended.
+void usbSliceDone(void) {
+  uint32_t now = micros();
+  if(usbStarted) {
+    uint32_t slice = now - usbReturnTime;
+    usbSlices++;
+    usbSliceTotal += slice;
+    if(slice > usbSliceMax) usbSliceMax = slice;
+    if(slice > USB_BACKOFF_THRESHOLD) {
+      usbGapLimit = USB_BACKOFF_GAP;
+      usbBackoffs++;
+    } else {
+      usbGapLimit = USB_MAX_GAP;
+    }
+  } else {
+    usbStarted    = true;
+    usbStatsStart = now;
+  }
+  usbServiceTime = now;
+}
+
+// Call after each render step; 'idle' is true if the step was only
+// waiting on DMA. Returns true if loop() should return to service USB.
+bool usbServiceDue(bool idle) {
+  uint32_t now = micros(), gap = now - usbServiceTime;
+  if((gap >= usbGapLimit) || (idle && (gap >= USB_MIN_GAP))) {
+    if(gap > usbGapMax) usbGapMax = gap;
+    usbReturnTime = now;
+    return true;
+  }
+  return false;
+}
+
+// Percentage of time spent in USB slices since stats were last reset
+uint32_t usbLoadPercent(void) {
+  uint32_t elapsed = micros() - usbStatsStart;
+  return elapsed ? (uint32_t)((uint64_t)usbSliceTotal * 100 / elapsed) : 0;
+}
+
+void usbStatsReset(void) {
+  usbSlices = usbSliceMax = usbSliceTotal = usbGapMax = usbBackoffs = 0;
+  usbStatsStart = micros();
+}
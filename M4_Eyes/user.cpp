@@ -14,6 +14,23 @@
 //   STATUS          Print current style and frame info
 //   AUTOCYCLE:on    Enable auto-cycling (default)
 //   AUTOCYCLE:off   Disable auto-cycling
+//   LOADBENCH:<path> Time reading a file via FAT vs. raw flash sectors
+//   SENSORS:record[:<path>] Log sensor readings to a file (sensorlog.cpp)
+//   SENSORS:replay[:<path>] Use logged readings in place of live sensors
+//   SENSORS:off     Stop recording or replaying
+//   SENSORS         Print record/replay state
+//   PERFORM:record[:<path>] Save gaze, pupil & blinks each frame (perform.cpp)
+//   PERFORM:play[:<path>]   Play a saved performance
+//   PERFORM:off     Stop recording or playing
+//   PERFORM         Print record/play state
+//   CUE:load[:<path>] Parse a cue list (cue.cpp)
+//   CUE:go          Start the cue list (loading the default if none is)
+//   CUE:time:<ms>   Show position, for a cue list on the external clock
+//   CUE:off         Stop the cue list
+//   CUE             Print cue list state
+//   MIDI            Print USB MIDI message counts and latency (midi.cpp)
+//   VOICE           Print voice changer pitch, AGC gain, gate and AGC cost,
+//                   then each voice effect's cycles per block if any
 
 #if 1 // Change to 0 to disable this code (must enable ONE user*.cpp only!)
 
@@ -144,11 +161,126 @@ static void processCommand(const char *cmd) {
       Serial.println("AUTOCYCLE:off");
     }
 
+  } else if (!strncasecmp(cmd, "LOADBENCH:", 10)) {
+    assetBenchmark(cmd + 10);
+
+  } else if (!strncasecmp(cmd, "SENSORS", 7)) {
+    const char *arg  = cmd + 7;
+    const char *path = strchr(arg + (*arg == ':'), ':');
+    path = path ? path + 1 : SENSOR_LOG_FILE;
+    if (!strncasecmp(arg, ":record", 7)) {
+      if (sensorLogRecord(path)) Serial.printf("SENSORS:RECORDING:%s\n", path);
+      else                       Serial.printf("SENSORS:ERROR:%s\n", path);
+    } else if (!strncasecmp(arg, ":replay", 7)) {
+      if (sensorLogReplay(path)) Serial.printf("SENSORS:REPLAYING:%s\n", path);
+      else                       Serial.printf("SENSORS:ERROR:%s\n", path);
+    } else if (!strcasecmp(arg, ":off")) {
+      sensorLogStop();
+      Serial.printf("SENSORS:OFF,records=%lu,dropped=%lu\n",
+                    (unsigned long)sensorLogRecords, (unsigned long)sensorLogDropped);
+    } else {
+      static const char *modeName[] = { "off", "record", "replay" };
+      Serial.printf("SENSORS:mode=%s,records=%lu,dropped=%lu\n", modeName[sensorLogMode],
+                    (unsigned long)sensorLogRecords, (unsigned long)sensorLogDropped);
+    }
+
+  } else if (!strncasecmp(cmd, "PERFORM", 7)) {
+    const char *arg  = cmd + 7;
+    const char *path = strchr(arg + (*arg == ':'), ':');
+    path = path ? path + 1 : PERFORM_FILE;
+    if (!strncasecmp(arg, ":record", 7)) {
+      if (performRecord(path)) Serial.printf("PERFORM:RECORDING:%s\n", path);
+      else                     Serial.printf("PERFORM:ERROR:%s\n", path);
+    } else if (!strncasecmp(arg, ":play", 5)) {
+      if (performPlay(path)) Serial.printf("PERFORM:PLAYING:%s\n", path);
+      else                   Serial.printf("PERFORM:ERROR:%s\n", path);
+    } else if (!strcasecmp(arg, ":off")) {
+      performStop();
+      Serial.printf("PERFORM:OFF,frames=%lu,bytes=%lu,overruns=%lu\n", (unsigned long)performFrames,
+                    (unsigned long)performBytes, (unsigned long)performOverruns);
+    } else {
+      static const char *modeName[] = { "off", "record", "play" };
+      Serial.printf("PERFORM:mode=%s,frames=%lu,bytes=%lu,overruns=%lu\n", modeName[performMode],
+                    (unsigned long)performFrames, (unsigned long)performBytes,
+                    (unsigned long)performOverruns);
+    }
+
+  } else if (!strncasecmp(cmd, "CUE", 3)) {
+    const char *arg = cmd + 3;
+    if (!strncasecmp(arg, ":load", 5)) {
+      const char *path = (arg[5] == ':') ? arg + 6 : CUE_FILE;
+      if (cueLoad(path) >= 0) Serial.printf("CUE:LOADED:%s,cues=%u\n", path, cueCount());
+      else                    Serial.printf("CUE:ERROR:%s,line=%u\n", path, cueErrorLine);
+    } else if (!strcasecmp(arg, ":go")) {
+      if (!cueCount() && (cueLoad(CUE_FILE) < 0)) {
+        Serial.printf("CUE:ERROR:%s,line=%u\n", CUE_FILE, cueErrorLine);
+      } else if (cueGo()) {
+        Serial.printf("CUE:GO,cues=%u\n", cueCount());
+      } else {
+        Serial.println("CUE:ERROR:no cues");
+      }
+    } else if (!strncasecmp(arg, ":time:", 6)) {
+      cueTime(strtoul(arg + 6, NULL, 10)); // No reply, may be sent often
+    } else if (!strcasecmp(arg, ":off")) {
+      cueStop();
+      Serial.printf("CUE:OFF,fired=%lu\n", (unsigned long)cueFired);
+    } else {
+      static const char *clockName[] = { "internal", "audio", "external" };
+      Serial.printf("CUE:mode=%s,clock=%s,cues=%u,next=%u,clockMs=%lu,fired=%lu,maxLateMs=%ld\n",
+                    cueMode ? "run" : "off", clockName[cueClock], cueCount(), cueNext(),
+                    (unsigned long)cueClockMs(), (unsigned long)cueFired, (long)cueMaxLateMs);
+    }
+
+  } else if (!strcasecmp(cmd, "MIDI")) {
+    // Latency is from USB receipt until on both screens, since the last MIDI
+    uint32_t n = midiLatencyCount;
+    Serial.printf("MIDI:events=%lu,dropped=%lu,timed=%lu,latencyAvgUs=%lu,latencyMaxUs=%lu,queueMaxUs=%lu\n",
+                  (unsigned long)midiEvents, (unsigned long)midiDropped, (unsigned long)n,
+                  (unsigned long)(n ? midiLatencyTotal / n : 0), (unsigned long)midiLatencyMax,
+                  (unsigned long)midiQueueMax);
+    midiStatsReset();
+
+  } else if (!strcasecmp(cmd, "VOICE")) {
+    // AGC cost is averaged since the previous VOICE request
+    uint32_t n = voiceAgcSamples;
+    Serial.printf("VOICE:on=%d,pitch=%d%%,agcGain=%d%%,gate=%s,agcCyclesPerSample=%lu\n",
+                  voiceOn, (int)(currentPitch * 100.0 + 0.5),
+                  (int)(voiceAgcGain * 100 / 4096), voiceGateOpen ? "open" : "shut",
+                  (unsigned long)(n ? voiceAgcCycles / n : 0));
+    voiceAgcCycles = voiceAgcSamples = 0;
+    if(fxStages) {
+      // Each effect's cycles per block, average/max since the last request
+      uint32_t blocks = fxBlocks;
+      Serial.print("VOICEFX:");
+      for(uint8_t i=0; i<fxStages; i++) {
+        Serial.printf("%s%s=%lu/%lu", i ? "," : "", fxName(i),
+                      (unsigned long)(blocks ? fxCycles[i] / blocks : 0),
+                      (unsigned long)fxCyclesMax[i]);
+      }
+      Serial.printf(",blocks=%lu\n", (unsigned long)blocks);
+      fxStatsReset();
+    }
+
   } else if (!strncasecmp(cmd, "STATUS", 6)) {
-    Serial.printf("STATUS:style=%s,index=%d/%d,autocycle=%s,frames=%lu,freeRAM=%lu\n",
+    // Render cost is averaged since the previous STATUS request
+    uint32_t cpp = renderPixels ? (uint32_t)(renderCycles / renderPixels) : 0;
+    renderCycles = renderPixels = 0;
+    Serial.printf("STATUS:style=%s,index=%d/%d,autocycle=%s,frames=%lu,freeRAM=%lu,cyclesPerPixel=%lu,cacheHits=%lu,cacheMisses=%lu\n",
                   styleTable[cycleIndex].name, cycleIndex, NUM_STYLES,
                   cycleEnabled ? "on" : "off",
-                  (unsigned long)frames, (unsigned long)availableRAM());
+                  (unsigned long)frames, (unsigned long)availableRAM(),
+                  (unsigned long)cpp, (unsigned long)blockCacheHits,
+                  (unsigned long)blockCacheMisses);
+    Serial.printf("STATUS:usbSlices=%lu,usbSliceAvg=%lu,usbSliceMax=%lu,usbGapMax=%lu,usbBackoffs=%lu,usbLoad=%lu%%,logDropped=%lu\n",
+                  (unsigned long)usbSlices,
+                  (unsigned long)(usbSlices ? (usbSliceTotal / usbSlices) : 0),
+                  (unsigned long)usbSliceMax, (unsigned long)usbGapMax,
+                  (unsigned long)usbBackoffs, (unsigned long)usbLoadPercent(),
+                  (unsigned long)logDropped);
+    Serial.printf("STATUS:textureLoadMs=%lu,tableGenMs=%lu\n",
+                  (unsigned long)(textureLoadCycles / (F_CPU / 1000)),
+                  (unsigned long)(tableGenCycles / (F_CPU / 1000)));
+    usbStatsReset();
 
   } else if (cmd[0] != '\0') {
     Serial.printf("UNKNOWN:CMD:%s\n", cmd);
@@ -159,7 +291,7 @@ void user_setup(void) {
   Serial.printf("Eye style: %s (%d/%d) autocycle=%s\n",
                 styleTable[cycleIndex].name, cycleIndex, NUM_STYLES,
                 cycleEnabled ? "on (2 min)" : "off");
-  Serial.println("Commands: MOOD:<name|list|next>, STATUS, AUTOCYCLE:<on|off>");
+  Serial.println("Commands: MOOD:<name|list|next>, STATUS, AUTOCYCLE:<on|off>, LOADBENCH:<path>, SENSORS:<record|replay|off>, PERFORM:<record|play|off>, CUE:<load|go|time|off>, MIDI, VOICE");
   lastCycleMs = millis();
 }
 
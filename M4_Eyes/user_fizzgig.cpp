@@ -5,26 +5,79 @@
 #if 0 // Change to 1 to enable this code (must enable ONE user*.cpp only!)
 
 #include "globals.h"
-#include <Servo.h>
+#include <wiring_private.h>
 
-// Servo stuff
-Servo myservo;
+// Servo stuff. Pulses come from the PWM output of whichever TC or TCC
+// timer SERVO_PIN is on, so once set up they take no CPU time at all;
+// servoWrite() only changes the buffered compare value, which the timer
+// picks up at its next period. Anything else PWMing off the same timer
+// gets the servo's ~50 Hz period too.
 #define SERVO_MOUTH_OPEN    750 // Servo pulse microseconds
 #define SERVO_MOUTH_CLOSED 1850
 #define SERVO_PIN             3
+#define SERVO_TICKS_PER_US    3 // 48 MHz GCLK1 / 16
+#define SERVO_PERIOD      60000 // TCC ticks = 20 ms (16-bit TC wraps, 21.8 ms)
+static void   *servoTimer = NULL; // Tcc or Tc instance, NULL if no PWM on pin
+static bool    servoIsTcc;
+static uint8_t servoChannel;
+static bool    servoActive = false; // Pulses being sent
+// Peripheral clock IDs and compare channel counts by TC number, as used
+// in the variant's PWM channel table (TCCs first, then TCs)
+static const uint8_t servoGclkID[] = {
+  TCC0_GCLK_ID, TCC1_GCLK_ID, TCC2_GCLK_ID, TCC3_GCLK_ID, TCC4_GCLK_ID,
+  TC0_GCLK_ID, TC1_GCLK_ID, TC2_GCLK_ID, TC3_GCLK_ID, TC4_GCLK_ID, TC5_GCLK_ID };
+static const uint8_t tccChannels[] = { 6, 4, 3, 2, 2 };
+
+// Jaw follows the sound: an envelope follower runs on the WAV samples as
+// they go into a delay line, and the sound is heard as they come out, so
+// the servo is commanded jawLookahead ms (config file, default 60) ahead
+// of the audio it matches, to make up for the time it takes to move. The
+// delay line limits the lookahead, by the WAV's sample rate; a longer
+// setting is cut to fit, with a message.
+#define JAW_DELAY_MAX      4096 // Samples: 185 ms at 22.05 KHz, 93 ms at 44.1
+#define JAW_ATTACK_MS         5 // Envelope rise and fall times
+#define JAW_RELEASE_MS       60
+#define JAW_FLOOR           600 // Envelope below this (of 32767) = shut
+static uint8_t          jawDelay[JAW_DELAY_MAX];
+static uint16_t         jawDelayLen, jawDelayIdx;
+static uint16_t         jawDelayFill; // Silence still in delay at start
+static uint16_t         wavTail;      // Delay still to empty at end
+static int32_t          envAttack, envRelease; // 0-65536 per sample
+static volatile int32_t wavEnvelope;  // 0 to 32767
 
 #define BUTTON_PIN            2
 
-// WAV player stuff
-#define WAV_BUFFER_SIZE    256
-static uint8_t     wavBuf[2][WAV_BUFFER_SIZE];
+// WAV player stuff. The DAC interrupt only plays samples out of a ring of
+// buffers, handing each back as it drains; wavFill() reads and decodes into
+// the empty ones from user_loop() (and audioService, while a mood reload
+// holds up the frame), so flash and SdFat are never touched by the
+// interrupt. The buffers queued ahead cover the longest gap between fills.
+#define WAV_BUFFER_SIZE   1024 // Samples; holds a decoded ADPCM block or more
+#define WAV_BUFFERS          4 // 3 queued = 70 ms at 44.1 KHz, 139 at 22.05
+#define ADPCM_BLOCK_MAX    512 // Largest blockAlign supported (1017 samples)
+static uint8_t     wavBuf[WAV_BUFFERS][WAV_BUFFER_SIZE];
+static volatile uint16_t wavBufLen[WAV_BUFFERS]; // Samples in each, 0 = empty
+static uint8_t     wavPlayBuf, wavFillBuf;       // Interrupt plays, wavFill() fills
+static uint16_t    bufIdx;                       // Play position in wavPlayBuf
+static volatile bool     wavEnded;               // File done, nothing more to fill
+static volatile uint32_t wavUnderruns;           // Interrupts that found no samples
+static uint32_t    wavRate;                      // WAV sample rate, for the report
+static uint32_t    adpcmSamples;                 // Decoded, for the report
+static uint8_t     adpcmBuf[ADPCM_BLOCK_MAX]; // One block, pre-decoding
+static uint16_t    adpcmBlockSize;            // blockAlign if IMA-ADPCM, else 0
 static File        wavFile;
+static const assetInfo *wavAsset; // Non-NULL if WAV is read from raw flash
+static uint32_t    wavPos;        // Read position when using wavAsset
 static bool        playing = false;
 static int         remainingBytesInChunk;
-static uint8_t     activeBuf;
-static uint16_t    bufIdx, bufEnd, nextBufEnd;
+static resampler   wavResampler; // WAV's rate to AUDIO_OUT_RATE
+static uint8_t     wavOut = 128; // Next DAC value
 static bool        startWav(char *filename);
+static bool        servoBegin(uint8_t pin);
+static void        servoWrite(uint16_t us);
 static void        wavOutCallback(void);
+static void        wavFill(void);
+static void        wavService(void);
 static uint32_t    wavEventTime; // WAV start or end time, in ms
 static const char *wav_path = "fizzgig";
 static struct wavlist { // Linked list of WAV filenames
@@ -34,45 +87,120 @@ static struct wavlist { // Linked list of WAV filenames
 #define MAX_WAV_FILES 20
 
 void user_setup(void) {
-  File            entry;
+  File            dir, entry;
   struct wavlist *wptr;
   char            filename[SD_MAX_FILENAME_SIZE+1];
-  // Scan wav_path for .wav files:
-  for(int i=0; i<MAX_WAV_FILES; i++) {
-    entry = arcada.openFileByIndex(wav_path, i, O_READ, "wav");
-    if(!entry) break;
-    // Found one, alloc new wavlist struct, try duplicating filename
-    if((wptr = (struct wavlist *)malloc(sizeof(struct wavlist)))) {
-      entry.getName(filename, SD_MAX_FILENAME_SIZE);
-      if((wptr->filename = strdup(filename))) {
-        // Alloc'd OK, add to linked list...
-        if(wavListPtr) {           // List already started?
-          wavListPtr->next = wptr; // Point prior last item to new one
+  int             numFiles = 0;
+  // Scan wav_path for .wav files. One pass through the directory, rather
+  // than openFileByIndex() which re-walks it from the start for each file.
+  if(!(dir = arcada.open(wav_path))) return;
+  while((numFiles < MAX_WAV_FILES) && entry.openNext(&dir, O_READ)) {
+    entry.getName(filename, SD_MAX_FILENAME_SIZE);
+    int len = strlen(filename);
+    if(!entry.isDir() && (filename[0] != '.') && (len > 4) &&
+       !strcasecmp(&filename[len - 4], ".wav")) {
+      // Found one, alloc new wavlist struct, try duplicating filename
+      if((wptr = (struct wavlist *)malloc(sizeof(struct wavlist)))) {
+        if((wptr->filename = strdup(filename))) {
+          // Alloc'd OK, add to linked list...
+          if(wavListPtr) {           // List already started?
+            wavListPtr->next = wptr; // Point prior last item to new one
+          } else {
+            wavListStart = wptr;     // Point list head to new item
+          }
+          wavListPtr = wptr;         // Update last item to new one
+          numFiles++;
         } else {
-          wavListStart = wptr;     // Point list head to new item
+          free(wptr);                // Alloc failed, delete interim stuff
         }
-        wavListPtr = wptr;         // Update last item to new one
-      } else {
-        free(wptr);                // Alloc failed, delete interim stuff
       }
     }
     entry.close();
   }
+  dir.close();
   if(wavListPtr) {                   // Any items in WAV list?
     wavListPtr->next = wavListStart; // Point last item's next to list head (list is looped)
     wavListPtr       = wavListStart; // Update list pointer to head
+    if(!servoBegin(SERVO_PIN)) Serial.println("Servo pin has no PWM timer");
+  }
+}
+
+// Start servo pulses on pin (stopped until servoWrite()). Returns false
+// if the pin has no timer PWM output.
+static bool servoBegin(uint8_t pin) {
+  const PinDescription *p    = &g_APinDescription[pin];
+  uint32_t              attr = p->ulPinAttribute;
+  if(!(attr & (PIN_ATTR_PWM_E | PIN_ATTR_PWM_F | PIN_ATTR_PWM_G))) return false;
+  uint32_t tcNum = GetTCNumber(p->ulPWMChannel);
+  servoChannel   = GetTCChannelNumber(p->ulPWMChannel);
+  servoIsTcc     = (tcNum < TCC_INST_NUM);
+  servoTimer     = (void *)GetTC(p->ulPWMChannel);
+  pinPeripheral(pin, (attr & PIN_ATTR_PWM_E) ? PIO_TIMER :
+                     (attr & PIN_ATTR_PWM_F) ? PIO_TIMER_ALT : PIO_TCC_PDEC);
+  GCLK->PCHCTRL[servoGclkID[tcNum]].reg = GCLK_PCHCTRL_GEN_GCLK1_Val |
+                                          (1 << GCLK_PCHCTRL_CHEN_Pos); // 48 MHz
+  if(servoIsTcc) {
+    Tcc *tcc = (Tcc *)servoTimer;
+    servoChannel %= tccChannels[tcNum]; // WO[n] beyond last CC repeats them
+    tcc->CTRLA.bit.ENABLE = 0;
+    while(tcc->SYNCBUSY.bit.ENABLE);
+    tcc->CTRLA.reg = TCC_CTRLA_PRESCALER_DIV16;
+    tcc->WAVE.reg  = TCC_WAVE_WAVEGEN_NPWM;
+    tcc->PER.reg   = SERVO_PERIOD - 1;
+    tcc->CC[servoChannel].reg = 0;
+    while(tcc->SYNCBUSY.reg);
+    tcc->CTRLA.bit.ENABLE = 1;
+    while(tcc->SYNCBUSY.bit.ENABLE);
+  } else {
+    TcCount16 *tc = &((Tc *)servoTimer)->COUNT16;
+    tc->CTRLA.bit.ENABLE = 0;
+    while(tc->SYNCBUSY.bit.ENABLE);
+    tc->CTRLA.reg = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_PRESCALER_DIV16;
+    tc->WAVE.reg  = TC_WAVE_WAVEGEN_NPWM;
+    tc->CC[servoChannel].reg = 0;
+    while(tc->SYNCBUSY.reg);
+    tc->CTRLA.bit.ENABLE = 1;
+    while(tc->SYNCBUSY.bit.ENABLE);
   }
+  return true;
+}
+
+// Set servo pulse width; 0 stops pulses (servo goes limp)
+static void servoWrite(uint16_t us) {
+  if(!servoTimer) return;
+  uint32_t ticks = us * SERVO_TICKS_PER_US;
+  if(servoIsTcc) ((Tcc *)servoTimer)->CCBUF[servoChannel].reg = ticks;
+  else           ((Tc *)servoTimer)->COUNT16.CCBUF[servoChannel].reg = ticks;
+  servoActive = (us > 0);
 }
 
 void user_loop(void) {
   if(playing) {
-    // While WAV is playing, wiggle servo between middle and open-mouth positions:
-    uint32_t elapsed = millis() - wavEventTime;                // Time since audio start
-    uint16_t frac    = elapsed % 500;                          // 0 to 499 = 0.5 sec
-    float    n       = 1.0 - ((float)abs(250 - frac) / 500.0); // Ramp 0.5, 1.0, 0.5 in 0.5 sec
-    myservo.writeMicroseconds((int)((float)SERVO_MOUTH_CLOSED + (float)(SERVO_MOUTH_OPEN - SERVO_MOUTH_CLOSED) * n));
+    wavFill(); // Refill whatever the interrupt has played out
+    // While WAV is playing, open the jaw with the sound's envelope (which
+    // is jawLookahead ms ahead of what's being heard):
+    float n = (float)(wavEnvelope - JAW_FLOOR) * jawGain / 32768.0;
+    if(n < 0.0)      n = 0.0;
+    else if(n > 1.0) n = 1.0;
+    servoWrite((int)((float)SERVO_MOUTH_CLOSED + (float)(SERVO_MOUTH_OPEN - SERVO_MOUTH_CLOSED) * n));
     // BUTTON_PIN button is ignored while sound is playing.
   } else if(wavListPtr) {
+    if(adpcmBlocks && adpcmSamples) {
+      // ADPCM WAV just ended, report decode time, and that time per sample
+      // as a share of the WAV's sample period (F_CPU / rate cycles)
+      uint32_t permille = (uint64_t)adpcmCycles * wavRate * 1000 /
+                          ((uint64_t)adpcmSamples * F_CPU);
+      Serial.printf("ADPCM: %lu blocks, %lu cycles/block avg, %lu max, %lu.%lu%% of sample period\n",
+        (unsigned long)adpcmBlocks, (unsigned long)(adpcmCycles / adpcmBlocks),
+        (unsigned long)adpcmCyclesMax, (unsigned long)(permille / 10),
+        (unsigned long)(permille % 10));
+      adpcmStatsReset();
+      adpcmSamples = 0;
+    }
+    if(wavUnderruns) { // Fills fell behind the interrupt
+      Serial.printf("WAV: %lu underruns\n", (unsigned long)wavUnderruns);
+      wavUnderruns = 0;
+    }
     // Not currently playing WAV. Check for button press on pin BUTTON_PIN.
     pinMode(BUTTON_PIN, INPUT_PULLUP);
     delayMicroseconds(20); // Avoid boop code interference
@@ -82,17 +210,37 @@ void user_loop(void) {
       wavListPtr = wavListPtr->next; // Will loop around from end to start of list
     }
     pinMode(BUTTON_PIN, INPUT);
-    if(myservo.attached()) { // If servo still active (from recent WAV playing)
-      myservo.writeMicroseconds(SERVO_MOUTH_CLOSED); // Make sure it's in closed position
+    if(servoActive) { // If servo still active (from recent WAV playing)
+      servoWrite(SERVO_MOUTH_CLOSED); // Make sure it's in closed position
       // If it's been more than 1 sec since audio stopped,
-      // deactivate the servo to reduce power, heat & noise.
+      // stop the servo pulses to reduce power, heat & noise.
       if((millis() - wavEventTime) > 1000) {
-        myservo.detach();
+        servoWrite(0);
       }
     }
   }
 }
 
+// WAV data is read straight from flash sectors if the file is stored
+// contiguously (see assetRead()), else through the file as usual.
+static int wavRead(void *dst, uint32_t n) {
+  if(wavAsset) {
+    uint32_t got = assetRead(wavAsset, wavPos, dst, n);
+    wavPos += got;
+    return got;
+  }
+  return wavFile.read(dst, n);
+}
+
+static bool wavSkip(uint32_t n) {
+  if(wavAsset) {
+    if((wavPos + n) > wavAsset->size) return false;
+    wavPos += n;
+    return true;
+  }
+  return wavFile.seekCur(n);
+}
+
 static uint16_t readWaveData(uint8_t *dst) {
   if(remainingBytesInChunk <= 0) {
     // Read next chunk
@@ -101,30 +249,69 @@ static uint16_t readWaveData(uint8_t *dst) {
       uint32_t size;
     } header;
     for(;;) {
-      if(wavFile.read(&header, 8) != 8) return 0;
+      if(wavRead(&header, 8) != 8) return 0;
       if(!strncmp(header.id, "data", 4)) {
         remainingBytesInChunk = header.size;
         break;
       }
-      if(!wavFile.seekCur(header.size)) { // If not "data" then skip
+      if(!wavSkip(header.size)) { // If not "data" then skip
         return 0; // Seek failed, return invalid count
       }
     }
   }
 
-  int16_t bytesRead = wavFile.read(dst, min(WAV_BUFFER_SIZE, remainingBytesInChunk));
+  if(adpcmBlockSize) { // Decode as many whole ADPCM blocks as fit in dst
+    uint16_t n = 0, perBlock = (adpcmBlockSize - 4) * 2 + 1;
+    while((remainingBytesInChunk > 0) && ((n + perBlock) <= WAV_BUFFER_SIZE)) {
+      int16_t bytesRead = wavRead(adpcmBuf, min(adpcmBlockSize, remainingBytesInChunk));
+      if(bytesRead <= 0) break;
+      remainingBytesInChunk -= bytesRead;
+      uint16_t got = adpcmDecodeBlock(adpcmBuf, bytesRead, &dst[n]);
+      if(!got) break;
+      n += got;
+    }
+    adpcmSamples += n;
+    return n;
+  }
+
+  int16_t bytesRead = wavRead(dst, min(WAV_BUFFER_SIZE, remainingBytesInChunk));
   if(bytesRead > 0) remainingBytesInChunk -= bytesRead;
   return bytesRead;
 }
 
+// Read and decode into each empty buffer in the ring, in play order. Main
+// loop context only: this is the one place WAV data is read once playing.
+static void wavFill(void) {
+  while(!wavEnded && !wavBufLen[wavFillBuf]) {
+    uint16_t n = readWaveData(wavBuf[wavFillBuf]);
+    if(!n) {
+      wavEnded = true;
+      break;
+    }
+    __DMB(); // Samples in place before the interrupt can see the length
+    wavBufLen[wavFillBuf] = n;
+    if(++wavFillBuf >= WAV_BUFFERS) wavFillBuf = 0;
+  }
+}
+
+// audioService hook, called between loads while a reload holds up the frame
+static void wavService(void) {
+  if(playing) wavFill();
+}
+
 // Partially swiped from Wave Shield code.
-// Is pared-down, handles 8-bit mono only to keep it simple.
+// Is pared-down, handles 8-bit or IMA-ADPCM mono only to keep it simple.
 static bool startWav(char *filename) {
   wavFile = arcada.open(filename);
   if(!wavFile) {
     Serial.println("Failed to open WAV file");
     return false;
   }
+  char path[SD_MAX_FILENAME_SIZE+1];
+  snprintf(path, sizeof path, "%s/%s", wav_path, filename);
+  wavAsset = assetFind(path);
+  if(wavAsset && !wavAsset->sector) wavAsset = NULL; // Fragmented, use file
+  wavPos   = 0;
 
   union {
     struct {
@@ -140,38 +327,71 @@ static bool startWav(char *filename) {
       uint16_t blockAlign;
       uint16_t bitsPerSample;
       uint16_t extraBytes;
+      uint16_t samplesPerBlock; // ADPCM only
     } fmt; // fmt data
   } buf;
 
   uint16_t size;
-  if((wavFile.read(&buf, 12) == 12)
+  if((wavRead(&buf, 12) == 12)
     && !strncmp(buf.riff.id, "RIFF", 4)
     && !strncmp(buf.riff.data, "WAVE", 4)) {
-    // next chunk must be fmt, fmt chunk size must be 16 or 18
-    if((wavFile.read(&buf, 8) == 8)
+    // next chunk must be fmt, fmt chunk size must be 16, 18 or 20 (ADPCM)
+    if((wavRead(&buf, 8) == 8)
       && !strncmp(buf.riff.id, "fmt ", 4)
-      && (((size = buf.riff.size) == 16) || (size == 18))
-      && (wavFile.read(&buf, size) == size)
-      && ((size != 18) || (buf.fmt.extraBytes == 0))) {
-      if((buf.fmt.channels == 1) && (buf.fmt.bitsPerSample == 8)) {
-        Serial.printf("Samples/sec: %d\n", buf.fmt.sampleRate);
-        bufEnd = readWaveData(wavBuf[0]);
-        if(bufEnd > 0) {
+      && (((size = buf.riff.size) == 16) || (size == 18) || (size == 20))
+      && (wavRead(&buf, size) == size)
+      && ((size == 16) || (buf.fmt.extraBytes == (size - 18)))) {
+      adpcmBlockSize = 0;
+      if((buf.fmt.compress == 0x11) && (buf.fmt.bitsPerSample == 4) &&
+         (buf.fmt.blockAlign > 4) && (buf.fmt.blockAlign <= ADPCM_BLOCK_MAX)) {
+        adpcmBlockSize = buf.fmt.blockAlign;
+        adpcmStatsReset();
+      }
+      if((buf.fmt.channels == 1) && (adpcmBlockSize ||
+         ((buf.fmt.compress == 1) && (buf.fmt.bitsPerSample == 8)))) {
+        Serial.printf("Samples/sec: %d%s\n", buf.fmt.sampleRate,
+          adpcmBlockSize ? " (ADPCM)" : "");
+        for(uint8_t i=0; i<WAV_BUFFERS; i++) wavBufLen[i] = 0;
+        wavPlayBuf   = wavFillBuf = 0;
+        bufIdx       = 0;
+        wavEnded     = false;
+        wavUnderruns = 0;
+        adpcmSamples = 0;
+        wavFill(); // Whole ring queued before the interrupt starts
+        if(wavBufLen[0]) {
           // Initialize A/D, speaker and start timer
           analogWriteResolution(8);
           analogWrite(A0, 128);
           analogWrite(A1, 128);
           arcada.enableSpeaker(true);
           wavEventTime = millis(); // WAV starting time
-          bufIdx       = 0;
+          wavOut       = 128;
+          // Look-ahead delay starts full of silence
+          uint32_t rate = buf.fmt.sampleRate;
+          wavRate      = rate;
+          jawDelayLen  = constrain(jawLookahead * rate / 1000, 1, JAW_DELAY_MAX);
+          if(jawLookahead * rate / 1000 > JAW_DELAY_MAX) {
+            Serial.printf("jawLookahead cut to %d ms at %d Hz\n",
+              (int)(JAW_DELAY_MAX * 1000 / rate), (int)rate);
+          }
+          memset(jawDelay, 128, jawDelayLen);
+          jawDelayIdx  = 0;
+          jawDelayFill = jawDelayLen;
+          wavTail      = 0;
+          wavEnvelope  = 0;
+          envAttack    = (int32_t)(65536.0 * (1.0 - exp(-1000.0 / (JAW_ATTACK_MS  * (float)rate))));
+          envRelease   = (int32_t)(65536.0 * (1.0 - exp(-1000.0 / (JAW_RELEASE_MS * (float)rate))));
           playing      = true;
-          arcada.timerCallback(buf.fmt.sampleRate, wavOutCallback);
-          nextBufEnd   = readWaveData(wavBuf[1]);
-          myservo.attach(SERVO_PIN);
+          audioSamples    = 0; // Cue list audio clock (cue.cpp)
+          audioSampleRate = rate;
+          audioService    = wavService; // Keep filling through reloads
+          // Output is always at AUDIO_OUT_RATE, resampled from the WAV's
+          rsInit(&wavResampler, (float)buf.fmt.sampleRate / (float)AUDIO_OUT_RATE);
+          arcada.timerCallback(AUDIO_OUT_RATE, wavOutCallback);
         }
         return true;
       } else {
-        Serial.println("Only 8-bit mono WAVs are supported");
+        Serial.println("Only 8-bit or IMA-ADPCM mono WAVs are supported");
       }
     } else {
       Serial.println("WAV uses compression or other unrecognized setting");
@@ -185,23 +405,46 @@ static bool startWav(char *filename) {
 }
 
 static void wavOutCallback(void) {
-  uint8_t n = wavBuf[activeBuf][bufIdx];
-  analogWrite(A0, n);
-  analogWrite(A1, n);
-
-  if(++bufIdx >= bufEnd) {
-    if(nextBufEnd <= 0) {
-      arcada.timerStop();
-      arcada.enableSpeaker(false);
-      playing      = false;
-      wavEventTime = millis(); // Same var now holds WAV end time
+  analogWrite(A0, wavOut);
+  analogWrite(A1, wavOut);
+
+  // Feed the resampler as many WAV samples as this output needs
+  while(rsNeedsInput(&wavResampler)) {
+    uint8_t in = 128;
+    if(wavTail) { // WAV data done, emptying the look-ahead delay
+      if(!--wavTail) {
+        arcada.timerStop();
+        arcada.enableSpeaker(false);
+        playing         = false;
+        audioSampleRate = 0;
+        wavEventTime    = millis(); // Same var now holds WAV end time
+        return;
+      }
+    } else if(wavBufLen[wavPlayBuf]) {
+      in = wavBuf[wavPlayBuf][bufIdx];
+      if(++bufIdx >= wavBufLen[wavPlayBuf]) { // Drained, hand it back to wavFill()
+        bufIdx                = 0;
+        wavBufLen[wavPlayBuf] = 0;
+        if(++wavPlayBuf >= WAV_BUFFERS) wavPlayBuf = 0;
+      }
+    } else if(wavEnded) { // Ring empty and nothing left to read
+      wavTail = jawDelayLen + 1;
+    } else { // Fill fell behind: hold the DAC (and audio clock) until it's back
+      wavUnderruns++;
       return;
     }
-    bufIdx     = 0;
-    bufEnd     = nextBufEnd;
-    nextBufEnd = readWaveData(wavBuf[activeBuf]);
-    activeBuf  = 1 - activeBuf;
+    // Envelope of the sample going into the delay...
+    int32_t a = abs((int16_t)in - 128) << 8;
+    wavEnvelope += ((a - wavEnvelope) * ((a > wavEnvelope) ? envAttack : envRelease)) >> 16;
+    // ...while the one coming out is heard
+    uint8_t out = jawDelay[jawDelayIdx];
+    jawDelay[jawDelayIdx] = in;
+    if(++jawDelayIdx >= jawDelayLen) jawDelayIdx = 0;
+    rsPush(&wavResampler, ((int16_t)out - 128) << 8);
+    if(jawDelayFill) jawDelayFill--;
+    else             audioSamples++;
   }
+  wavOut = (rsOut(&wavResampler) >> 8) + 128;
 }
 
 #endif // 0
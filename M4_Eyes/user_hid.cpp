@@ -64,7 +64,7 @@ void user_loop(void) {
     keycode[2] = DOWN_BUTTON_KEYCODE_TO_SEND;
   }
 
-  uint8_t shake = arcada.accel.getClick();
+  uint8_t shake = sensorSample(SENSOR_ACCEL_CLICK, arcada.accel.getClick());
   if (shake & 0x30) {
     Serial.print("shake detected (0x"); Serial.print(shake, HEX); Serial.print("): ");
     if (shake & 0x10) Serial.println(" single shake");
@@ -24,7 +24,7 @@ void user_setup(void) {
 }
 
 void user_loop(void) {
-  uint8_t e, newState = digitalRead(PIR_PIN);
+  uint8_t e, newState = sensorSample(SENSOR_PIR, digitalRead(PIR_PIN));
   if(newState != priorState) {
     if(newState) {
       // Initial motion sensed
@@ -0,0 +1,320 @@
+// SPDX-FileCopyrightText: 2024 Monster Mask Open Claw Project
+//
+// SPDX-License-Identifier: MIT
+
+// Voice effect chain, declared in config.eye as a "voiceFX" list and
+// applied in order to the voice changer's output, after pitch shifting:
+//   ring      ring modulator: freq (Hz, default 30), mix (default 1.0)
+//   crush     bitcrusher: bits kept (default 8), freq = sample-and-hold
+//             rate (Hz, default none)
+//   lowpass   one-pole low-pass filter: freq (default 3000)
+//   highpass  one-pole high-pass filter: freq (default 300)
+//   echo      delay with feedback: ms (default 120, max FX_ECHO_MAX_MS),
+//             feedback (default 0.35), mix (default 0.5)
+//   distort   soft clipper: drive (gain into it, default 4.0)
+// e.g. "voiceFX" : [ { "type" : "highpass", "freq" : 400 },
+//                    { "type" : "ring", "freq" : 40 } ]
+//
+// Effects work on blocks of FX_BLOCK samples, integer-only, in the output
+// interrupt. The interrupt collects one block while the previous one goes
+// through the chain a stage per interrupt (effect n runs on the nth
+// interrupt of the block), and plays the one before that. So any single
+// interrupt carries at most one effect's block, at a latency of two blocks
+// (1.4 ms). Each stage's cycles are counted as it runs (fxCycles[]).
+//
+// fxSetup() times every effect on a test block before accepting a chain,
+// and refuses the whole chain, leaving the voice dry, if any effect
+// wouldn't fit in one interrupt (FX_STAGE_CYCLES) or all of them together
+// would take more than FX_BUDGET_PERCENT of the CPU; a voice that's
+// accepted can't cause audio dropouts.
+
+#if defined(ADAFRUIT_MONSTER_M4SK_EXPRESS)
+
+#include "globals.h"
+#include <string.h>
+
+#define FX_BLOCK          32  // Samples per block, 0.68 ms
+#define FX_ECHO_MAX_MS    250 // Longest echo delay (RAM: 94 bytes/ms)
+#define FX_BUDGET_PERCENT 10  // Most CPU time for the whole chain
+// Sample period at AUDIO_OUT_RATE is 2,560 cycles. One stage's block must
+// leave most of its interrupt's period for the other audio work.
+#define FX_PERIOD_CYCLES  (F_CPU / AUDIO_OUT_RATE)
+#define FX_STAGE_CYCLES   (FX_PERIOD_CYCLES * 2 / 5)
+#define FX_BUDGET_CYCLES  (FX_PERIOD_CYCLES * FX_BLOCK * FX_BUDGET_PERCENT / 100)
+
+typedef struct fxStage {
+  void   (*run)(struct fxStage *f, int16_t *x); // Process one block in place
+  int32_t  k1, k2;     // Fixed-point parameters, per type
+  int32_t  z;          // Filter state or held sample
+  uint32_t phase, inc; // Oscillator or hold rate, 0.32 per sample
+  int16_t *buf;        // Echo delay line...
+  uint16_t len, pos;   // ...its length and write position
+} fxStage;
+
+static const char *fxNames[FX_NUM_TYPES] = {
+  "ring", "crush", "lowpass", "highpass", "echo", "distort" };
+
+static fxStage  stage[FX_MAX];
+static uint8_t  stageType[FX_MAX];
+static int16_t  fxBuf[3][FX_BLOCK];
+static uint8_t  fill = 0, work = 1, play = 2; // Roles of the fxBuf blocks
+static uint8_t  fxIndex = 0;                  // Sample within block
+static int16_t  sine[256];                    // Ring oscillator, Q15
+volatile uint8_t  fxStages = 0;               // Effects running, 0 = dry
+volatile uint32_t fxBlocks = 0;               // Blocks through the chain...
+volatile uint32_t fxCycles[FX_MAX];           // ...each stage's cycles on them...
+volatile uint32_t fxCyclesMax[FX_MAX];        // ...and the most for one block
+uint32_t          fxSetupCycles[FX_MAX];      // Measured by fxSetup()
+
+static inline int16_t clip16(int32_t x) {
+  return (x > 32767) ? 32767 : (x < -32768) ? -32768 : x;
+}
+
+// EFFECTS -----------------------------------------------------------------
+
+// k1 = wet, k2 = dry (Q15, summing to 1.0)
+static void fxRing(fxStage *f, int16_t *x) {
+  for(uint8_t i=0; i<FX_BLOCK; i++) {
+    int32_t wet = (x[i] * sine[f->phase >> 24]) >> 15;
+    f->phase   += f->inc;
+    x[i]        = (x[i] * f->k2 + wet * f->k1) >> 15;
+  }
+}
+
+// k1 = mask of bits kept; inc = 0 for no sample-and-hold
+static void fxCrush(fxStage *f, int16_t *x) {
+  for(uint8_t i=0; i<FX_BLOCK; i++) {
+    if(f->inc) {
+      uint32_t p = f->phase + f->inc;
+      if(p < f->phase) f->z = x[i]; // Wrapped, take a new sample
+      f->phase = p;
+    } else {
+      f->z = x[i];
+    }
+    x[i] = f->z & f->k1;
+  }
+}
+
+// k1 = coefficient (Q16); z = output, 20.12 so low cutoffs keep precision
+static void fxLowpass(fxStage *f, int16_t *x) {
+  for(uint8_t i=0; i<FX_BLOCK; i++) {
+    f->z += ((int64_t)(((int32_t)x[i] << 12) - f->z) * f->k1) >> 16;
+    x[i]  = f->z >> 12;
+  }
+}
+
+// Input minus its low-pass
+static void fxHighpass(fxStage *f, int16_t *x) {
+  for(uint8_t i=0; i<FX_BLOCK; i++) {
+    f->z += ((int64_t)(((int32_t)x[i] << 12) - f->z) * f->k1) >> 16;
+    x[i]  = clip16(x[i] - (f->z >> 12));
+  }
+}
+
+// k1 = feedback, k2 = mix (Q15)
+static void fxEcho(fxStage *f, int16_t *x) {
+  for(uint8_t i=0; i<FX_BLOCK; i++) {
+    int32_t d       = f->buf[f->pos];
+    f->buf[f->pos]  = clip16(x[i] + ((d * f->k1) >> 15));
+    if(++f->pos >= f->len) f->pos = 0;
+    x[i]            = clip16(x[i] + ((d * f->k2) >> 15));
+  }
+}
+
+// k1 = drive (Q8). Cubic soft clip, 1.5v - 0.5v^3: small signals come out
+// 1.5x louder, full scale levels off.
+static void fxDistort(fxStage *f, int16_t *x) {
+  for(uint8_t i=0; i<FX_BLOCK; i++) {
+    int32_t v = clip16((x[i] * f->k1) >> 8);
+    x[i]      = clip16((3 * v - ((((v * v) >> 15) * v) >> 15)) >> 1); // Rounding can reach 32768
+  }
+}
+
+static void (* const fxRun[FX_NUM_TYPES])(fxStage *f, int16_t *x) = {
+  fxRing, fxCrush, fxLowpass, fxHighpass, fxEcho, fxDistort };
+
+// SETUP -------------------------------------------------------------------
+
+// Effect type from its config name, -1 if unknown.
+int8_t fxType(const char *name) {
+  for(uint8_t t=0; t<FX_NUM_TYPES; t++) {
+    if(name && !strcasecmp(name, fxNames[t])) return t;
+  }
+  return -1;
+}
+
+const char *fxName(uint8_t i) {
+  return (i < fxStages) ? fxNames[stageType[i]] : "";
+}
+
+// Spec value, or the effect's default if not given (negative)
+static float param(float v, float def, float lo, float hi) {
+  return (v < 0.0) ? def : constrain(v, lo, hi);
+}
+
+// Q16 one-pole coefficient for a cutoff frequency
+static int32_t onePole(float hz) {
+  return (int32_t)(65536.0 * (1.0 - exp(-2.0 * M_PI * hz / AUDIO_OUT_RATE)));
+}
+
+// Set up one stage from its spec, with fresh state. False if out of RAM.
+// Any earlier delay line must already be freed (fxSetup() does).
+static bool stageInit(fxStage *f, const fxSpec *s) {
+  memset(f, 0, sizeof(fxStage));
+  f->run = fxRun[s->type];
+  switch(s->type) {
+   case FX_RING: {
+    float mix = param(s->mix, 1.0, 0.0, 1.0);
+    f->inc    = (uint32_t)(param(s->freq, 30.0, 1.0, 5000.0) / AUDIO_OUT_RATE * 4294967296.0);
+    f->k1     = (int32_t)(mix * 32767.0 + 0.5);
+    f->k2     = 32768 - f->k1;
+    break;
+   }
+   case FX_CRUSH: {
+    int bits = (int)param(s->bits, 8.0, 1.0, 16.0);
+    f->k1    = ~((1 << (16 - bits)) - 1);
+    float hz = param(s->freq, AUDIO_OUT_RATE, 100.0, AUDIO_OUT_RATE);
+    f->inc   = (hz < AUDIO_OUT_RATE) ? (uint32_t)(hz / AUDIO_OUT_RATE * 4294967296.0) : 0;
+    break;
+   }
+   case FX_LOWPASS:
+    f->k1 = onePole(param(s->freq, 3000.0, 20.0, AUDIO_OUT_RATE / 2));
+    break;
+   case FX_HIGHPASS:
+    f->k1 = onePole(param(s->freq, 300.0, 20.0, AUDIO_OUT_RATE / 2));
+    break;
+   case FX_ECHO:
+    f->len = (uint16_t)(param(s->ms, 120.0, 1.0, FX_ECHO_MAX_MS) * AUDIO_OUT_RATE / 1000.0);
+    if(NULL == (f->buf = (int16_t *)malloc(f->len * sizeof(int16_t)))) return false;
+    memset(f->buf, 0, f->len * sizeof(int16_t));
+    f->k1 = (int32_t)(param(s->feedback, 0.35, 0.0, 0.95) * 32767.0 + 0.5);
+    f->k2 = (int32_t)(param(s->mix, 0.5, 0.0, 1.0) * 32767.0 + 0.5);
+    return true;
+   case FX_DISTORT:
+    f->k1 = (int32_t)(param(s->drive, 4.0, 1.0, 32.0) * 256.0 + 0.5);
+    break;
+  }
+  return true;
+}
+
+// Back to fresh state in place, keeping parameters and delay line
+static void stageClear(fxStage *f) {
+  f->z     = 0;
+  f->phase = 0;
+  f->pos   = 0;
+  if(f->buf) memset(f->buf, 0, f->len * sizeof(int16_t));
+}
+
+// Build the effect chain from n specs. Each effect is timed on a block of
+// noise; the chain is refused (voice stays dry, false returned) if any one
+// would overrun its interrupt, all together exceed the CPU budget, or
+// there's not enough RAM. Reasons are printed. Call before voiceSetup()
+// so the measurements aren't disturbed by the audio interrupts; it's also
+// safe to call while they run.
+bool fxSetup(const fxSpec *spec, uint8_t n) {
+  fxStages = 0; // Interrupt stops using the chain from here
+  for(uint8_t i=0; i<FX_MAX; i++) { // Release any previous chain's RAM
+    if(stage[i].buf) {
+      free(stage[i].buf);
+      stage[i].buf = NULL;
+    }
+  }
+  if(!n) return true;
+  if(n > FX_MAX) {
+    Serial.printf("Voice FX: %d effects, max is %d, chain refused\n", n, FX_MAX);
+    return false;
+  }
+
+  for(uint16_t i=0; i<256; i++) {
+    sine[i] = (int16_t)lrintf(sin(M_PI * 2.0 * i / 256.0) * 32767.0);
+  }
+
+  int16_t  test[FX_BLOCK];
+  uint32_t total = 0, seed = 1;
+  bool     ok    = true;
+  for(uint8_t i=0; i<n; i++) {
+    stageType[i] = spec[i].type;
+    if(!stageInit(&stage[i], &spec[i])) {
+      Serial.printf("Voice FX %d (%s): not enough RAM\n", i + 1, fxNames[spec[i].type]);
+      n  = i + 1; // Free through this one
+      ok = false;
+      break;
+    }
+    // Worst of a few runs on full-scale noise
+    uint32_t worst = 0;
+    for(uint8_t pass=0; pass<3; pass++) {
+      for(uint8_t j=0; j<FX_BLOCK; j++) {
+        seed    = seed * 1664525 + 1013904223;
+        test[j] = seed >> 16;
+      }
+      uint32_t startTime = DWT->CYCCNT;
+      stage[i].run(&stage[i], test);
+      uint32_t elapsed   = DWT->CYCCNT - startTime;
+      if(elapsed > worst) worst = elapsed;
+    }
+    fxSetupCycles[i] = worst;
+    total           += worst;
+    Serial.printf("Voice FX %d (%s): %lu cycles/block\n", i + 1, fxNames[spec[i].type],
+                  (unsigned long)worst);
+    if(worst > FX_STAGE_CYCLES) {
+      Serial.printf("Voice FX %d (%s): over %d cycle limit per effect\n", i + 1,
+                    fxNames[spec[i].type], (int)FX_STAGE_CYCLES);
+      ok = false;
+    }
+    stageClear(&stage[i]); // Clear state the test left
+  }
+  if(ok && (total > FX_BUDGET_CYCLES)) {
+    Serial.printf("Voice FX: %lu cycles/block, over %d (%d%% CPU) budget\n",
+                  (unsigned long)total, (int)FX_BUDGET_CYCLES, FX_BUDGET_PERCENT);
+    ok = false;
+  }
+  if(!ok) {
+    for(uint8_t i=0; i<n; i++) {
+      if(stage[i].buf) {
+        free(stage[i].buf);
+        stage[i].buf = NULL;
+      }
+    }
+    Serial.println("Voice FX chain refused, voice is dry");
+    return false;
+  }
+
+  memset(fxBuf, 0, sizeof fxBuf);
+  fxIndex = 0;
+  fxStatsReset();
+  fxStages = n; // Interrupt picks up the chain from here
+  return true;
+}
+
+void fxStatsReset(void) {
+  fxBlocks = 0;
+  for(uint8_t i=0; i<FX_MAX; i++) fxCycles[i] = fxCyclesMax[i] = 0;
+}
+
+// INTERRUPT ---------------------------------------------------------------
+
+// Called from the voice output interrupt with each sample (-32768 to
+// +32767) while fxStages is nonzero; returns the effected sample from two
+// blocks earlier.
+int16_t fxProcess(int16_t s) {
+  fxBuf[fill][fxIndex] = s;
+  int16_t out          = fxBuf[play][fxIndex];
+  if(fxIndex < fxStages) {
+    uint32_t startTime = DWT->CYCCNT;
+    stage[fxIndex].run(&stage[fxIndex], fxBuf[work]);
+    uint32_t elapsed   = DWT->CYCCNT - startTime;
+    fxCycles[fxIndex] += elapsed;
+    if(elapsed > fxCyclesMax[fxIndex]) fxCyclesMax[fxIndex] = elapsed;
+  }
+  if(++fxIndex >= FX_BLOCK) { // Block done, rotate roles
+    uint8_t t = play;
+    play      = work;
+    work      = fill;
+    fill      = t;
+    fxIndex   = 0;
+    fxBlocks++;
+  }
+  return out;
+}
+
+#endif // ADAFRUIT_MONSTER_M4SK_EXPRESS
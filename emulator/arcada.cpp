@@ -0,0 +1,402 @@
+// SPDX-FileCopyrightText: 2024 Monster Mask Open Claw Project
+//
+// SPDX-License-Identifier: MIT
+
+// Board-level libraries: Arcada (displays, filesystem, buttons, light
+// sensor, timer callback), ImageReader's BMP loading, the PDM mic and
+// the other sensors. Sensor values come from the script (script.cpp).
+
+#include "emu.h"
+#include "Adafruit_Arcada.h"
+#include "Adafruit_ZeroPDMSPI.h"
+#include "Adafruit_AMG88xx.h"
+#include "Wire.h"
+#include <sys/stat.h>
+
+Adafruit_SPIFlash Arcada_QSPI_Flash;
+FatFileSystem     Arcada_QSPI_FileSys;
+TwoWire           Wire;
+
+uint16_t emu_light        = 512;
+uint32_t emu_buttons      = 0;
+uint64_t emu_usb_until_ns = 0;
+float    emu_heat[64];
+uint32_t emu_flash_used   = 0;
+
+#define INTERNAL_FLASH (512 * 1024)
+#define SKETCH_FLASH   (180 * 1024) // Roughly what the firmware occupies
+
+// Arcada ----------------------------------------------------------------------
+
+bool Adafruit_Arcada::arcadaBegin(void) {
+  return true;
+}
+
+bool Adafruit_Arcada::filesysBegin(void) {
+  struct stat st;
+  if(stat(emu_fs_root.c_str(), &st) || !S_ISDIR(st.st_mode)) {
+    fprintf(stderr, "emu: filesystem directory %s not found\n", emu_fs_root.c_str());
+    return false;
+  }
+  return Arcada_QSPI_FileSys.begin(&Arcada_QSPI_Flash);
+}
+
+bool Adafruit_Arcada::filesysBeginMSD(void) {
+  return filesysBegin();
+}
+
+void Adafruit_Arcada::displayBegin(void) {
+  Adafruit_ST7789 *right = new Adafruit_ST7789(&ARCADA_TFT_SPI, ARCADA_TFT_CS,
+    ARCADA_TFT_DC, ARCADA_TFT_RST);
+  Adafruit_ST7789 *left  = new Adafruit_ST7789(&ARCADA_LEFTTFT_SPI, ARCADA_LEFTTFT_CS,
+    ARCADA_LEFTTFT_DC, ARCADA_LEFTTFT_RST);
+  right->init(ARCADA_TFT_WIDTH, ARCADA_TFT_HEIGHT);
+  left->init(ARCADA_TFT_WIDTH, ARCADA_TFT_HEIGHT);
+  display = _display = right;
+  display2 = left;
+}
+
+uint32_t Adafruit_Arcada::availableFlash(void) {
+  return INTERNAL_FLASH - SKETCH_FLASH - emu_flash_used;
+}
+
+uint32_t Adafruit_Arcada::readButtons(void) {
+  lastButtons = buttons;
+  buttons     = emu_buttons;
+  justPressed = buttons & ~lastButtons;
+  return buttons;
+}
+
+uint32_t Adafruit_Arcada::justPressedButtons(void) {
+  return justPressed;
+}
+
+bool Adafruit_Arcada::exists(const char *path) {
+  return Arcada_QSPI_FileSys.exists(path);
+}
+
+File Adafruit_Arcada::open(const char *path, uint32_t flags) {
+  return Arcada_QSPI_FileSys.open(path ? path : ".", flags);
+}
+
+File Adafruit_Arcada::openFileByIndex(const char *path, uint16_t index, uint32_t flags,
+  const char *extension) {
+  File dir = open(path), entry;
+  char name[SD_MAX_FILENAME_SIZE];
+  while(entry.openNext(&dir, flags)) {
+    size_t len = entry.getName(name, sizeof name);
+    if(!entry.isDir() && (!extension || ((len > strlen(extension)) &&
+       !strcasecmp(&name[len - strlen(extension)], extension)))) {
+      if(!index--) return entry;
+    }
+    entry.close();
+  }
+  return File();
+}
+
+bool Adafruit_Arcada::chdir(const char *path) {
+  return Arcada_QSPI_FileSys.chdir(path);
+}
+
+bool Adafruit_Arcada::mkdir(const char *path) {
+  return Arcada_QSPI_FileSys.mkdir(path);
+}
+
+bool Adafruit_Arcada::remove(const char *path) {
+  return Arcada_QSPI_FileSys.remove(path);
+}
+
+ImageReturnCode Adafruit_Arcada::drawBMP(char *filename, int16_t x, int16_t y,
+  Adafruit_SPITFT *tft, boolean transact) {
+  return getImageReader()->drawBMP(filename, tft ? *tft : *display, x, y, transact);
+}
+
+Adafruit_ImageReader *Adafruit_Arcada::getImageReader(void) {
+  static Adafruit_ImageReader reader(Arcada_QSPI_FileSys);
+  return &reader;
+}
+
+// Internal flash past the firmware is an array here. Like the library,
+// each write starts on a fresh 8K erase block, so the sketch can erase
+// and rewrite that flash itself through NVMCTRL.
+#define FLASH_BLOCK 8192
+alignas(FLASH_BLOCK) static uint8_t emu_flash[INTERNAL_FLASH - SKETCH_FLASH];
+
+uint8_t *Adafruit_Arcada::writeDataToFlash(uint8_t *src, uint32_t len) {
+  if(len > availableFlash()) return NULL;
+  uint8_t *p = &emu_flash[emu_flash_used];
+  memcpy(p, src, len);
+  emu_flash_used += (len + FLASH_BLOCK - 1) & ~(FLASH_BLOCK - 1);
+  if(emu_flash_used > sizeof emu_flash) emu_flash_used = sizeof emu_flash;
+  return p;
+}
+
+Nvmctrl emu_NVMCTRL = { { }, { }, { { 1 } }, { 0 } }; // STATUS.READY always
+Cmcc    emu_CMCC;
+
+EmuNvmCommand &EmuNvmCommand::operator=(uint32_t v) {
+  if((v & 0x7F) == NVMCTRL_CTRLB_CMD_EB) {
+    uintptr_t a = emu_NVMCTRL.ADDR.reg & ~(uintptr_t)(FLASH_BLOCK - 1);
+    if((a < (uintptr_t)emu_flash) || (a >= (uintptr_t)emu_flash + sizeof emu_flash)) {
+      fprintf(stderr, "emu: NVM erase outside internal flash\n");
+      emu_exit(1);
+    }
+    memset((void *)a, 0xFF, FLASH_BLOCK);
+  }
+  return *this; // Page writes already went straight to the array
+}
+
+uint16_t Adafruit_Arcada::readLightSensor(void) {
+  emu_sync();
+  return emu_light;
+}
+
+// Like the real library, a TC with 1:1 prescale off the 48 MHz clock,
+// so the rate is quantized the same way.
+bool Adafruit_Arcada::timerCallback(float freq, void (*callback)(void)) {
+  uint32_t period = (uint32_t)(48000000.0 / freq);
+  if(!period) return false;
+  timerFreq = 48000000.0 / period;
+  timerFunc = callback;
+  emu_timer_start(EMU_TIMER_AUDIO, timerFreq, callback);
+  return true;
+}
+
+void Adafruit_Arcada::timerStop(void) {
+  emu_timer_stop(EMU_TIMER_AUDIO);
+  timerFunc = nullptr;
+}
+
+bool Adafruit_Arcada::recentUSB(uint32_t timeout) {
+  return emu_usb_until_ns && (emu_now_ns < emu_usb_until_ns + (uint64_t)timeout * 1000000);
+}
+
+// BMP images ------------------------------------------------------------------
+
+static uint32_t le32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+static uint16_t le16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+static uint16_t to565(uint8_t r, uint8_t g, uint8_t b) {
+  return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+}
+
+struct BmpInfo {
+  int32_t  w, h;
+  uint16_t depth;
+  uint32_t comp, offset, rowBytes;
+  bool     bottomUp;
+  uint16_t palette[2];
+};
+
+// Supports what ImageReader does: 1-bit, 24-bit, and 16-bit (565 with
+// BI_BITFIELDS, or 555), uncompressed.
+static ImageReturnCode bmpOpen(FatVolume *fs, char *filename, File &file, BmpInfo *b) {
+  uint8_t h[54];
+  file = fs->open(filename, O_RDONLY);
+  if(!file) return IMAGE_ERR_FILE_NOT_FOUND;
+  if((file.read(h, sizeof h) != sizeof h) || (h[0] != 'B') || (h[1] != 'M')) return IMAGE_ERR_FORMAT;
+  b->offset   = le32(&h[10]);
+  b->w        = (int32_t)le32(&h[18]);
+  b->h        = (int32_t)le32(&h[22]);
+  b->depth    = le16(&h[28]);
+  b->comp     = le32(&h[30]);
+  b->bottomUp = (b->h > 0);
+  if(b->h < 0) b->h = -b->h;
+  if((b->w <= 0) || !b->h || (le16(&h[26]) != 1)) return IMAGE_ERR_FORMAT;
+  if(!((b->depth == 1 && !b->comp) || (b->depth == 24 && !b->comp) ||
+       (b->depth == 16 && (!b->comp || b->comp == 3)))) return IMAGE_ERR_FORMAT;
+  b->rowBytes = ((b->w * b->depth + 31) / 32) * 4;
+  if(b->depth == 1) {
+    uint8_t pal[8];
+    file.seekSet(14 + le32(&h[14]));
+    if(file.read(pal, 8) != 8) return IMAGE_ERR_FORMAT;
+    b->palette[0] = to565(pal[2], pal[1], pal[0]);
+    b->palette[1] = to565(pal[6], pal[5], pal[4]);
+  }
+  return IMAGE_SUCCESS;
+}
+
+// Read image row y (top = 0) into 'row'.
+static bool bmpRow(File &file, const BmpInfo *b, int32_t y, uint8_t *row) {
+  int32_t r = b->bottomUp ? (b->h - 1 - y) : y;
+  return file.seekSet(b->offset + r * b->rowBytes) && (file.read(row, b->rowBytes) == (int)b->rowBytes);
+}
+
+static uint16_t bmpPixel(const BmpInfo *b, const uint8_t *row, int32_t x) {
+  switch(b->depth) {
+   case 1:
+    return b->palette[(row[x / 8] >> (7 - (x & 7))) & 1];
+   case 24:
+    return to565(row[x * 3 + 2], row[x * 3 + 1], row[x * 3]);
+   default: {
+    uint16_t p = le16(&row[x * 2]);
+    return (b->comp == 3) ? p : (((p & 0x7FE0) << 1) | (p & 0x1F)); // 555 -> 565
+   }
+  }
+}
+
+int16_t Adafruit_Image::width(void) const {
+  if(format == IMAGE_1)  return ((GFXcanvas1 *)canvas)->width();
+  if(format == IMAGE_16) return ((GFXcanvas16 *)canvas)->width();
+  return 0;
+}
+
+int16_t Adafruit_Image::height(void) const {
+  if(format == IMAGE_1)  return ((GFXcanvas1 *)canvas)->height();
+  if(format == IMAGE_16) return ((GFXcanvas16 *)canvas)->height();
+  return 0;
+}
+
+void Adafruit_Image::dealloc(void) {
+  if(format == IMAGE_1)       delete (GFXcanvas1 *)canvas;
+  else if(format == IMAGE_16) delete (GFXcanvas16 *)canvas;
+  free(palette);
+  canvas  = nullptr;
+  palette = nullptr;
+  format  = IMAGE_NONE;
+}
+
+ImageReturnCode Adafruit_ImageReader::bmpDimensions(char *filename, int32_t *w, int32_t *h) {
+  File            file;
+  BmpInfo         b;
+  ImageReturnCode status = bmpOpen(filesys, filename, file, &b);
+  if(status == IMAGE_SUCCESS) {
+    if(w) *w = b.w;
+    if(h) *h = b.h;
+  }
+  return status;
+}
+
+ImageReturnCode Adafruit_ImageReader::loadBMP(char *filename, Adafruit_Image &img) {
+  File            file;
+  BmpInfo         b;
+  ImageReturnCode status = bmpOpen(filesys, filename, file, &b);
+  if(status != IMAGE_SUCCESS) return status;
+  img.dealloc();
+  uint8_t *row = (uint8_t *)malloc(b.rowBytes);
+  if(!row) return IMAGE_ERR_MALLOC;
+  if(b.depth == 1) {
+    GFXcanvas1 *canvas = new GFXcanvas1(b.w, b.h);
+    uint16_t   *pal    = (uint16_t *)malloc(2 * sizeof(uint16_t));
+    if(!canvas->getBuffer() || !pal) {
+      delete canvas;
+      free(pal);
+      free(row);
+      return IMAGE_ERR_MALLOC;
+    }
+    int bpl = (b.w + 7) / 8;
+    for(int32_t y=0; y<b.h; y++) {
+      if(!bmpRow(file, &b, y, row)) status = IMAGE_ERR_FORMAT;
+      memcpy(&canvas->getBuffer()[y * bpl], row, bpl);
+    }
+    pal[0]      = b.palette[0];
+    pal[1]      = b.palette[1];
+    img.canvas  = canvas;
+    img.palette = pal;
+    img.format  = IMAGE_1;
+  } else {
+    GFXcanvas16 *canvas = new GFXcanvas16(b.w, b.h);
+    if(!canvas->getBuffer()) {
+      delete canvas;
+      free(row);
+      return IMAGE_ERR_MALLOC;
+    }
+    for(int32_t y=0; y<b.h; y++) {
+      if(!bmpRow(file, &b, y, row)) status = IMAGE_ERR_FORMAT;
+      for(int32_t x=0; x<b.w; x++) canvas->getBuffer()[y * b.w + x] = bmpPixel(&b, row, x);
+    }
+    img.canvas = canvas;
+    img.format = IMAGE_16;
+  }
+  free(row);
+  return status;
+}
+
+ImageReturnCode Adafruit_ImageReader::drawBMP(char *filename, Adafruit_SPITFT &tft,
+  int16_t x, int16_t y, boolean transact) {
+  File            file;
+  BmpInfo         b;
+  ImageReturnCode status = bmpOpen(filesys, filename, file, &b);
+  (void)transact;
+  if(status != IMAGE_SUCCESS) return status;
+  uint8_t  *row = (uint8_t *)malloc(b.rowBytes);
+  uint16_t *pix = (uint16_t *)malloc(b.w * sizeof(uint16_t));
+  if(row && pix) {
+    int16_t x1 = (x < 0) ? 0 : x, x2 = x + b.w;
+    if(x2 > tft.width()) x2 = tft.width();
+    tft.startWrite();
+    for(int32_t r=0; (r<b.h) && (x1 < x2); r++) {
+      if(((y + r) < 0) || ((y + r) >= tft.height())) continue;
+      if(!bmpRow(file, &b, r, row)) {
+        status = IMAGE_ERR_FORMAT;
+        break;
+      }
+      for(int16_t c=x1; c<x2; c++) pix[c - x1] = bmpPixel(&b, row, c - x);
+      tft.setAddrWindow(x1, y + r, x2 - x1, 1);
+      tft.writePixels(pix, x2 - x1);
+    }
+    tft.endWrite();
+  } else {
+    status = IMAGE_ERR_MALLOC;
+  }
+  free(row);
+  free(pix);
+  return status;
+}
+
+// PDM microphone --------------------------------------------------------------
+
+// As in the library: each pair of 32-bit PDM words (one per SERCOM
+// interrupt) is weighted by a 64-tap bell-shaped FIR, summing to 65535
+// for all ones, giving one 16-bit sample; then an optional DC-blocking
+// high-pass and the gain. Default input is silence (50% density).
+static uint32_t silence(void) { return 0xAAAAAAAA; }
+uint32_t (*emu_mic_word)(void) = silence;
+
+static uint16_t sincFilter[64];
+static uint32_t pdmWord; // SERCOM DATA
+
+static void pdmReceive(void) {
+  pdmWord = emu_mic_word();
+}
+
+bool Adafruit_ZeroPDMSPI::begin(float sampleRate) {
+  double w[64], sum = 0.0;
+  for(int i=0; i<64; i++) sum += (w[i] = sin(M_PI * (i + 0.5) / 64.0) * sin(M_PI * (i + 0.5) / 64.0));
+  for(int i=0; i<64; i++) sincFilter[i] = (uint16_t)(w[i] / sum * 65535.0 + 0.5);
+  // Two 32-bit PDM words (interrupts) per output sample
+  emu_timer_start(EMU_TIMER_PDM, sampleRate * 2.0, SERCOM3_0_Handler, pdmReceive);
+  return true;
+}
+
+void Adafruit_ZeroPDMSPI::setMicGain(float g) {
+  gain = (g < 0.0) ? 0.0 : g;
+}
+
+bool Adafruit_ZeroPDMSPI::decimateFilterWord(uint16_t *value, bool removeDC) {
+  static bool     odd = false;
+  static uint32_t sum = 0;
+  static int32_t  x1 = 32768, y1 = 0;
+  uint32_t        word = pdmWord;
+  const uint16_t *tap  = &sincFilter[odd ? 32 : 0];
+  for(int i=0; i<32; i++, word >>= 1) {
+    if(word & 1) sum += tap[i];
+  }
+  if((odd = !odd)) return false;
+  int32_t x = sum, y = x - 32768;
+  sum = 0;
+  if(removeDC) {
+    y  = x - x1 + (y1 * 255) / 256; // ~30 Hz high-pass at 46.9 kHz
+    x1 = x;
+    y1 = y;
+  }
+  y = (int32_t)(y * gain) + 32768;
+  *value = (y < 0) ? 0 : (y > 65535) ? 65535 : y;
+  return true;
+}
+
+// Other sensors ---------------------------------------------------------------
+
+void Adafruit_AMG88xx::readPixels(float *buf, uint8_t size) {
+  emu_sync();
+  memcpy(buf, emu_heat, ((size < 64) ? size : 64) * sizeof(float));
+}
@@ -0,0 +1,142 @@
+// SPDX-FileCopyrightText: 2024 Monster Mask Open Claw Project
+//
+// SPDX-License-Identifier: MIT
+
+// Benchmark baselines. Each program's emu_report() hands its figures to
+// emu_metric() as well as printing them. --baseline-save FILE writes the
+// last value of each to a text file at exit, one metric per line with a
+// tolerance and which direction is better; --baseline FILE compares this
+// run against one, prints a BENCH line per metric, and exits with status
+// 3 if any got worse by more than its tolerance. Tolerances start at the
+// program's defaults and can be edited in the file.
+//
+// A soft reset re-executes the emulator, so the metrics so far are passed
+// to the next boot through a temporary file named after the process ID
+// (which execv() keeps).
+
+#include "emu.h"
+#include <unistd.h>
+#include <map>
+
+struct Metric {
+  double value, tolerance; // Tolerance in percent
+  bool   higherIsBetter;
+};
+
+static std::map<std::string, Metric> metrics;
+static const char *saveFile    = NULL; // --baseline-save
+static const char *compareFile = NULL; // --baseline
+
+void emu_metric(const char *name, double value, bool higherIsBetter, double tolerance) {
+  metrics[name] = { value, tolerance, higherIsBetter };
+}
+
+static bool writeMetrics(const char *filename, const char *header) {
+  FILE *f = fopen(filename, "w");
+  if(!f) {
+    fprintf(stderr, "emu: can't write %s\n", filename);
+    return false;
+  }
+  if(header) fputs(header, f);
+  for(auto &m : metrics) {
+    fprintf(f, "%-32s %14.4f %6.1f %s\n", m.first.c_str(), m.second.value,
+      m.second.tolerance, m.second.higherIsBetter ? "higher" : "lower");
+  }
+  return !fclose(f);
+}
+
+static bool readMetrics(const char *filename, std::map<std::string, Metric> *into) {
+  FILE *f = fopen(filename, "r");
+  char  line[256], name[128], dir[16];
+  int   num = 0;
+  if(!f) {
+    fprintf(stderr, "emu: can't open %s\n", filename);
+    return false;
+  }
+  while(fgets(line, sizeof line, f)) {
+    num++;
+    char *hash = strchr(line, '#');
+    if(hash) *hash = 0;
+    Metric m;
+    int    n = sscanf(line, "%127s %lf %lf %15s", name, &m.value, &m.tolerance, dir);
+    if(n <= 0) continue; // Blank or comment
+    if((n != 4) || (strcmp(dir, "higher") && strcmp(dir, "lower"))) {
+      fprintf(stderr, "emu: %s:%d: expected: name value tolerance%% higher|lower\n", filename, num);
+      fclose(f);
+      return false;
+    }
+    m.higherIsBetter = !strcmp(dir, "higher");
+    (*into)[name]    = m;
+  }
+  fclose(f);
+  return true;
+}
+
+static std::string carryFile(void) {
+  const char *tmp = getenv("TMPDIR");
+  return std::string(tmp ? tmp : "/tmp") + "/m4emu-bench-" + std::to_string(getpid());
+}
+
+// Options; same convention as emu_common_option().
+int emu_bench_option(const char *a, const char *v) {
+  if(strcmp(a, "--baseline") && strcmp(a, "--baseline-save")) return 0;
+  if(!v) return -1;
+  if(!strcmp(a, "--baseline")) compareFile = v;
+  else                         saveFile    = v;
+  return 2;
+}
+
+// Before a soft reset
+void emu_bench_carry(void) {
+  if(saveFile || compareFile) writeMetrics(carryFile().c_str(), NULL);
+}
+
+// At startup, after a soft reset
+void emu_bench_resume(void) {
+  std::string carry = carryFile();
+  if((saveFile || compareFile) && !access(carry.c_str(), R_OK)) {
+    readMetrics(carry.c_str(), &metrics);
+    unlink(carry.c_str());
+  }
+}
+
+// At exit: save and/or compare. Returns the exit status to use.
+int emu_bench_finish(int status) {
+  if(status) return status; // Failed run, nothing to measure
+  if(saveFile && !writeMetrics(saveFile,
+    "# Benchmark baseline: metric, value, tolerance %, better direction.\n"
+    "# Edit tolerances as needed; see emulator/README.md.\n")) status = 1;
+  if(!compareFile) return status;
+
+  std::map<std::string, Metric> base;
+  if(!readMetrics(compareFile, &base)) return 1;
+  uint32_t compared = 0, regressions = 0, improved = 0, missing = 0;
+  for(auto &b : base) {
+    auto m = metrics.find(b.first);
+    if(m == metrics.end()) {
+      fprintf(stderr, "BENCH:%s,baseline=%g,result=missing\n", b.first.c_str(), b.second.value);
+      missing++;
+      continue;
+    }
+    // Change in the "worse" direction, as a percentage of the baseline.
+    // A zero baseline (e.g. glitch counts) allows no increase at all.
+    double diff  = m->second.value - b.second.value,
+           worse = b.second.higherIsBetter ? -diff : diff,
+           pct   = b.second.value ? 100.0 * worse / fabs(b.second.value) : (worse > 0 ? INFINITY : 0.0);
+    const char *result = "ok";
+    if(pct > b.second.tolerance) {
+      result = "REGRESSION";
+      regressions++;
+    } else if(-pct > b.second.tolerance) {
+      result = "better";
+      improved++;
+    }
+    fprintf(stderr, "BENCH:%s,baseline=%g,value=%g,worse=%+.1f%%,tolerance=%.1f%%,result=%s\n",
+      b.first.c_str(), b.second.value, m->second.value, pct, b.second.tolerance, result);
+    compared++;
+  }
+  fprintf(stderr, "BENCH:compared=%lu,regressions=%lu,better=%lu,missing=%lu\n",
+    (unsigned long)compared, (unsigned long)regressions, (unsigned long)improved,
+    (unsigned long)missing);
+  return regressions ? 3 : status;
+}
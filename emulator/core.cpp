@@ -0,0 +1,515 @@
+// SPDX-FileCopyrightText: 2024 Monster Mask Open Claw Project
+//
+// SPDX-License-Identifier: MIT
+
+// Emulator core: virtual clock and event loop, pins, Serial, reset and
+// startup shared by the programs built on it (main.cpp runs the whole
+// sketch, voice.cpp just the voice changer). Everything the sketch code
+// touches below itself is mocked (see mock/) and reports back here.
+//
+// Time is virtual. The sketch's own code is charged the host CPU time it
+// takes, times --cpu-scale (how much slower the M4 is than this machine),
+// whenever it next looks at the clock or touches hardware. Waits (delay(),
+// SPI transfers, spinning on micros()) advance the clock directly. With
+// --cpu-scale 0, only waits and a fixed --poll-ns per clock read count,
+// and a run is exactly repeatable.
+
+#include "emu.h"
+#include "Adafruit_Arcada.h"
+#include "Adafruit_TinyUSB.h"
+#include <time.h>
+#include <unistd.h>
+#include <malloc.h>
+#include <deque>
+#include <random>
+#include <vector>
+
+uint64_t emu_now_ns    = 0;
+double   emu_cpu_scale = 10.0;
+uint32_t emu_poll_ns   = 50;
+
+uint64_t emu_run_limit_ns = 10000ull * 1000000; // --run-ms
+uint64_t emu_host_start   = 0;
+uint64_t emu_boot_ns      = 0;     // Virtual time this boot started
+uint32_t emu_boot_count   = 1;
+
+static uint64_t hostMark    = 0;     // Host time at end of last sync
+static uint64_t clockCost   = 0;     // Host ns per emu_host_ns() call
+static bool     inEvents    = false; // Running events or an ISR
+static bool     echoSerial  = true;
+static uint32_t freeRam     = 180000; // --free-ram, before heap use
+static size_t   heapBase    = 0;
+
+static char   **savedArgv;
+static int      savedArgc;
+
+uint64_t emu_host_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Periodic interrupts -----------------------------------------------------
+
+static struct {
+  uint64_t next, period;
+  void   (*fn)(void);
+  void   (*pre)(void); // Untimed, e.g. peripheral receiving data
+  uint32_t calls;
+  uint64_t hostNs;  // Host time spent in fn
+} timer[EMU_NUM_TIMERS];
+
+void emu_timer_start(uint8_t id, double hz, void (*fn)(void), void (*pre)(void)) {
+  timer[id].period = (uint64_t)(1e9 / hz + 0.5);
+  timer[id].next   = emu_now_ns + timer[id].period;
+  timer[id].fn     = fn;
+  timer[id].pre    = pre;
+}
+
+void emu_timer_stop(uint8_t id) {
+  timer[id].fn = NULL;
+}
+
+void emu_timer_stats(uint8_t id, uint32_t *calls, uint64_t *hostNs) {
+  *calls  = timer[id].calls;
+  *hostNs = timer[id].hostNs;
+}
+
+uint64_t emu_run_isr(void (*fn)(void)) {
+  bool     nested = inEvents;
+  uint64_t t      = emu_host_ns();
+  inEvents = true;
+  fn();
+  inEvents = nested;
+  uint64_t dt = emu_host_ns() - t;
+  dt = (dt > clockCost) ? (dt - clockCost) : 0;
+  emu_now_ns += (uint64_t)((double)dt * emu_cpu_scale);
+  return dt;
+}
+
+// Fire everything due at or before emu_now_ns, in time order.
+static void runEvents(void) {
+  inEvents = true;
+  for(;;) {
+    if(emu_now_ns >= emu_run_limit_ns) {
+      emu_report("end");
+      emu_exit(0);
+    }
+    uint64_t t = emu_dma_next_done();
+    int      src = -1;           // -1 = DMA, 0+ = timer, EMU_NUM_TIMERS = script
+    for(int i=0; i<EMU_NUM_TIMERS; i++) {
+      if(timer[i].fn && (timer[i].next < t)) {
+        t   = timer[i].next;
+        src = i;
+      }
+    }
+    if(emu_script_next() < t) {
+      t   = emu_script_next();
+      src = EMU_NUM_TIMERS;
+    }
+    if(t > emu_now_ns) break;
+    if(src < 0) {
+      emu_dma_complete_due();
+    } else if(src < EMU_NUM_TIMERS) {
+      timer[src].next   += timer[src].period;
+      if(timer[src].pre) timer[src].pre();
+      timer[src].hostNs += emu_run_isr(timer[src].fn);
+      timer[src].calls++;
+    } else {
+      emu_script_run_due();
+    }
+  }
+  inEvents = false;
+}
+
+void emu_sync(void) {
+  if(inEvents) return; // Inside an ISR; charged as a whole afterward
+  uint64_t h  = emu_host_ns();
+  uint64_t dt = h - hostMark;
+  dt = (dt > clockCost) ? (dt - clockCost) : 0;
+  emu_now_ns += (uint64_t)((double)dt * emu_cpu_scale) + emu_poll_ns;
+  runEvents();
+  hostMark = emu_host_ns(); // Emulator's own work isn't charged
+}
+
+void emu_wait_until(uint64_t ns) {
+  emu_sync();
+  if(inEvents) return;
+  while(emu_now_ns < ns) {
+    // Step through events on the way so ISR time lengthens the wait
+    uint64_t next = emu_dma_next_done();
+    for(int i=0; i<EMU_NUM_TIMERS; i++) {
+      if(timer[i].fn && (timer[i].next < next)) next = timer[i].next;
+    }
+    if(emu_script_next() < next) next = emu_script_next();
+    emu_now_ns = (next < ns) ? ((next > emu_now_ns) ? next : emu_now_ns) : ns;
+    if(emu_now_ns > emu_run_limit_ns) emu_now_ns = emu_run_limit_ns;
+    runEvents();
+  }
+  hostMark = emu_host_ns();
+}
+
+uint32_t micros(void) {
+  emu_sync();
+  return (uint32_t)(emu_now_ns / 1000);
+}
+
+uint32_t millis(void) {
+  emu_sync();
+  return (uint32_t)(emu_now_ns / 1000000);
+}
+
+void delay(uint32_t ms) {
+  emu_wait_until(emu_now_ns + (uint64_t)ms * 1000000);
+}
+
+void delayMicroseconds(uint32_t us) {
+  emu_wait_until(emu_now_ns + (uint64_t)us * 1000);
+}
+
+void yield(void) {
+  emu_sync();
+}
+
+// Cortex-M registers ------------------------------------------------------
+
+Dmac           emu_DMAC;
+SysTick_Type   emu_SysTick;
+Rtc            emu_RTC;
+DWT_Type       emu_DWT;
+CoreDebug_Type emu_CoreDebug;
+Port           emu_PORT;
+Gclk           emu_GCLK;
+static Tcc     emu_TCC[TCC_INST_NUM];
+static Tc      emu_TC[TC_INST_NUM];
+void          *g_apTCInstances[TCC_INST_NUM + TC_INST_NUM] = {
+  &emu_TCC[0], &emu_TCC[1], &emu_TCC[2], &emu_TCC[3], &emu_TCC[4],
+  &emu_TC[0], &emu_TC[1], &emu_TC[2], &emu_TC[3], &emu_TC[4], &emu_TC[5]
+};
+
+EmuCycleCounter::operator uint32_t() const {
+  emu_sync();
+  return (uint32_t)(emu_now_ns * 120 / 1000); // 120 MHz
+}
+
+EmuCycleCounter &EmuCycleCounter::operator=(uint32_t v) {
+  (void)v; // Free-running; the sketch only takes differences
+  return *this;
+}
+
+// Pins ----------------------------------------------------------------------
+
+#define P(n)  { (n) / 32, (n) % 32, 0, 0, 0, 0, 0, 0 }
+#define P8(n) P(n), P(n+1), P(n+2), P(n+3), P(n+4), P(n+5), P(n+6), P(n+7)
+extern const PinDescription g_APinDescription[EMU_NUM_PINS] = {
+  P8(0), P8(8), P8(16), P8(24), P8(32), P8(40), P8(48), P8(56)
+};
+
+static bool     pinLevel[EMU_NUM_PINS];  // Output level, or input as read
+static uint8_t  pinMode_[EMU_NUM_PINS];
+static bool     pinForced[EMU_NUM_PINS]; // Input level set by script
+static uint16_t pinCharge[EMU_NUM_PINS]; // Reads left before RC decays
+static int      pinAnalog[EMU_NUM_PINS];
+static uint16_t boopCount = 0;           // RC decay reads (script "boop")
+int             emu_dac[2] = { 2048, 2048 };
+static int      dacBits = 10;
+
+static void setLevel(int pin, bool level) {
+  if((pin < 0) || (pin >= EMU_NUM_PINS) || (pinLevel[pin] == level)) return;
+  pinLevel[pin] = level;
+  uint32_t bit  = 1ul << (pin % 32);
+  if(level) emu_PORT.Group[pin / 32].OUT.reg.value |=  bit;
+  else      emu_PORT.Group[pin / 32].OUT.reg.value &= ~bit;
+  emu_bus_pin_changed(pin);
+}
+
+bool emu_pin_level(int pin) {
+  return ((pin >= 0) && (pin < EMU_NUM_PINS)) ? pinLevel[pin] : false;
+}
+
+void emu_pin_input(int pin, bool level) {
+  if((pin < 0) || (pin >= EMU_NUM_PINS)) return;
+  pinForced[pin] = true;
+  pinLevel[pin]  = level;
+}
+
+void emu_analog_input(int pin, int value) {
+  if((pin >= 0) && (pin < EMU_NUM_PINS)) pinAnalog[pin] = value;
+}
+
+void emu_boop_input(uint16_t count) {
+  boopCount = count;
+}
+
+EmuPortReg &EmuPortReg::operator=(uint32_t v) {
+  uintptr_t off   = (uintptr_t)this - (uintptr_t)&emu_PORT;
+  int       group = off / sizeof(PortGroup);
+  int       reg   = (off % sizeof(PortGroup)) / sizeof(PortReg);
+  PortGroup *g    = &emu_PORT.Group[group];
+  uint32_t  out   = g->OUT.reg.value;
+  switch(reg) {
+   case 4: out  = v;  break; // OUT
+   case 5: out &= ~v; break; // OUTCLR
+   case 6: out |= v;  break; // OUTSET
+   case 7: out ^= v;  break; // OUTTGL
+   default: value = v; return *this;
+  }
+  emu_sync();
+  for(int b=0; b<32; b++) {
+    int pin = group * 32 + b;
+    if(pin < EMU_NUM_PINS) setLevel(pin, (out >> b) & 1);
+  }
+  g->OUT.reg.value = out;
+  return *this;
+}
+
+EmuPortReg::operator uint32_t() const {
+  uintptr_t off = (uintptr_t)this - (uintptr_t)&emu_PORT;
+  if(((off % sizeof(PortGroup)) / sizeof(PortReg)) == 8) { // IN
+    uint32_t in = 0;
+    for(int b=0; b<32; b++) {
+      int pin = (off / sizeof(PortGroup)) * 32 + b;
+      if((pin < EMU_NUM_PINS) && pinLevel[pin]) in |= 1ul << b;
+    }
+    return in;
+  }
+  return value;
+}
+
+void pinMode(int pin, int mode) {
+  if((pin < 0) || (pin >= EMU_NUM_PINS)) return;
+  // A pin driven high then switched to input holds its charge for a
+  // while (the nose booper's RC sense); script "boop" sets how long.
+  if((mode == INPUT) && (pinMode_[pin] == OUTPUT) && pinLevel[pin] && !pinForced[pin]) {
+    pinCharge[pin] = boopCount;
+  }
+  pinMode_[pin] = mode;
+}
+
+void digitalWrite(int pin, int val) {
+  emu_sync();
+  if((pin >= 0) && (pin < EMU_NUM_PINS) && (pinMode_[pin] == OUTPUT || !pinForced[pin])) {
+    setLevel(pin, val != LOW);
+  }
+}
+
+int digitalRead(int pin) {
+  emu_sync();
+  if((pin < 0) || (pin >= EMU_NUM_PINS)) return LOW;
+  if(pinCharge[pin]) {
+    if(!--pinCharge[pin]) pinLevel[pin] = false;
+    return HIGH;
+  }
+  if((pinMode_[pin] != OUTPUT) && !pinForced[pin] && pinLevel[pin]) {
+    pinLevel[pin] = false; // Undriven input discharges
+  }
+  return pinLevel[pin] ? HIGH : LOW;
+}
+
+int analogRead(int pin) {
+  emu_sync();
+  return ((pin >= 0) && (pin < EMU_NUM_PINS)) ? pinAnalog[pin] : 0;
+}
+
+void analogWriteResolution(int bits) {
+  dacBits = bits;
+}
+
+void (*emu_dac_hook)(int channel, int value) = NULL;
+
+void analogWrite(int pin, int val) {
+  int ch = (pin == A0) ? 0 : (pin == A1) ? 1 : -1;
+  if(ch < 0) return;
+  emu_dac[ch] = val << (12 - dacBits);
+  if(emu_dac_hook) emu_dac_hook(ch, emu_dac[ch]);
+}
+
+static std::mt19937 rng(1);
+
+void randomSeed(unsigned long seed) {
+  rng.seed(seed);
+}
+
+long random(long howbig) {
+  return (howbig > 0) ? (long)(rng() % (uint32_t)howbig) : 0;
+}
+
+long random(long howsmall, long howbig) {
+  return (howsmall >= howbig) ? howsmall : howsmall + random(howbig - howsmall);
+}
+
+// The sketch reports free RAM as stack top minus sbrk(0); on the host
+// that's meaningless, so sbrk(0) is placed to give --free-ram less
+// whatever the sketch has since taken from the heap.
+extern "C" void *emu_sbrk(intptr_t incr) {
+  char  *here = (char *)__builtin_frame_address(0);
+  size_t used = mallinfo2().uordblks - heapBase;
+  (void)incr;
+  return here - ((used < freeRam) ? (freeRam - used) : 0);
+}
+
+// Serial --------------------------------------------------------------------
+
+EmuSerial Serial;
+static std::deque<char> serialIn;
+bool emu_host_reading = true;
+
+size_t Print::printf(const char *fmt, ...) {
+  char    buf[512];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(buf, sizeof buf, fmt, ap);
+  va_end(ap);
+  if(n < 0) return 0;
+  if(n >= (int)sizeof buf) n = sizeof buf - 1;
+  return write((const uint8_t *)buf, n);
+}
+
+size_t Print::print(int n, int base)           { return print((long)n, base); }
+size_t Print::print(unsigned int n, int base)  { return print((unsigned long)n, base); }
+size_t Print::print(long n, int base) {
+  return (base == HEX) ? printf("%lX", n) : printf("%ld", n);
+}
+size_t Print::print(unsigned long n, int base) {
+  return (base == HEX) ? printf("%lX", n) : printf("%lu", n);
+}
+size_t Print::print(double d, int digits)      { return printf("%.*f", digits, d); }
+
+size_t EmuSerial::write(uint8_t c) {
+  if(echoSerial) fputc(c, stdout);
+  return 1;
+}
+
+int EmuSerial::available(void) {
+  emu_sync();
+  return serialIn.size();
+}
+
+int EmuSerial::read(void) {
+  if(serialIn.empty()) return -1;
+  char c = serialIn.front();
+  serialIn.pop_front();
+  return (uint8_t)c;
+}
+
+int EmuSerial::availableForWrite(void) {
+  return emu_host_reading ? 256 : 0;
+}
+
+void emu_serial_inject(const char *line) {
+  while(*line) serialIn.push_back(*line++);
+  serialIn.push_back('\n');
+}
+
+// USB MIDI --------------------------------------------------------------------
+
+Adafruit_USBD_Device         TinyUSBDevice;
+static std::deque<uint32_t>  midiIn; // USB-MIDI packets, byte 0 in low bits
+
+void emu_midi_inject(uint8_t status, uint8_t data1, uint8_t data2) {
+  midiIn.push_back((status >> 4) | (status << 8) | (data1 << 16) | ((uint32_t)data2 << 24));
+}
+
+uint32_t tud_midi_available(void) {
+  return midiIn.size();
+}
+
+bool tud_midi_packet_read(uint8_t packet[4]) {
+  if(midiIn.empty()) return false;
+  uint32_t p = midiIn.front();
+  midiIn.pop_front();
+  memcpy(packet, &p, 4);
+  return true;
+}
+
+// The TinyUSB task, which the core runs after each return from loop()
+void emu_usb_task(void) {
+  emu_sync();
+  if(!midiIn.empty() && tud_midi_rx_cb) tud_midi_rx_cb(0);
+}
+
+// Reset -----------------------------------------------------------------------
+
+// A soft reset (MOOD:next etc.) re-executes the emulator, passing along
+// the virtual time and the RTC backup registers that survive a real one.
+void NVIC_SystemReset(void) {
+  emu_report("reset");
+  emu_bench_carry();
+  fflush(stdout);
+  char state[160];
+  int  n = snprintf(state, sizeof state, "%llu,%u", (unsigned long long)emu_now_ns, emu_boot_count + 1);
+  for(int i=0; i<8; i++) {
+    n += snprintf(&state[n], sizeof state - n, ",%u", (unsigned)emu_RTC.MODE0.BKUP[i].reg);
+  }
+  std::vector<char *> args;
+  for(int i=0; i<savedArgc; i++) {
+    if(!strcmp(savedArgv[i], "--resume")) { i++; continue; }
+    args.push_back(savedArgv[i]);
+  }
+  args.push_back((char *)"--resume");
+  args.push_back(state);
+  args.push_back(NULL);
+  execv("/proc/self/exe", args.data());
+  perror("emu: reset failed");
+  emu_exit(1);
+}
+
+// Startup -------------------------------------------------------------------
+
+// Options every program takes. Returns the number of arguments used (1
+// or 2), 0 if 'a' isn't one of these, or -1 if its value is missing.
+int emu_common_option(const char *a, const char *v) {
+  int n = emu_bench_option(a, v);
+  if(n) return n;
+  if(!strcmp(a, "--quiet")) {
+    echoSerial = false;
+    return 1;
+  }
+  if(strcmp(a, "--fs") && strcmp(a, "--script") && strcmp(a, "--run-ms") &&
+     strcmp(a, "--cpu-scale") && strcmp(a, "--poll-ns") && strcmp(a, "--free-ram") &&
+     strcmp(a, "--resume")) return 0;
+  if(!v) return -1;
+  if(!strcmp(a, "--fs"))              emu_fs_root      = v;
+  else if(!strcmp(a, "--script"))   { if(!emu_script_load(v)) emu_exit(2); }
+  else if(!strcmp(a, "--run-ms"))     emu_run_limit_ns = strtoull(v, NULL, 0) * 1000000;
+  else if(!strcmp(a, "--cpu-scale"))  emu_cpu_scale    = atof(v);
+  else if(!strcmp(a, "--poll-ns"))    emu_poll_ns      = strtoul(v, NULL, 0);
+  else if(!strcmp(a, "--free-ram"))   freeRam          = strtoul(v, NULL, 0);
+  else { // --resume
+    unsigned long long t;
+    unsigned           b[8];
+    if(sscanf(v, "%llu,%u,%u,%u,%u,%u,%u,%u,%u,%u", &t, &emu_boot_count,
+      &b[0], &b[1], &b[2], &b[3], &b[4], &b[5], &b[6], &b[7]) != 10) return -1;
+    emu_now_ns = emu_boot_ns = t;
+    for(int j=0; j<8; j++) emu_RTC.MODE0.BKUP[j].reg = b[j];
+  }
+  return 2;
+}
+
+// Call first thing in main(); keeps argv for soft resets.
+void emu_init(int argc, char *argv[]) {
+  // The sketch stores RAM addresses in 32-bit DMA descriptor fields, so
+  // keep the heap in the (non-PIE, low) brk region, never mmap()ed.
+  mallopt(M_MMAP_MAX, 0);
+  savedArgc = argc;
+  savedArgv = argv;
+}
+
+// Call after options are parsed, just before running sketch code.
+void emu_start(void) {
+  void *probe = malloc(16);
+  if(((uintptr_t)probe >> 32) || ((uintptr_t)&emu_now_ns >> 32)) {
+    fprintf(stderr, "emu: sketch memory above 4 GB, build with -no-pie\n");
+    exit(1);
+  }
+  free(probe);
+
+  emu_script_resume(emu_now_ns);
+  if(emu_boot_count > 1) emu_bench_resume();
+  for(int i=0; i<1000; i++) emu_host_ns(); // Warm up, then measure
+  uint64_t t = emu_host_ns();
+  for(int i=0; i<1000; i++) emu_host_ns();
+  clockCost      = (emu_host_ns() - t) / 1000;
+  heapBase       = mallinfo2().uordblks;
+  emu_host_start = hostMark = emu_host_ns();
+}
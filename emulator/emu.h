@@ -0,0 +1,107 @@
+// SPDX-FileCopyrightText: 2024 Monster Mask Open Claw Project
+//
+// SPDX-License-Identifier: MIT
+
+// Emulator internals shared between the emulator's own source files.
+// The sketch never sees this; it only sees the mock library headers.
+
+#ifndef _EMU_H_
+#define _EMU_H_
+
+#include "Arduino.h"
+#include "SPI.h"
+#include "Adafruit_ZeroDMA.h"
+#include <string>
+
+// Virtual clock (core.cpp) -------------------------------------------------
+
+extern uint64_t emu_now_ns;       // Virtual time since power-on
+extern double   emu_cpu_scale;    // Virtual ns per host ns of sketch code
+extern uint32_t emu_poll_ns;      // Minimum charge per clock read (spin loops)
+extern uint64_t emu_run_limit_ns; // Report and exit at this virtual time
+extern uint64_t emu_boot_ns;      // Virtual time this boot started
+extern uint32_t emu_boot_count;
+extern uint64_t emu_host_start;   // Host time sketch code started
+
+void     emu_sync(void);                // Charge CPU time, run due events
+void     emu_wait_until(uint64_t ns);   // CPU idles until then
+uint64_t emu_host_ns(void);             // Host monotonic clock
+uint64_t emu_run_isr(void (*fn)(void)); // Call sketch ISR, charge its time,
+                                        // return host ns it took
+
+// Periodic interrupt sources (timer/counter callback, PDM SERCOM)
+enum { EMU_TIMER_AUDIO, EMU_TIMER_PDM, EMU_NUM_TIMERS };
+void     emu_timer_start(uint8_t id, double hz, void (*fn)(void), void (*pre)(void) = NULL);
+void     emu_timer_stop(uint8_t id);
+void     emu_timer_stats(uint8_t id, uint32_t *calls, uint64_t *hostNs);
+
+// Startup (core.cpp)
+void     emu_init(int argc, char *argv[]);
+int      emu_common_option(const char *a, const char *v);
+void     emu_start(void);
+
+// Pins (core.cpp) -----------------------------------------------------------
+
+#define EMU_NUM_PINS 64
+bool     emu_pin_level(int pin);
+void     emu_pin_input(int pin, bool level);
+void     emu_analog_input(int pin, int value);
+void     emu_boop_input(uint16_t count);
+extern int emu_dac[2];         // Last analogWrite() to A0, A1 (12 bits)
+extern void (*emu_dac_hook)(int channel, int value); // Each DAC write
+
+// SPI buses, panels and DMA (spi.cpp) ---------------------------------------
+
+struct EmuBusStats {
+  uint64_t busyNs;       // Time the bus spent shifting bytes
+  uint64_t bytes;
+  uint32_t dmaJobs;
+  uint32_t dcGlitches;   // DC or CS changed while bytes still on the wire
+  uint32_t lostBytes;    // Bytes sent with the panel deselected
+};
+uint64_t emu_bus_send(SPIClass *spi, const uint8_t *buf, size_t n, bool cpuWaits);
+void     emu_bus_pin_changed(int pin);
+void     emu_bus_stats(SPIClass *spi, EmuBusStats *s);
+void     emu_dma_complete_due(void);
+uint64_t emu_dma_next_done(void);
+void     emu_dma_stall(uint8_t channel); // Drop this channel's next completion
+bool     emu_screenshot(const char *filename);
+
+// Filesystem and flash (fs.cpp) ---------------------------------------------
+
+extern std::string emu_fs_root;  // Host directory standing in for QSPI flash
+extern uint32_t    emu_flash_used;
+
+// Sensors, buttons and host activity (arcada.cpp) ---------------------------
+
+extern uint16_t emu_light;         // readLightSensor() value
+extern uint32_t emu_buttons;       // ARCADA_BUTTONMASK_* bits held
+extern uint64_t emu_usb_until_ns;  // Mass storage host busy until then
+extern bool     emu_host_reading;  // false = USB CDC transmit buffer stays full
+extern float    emu_heat[64];      // AMG88xx frame
+extern uint32_t (*emu_mic_word)(void); // Next 32 PDM mic bits, first in bit 0
+
+// Script (script.cpp) -------------------------------------------------------
+
+bool     emu_script_load(const char *filename);
+uint64_t emu_script_next(void);     // Time of next event, or UINT64_MAX
+void     emu_script_run_due(void);
+void     emu_script_resume(uint64_t ns); // Re-apply input state up to ns
+void     emu_serial_inject(const char *line);
+void     emu_midi_inject(uint8_t status, uint8_t data1, uint8_t data2);
+void     emu_usb_task(void);        // After each loop(), as the core's yield()
+
+// Benchmark baselines (bench.cpp) -------------------------------------------
+
+void     emu_metric(const char *name, double value, bool higherIsBetter, double tolerance);
+int      emu_bench_option(const char *a, const char *v);
+void     emu_bench_carry(void);       // Before soft reset
+void     emu_bench_resume(void);      // After soft reset
+int      emu_bench_finish(int status); // At exit, returns new status
+
+// Per program (main.cpp, voice.cpp) -----------------------------------------
+
+void     emu_report(const char *why);
+void     emu_exit(int status);
+
+#endif // _EMU_H_
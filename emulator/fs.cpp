@@ -0,0 +1,297 @@
+// SPDX-FileCopyrightText: 2024 Monster Mask Open Claw Project
+//
+// SPDX-License-Identifier: MIT
+
+// Filesystem and QSPI flash. SdFat's File and volume calls map onto a
+// host directory, matching path components case-insensitively like FAT.
+// So that raw-sector fast paths (assetRead(), the block cache) have
+// something to read, each file is given a contiguous run of 512-byte
+// flash sectors the first time it's asked for one, and flash reads in
+// that run come from the file. Everything else in flash reads as 0xFF.
+
+#include "emu.h"
+#include "SdFat.h"
+#include "Adafruit_SPIFlash.h"
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+#ifndef EMU_DEFAULT_FS
+#define EMU_DEFAULT_FS "."
+#endif
+
+std::string        emu_fs_root = EMU_DEFAULT_FS;
+static std::string cwd         = "/"; // Sketch-side, set by chdir()
+
+static std::vector<std::string> listDir(const std::string &hostPath) {
+  std::vector<std::string> names;
+  DIR *d = opendir(hostPath.c_str());
+  if(d) {
+    struct dirent *e;
+    while((e = readdir(d))) {
+      if(strcmp(e->d_name, ".") && strcmp(e->d_name, "..")) names.push_back(e->d_name);
+    }
+    closedir(d);
+  }
+  std::sort(names.begin(), names.end()); // readdir order isn't repeatable
+  return names;
+}
+
+// Sketch path (absolute, or relative to chdir()) to normalized sketch
+// path and host path. A missing last component is allowed if creating.
+static bool resolve(const char *path, std::string *host, std::string *norm = NULL,
+  bool create = false) {
+  std::string full = (path && (*path == '/')) ? path : cwd + "/" + (path ? path : "");
+  std::vector<std::string> parts;
+  size_t i = 0;
+  while(i < full.size()) {
+    size_t j = full.find('/', i);
+    if(j == std::string::npos) j = full.size();
+    std::string c = full.substr(i, j - i);
+    if(c == "..") {
+      if(!parts.empty()) parts.pop_back();
+    } else if(!c.empty() && (c != ".")) {
+      parts.push_back(c);
+    }
+    i = j + 1;
+  }
+  std::string h = emu_fs_root, n;
+  for(size_t p=0; p<parts.size(); p++) {
+    std::string match;
+    for(auto &name : listDir(h)) {
+      if(!strcasecmp(name.c_str(), parts[p].c_str())) {
+        match = name;
+        break;
+      }
+    }
+    if(match.empty()) {
+      if(!create || (p != parts.size() - 1)) return false;
+      match = parts[p];
+    }
+    h += "/" + match;
+    n += "/" + match;
+  }
+  if(host) *host = h;
+  if(norm) *norm = n.empty() ? "/" : n;
+  return true;
+}
+
+// Flash sector runs -------------------------------------------------------
+
+struct Extent {
+  std::string path;
+  uint32_t    first, count;
+};
+static std::vector<Extent> extents;
+static uint32_t            nextSector = 64; // Past the FAT, roughly
+
+static const Extent *extentFor(const char *path, uint32_t size) {
+  uint32_t need = (size + 511) / 512;
+  for(auto &e : extents) {
+    if(e.path == path) {
+      if(e.count >= need) return &e;
+      e.path.clear(); // Grew, needs a new run
+    }
+  }
+  extents.push_back({ path, nextSector, need });
+  nextSector += need;
+  return &extents.back();
+}
+
+static void extentDrop(const char *path) {
+  for(auto &e : extents) {
+    if(e.path == path) e.path.clear();
+  }
+}
+
+static uint32_t flashRead(uint32_t addr, uint8_t *dst, uint32_t len) {
+  memset(dst, 0xFF, len);
+  uint32_t sector = addr / 512;
+  for(auto &e : extents) {
+    if(!e.path.empty() && (sector >= e.first) && (sector < e.first + e.count)) {
+      FILE *f = fopen(e.path.c_str(), "rb");
+      if(f) {
+        fseek(f, addr - e.first * 512, SEEK_SET);
+        uint32_t max = (e.first + e.count) * 512 - addr;
+        fread(dst, 1, (len < max) ? len : max, f);
+        fclose(f);
+      }
+      break;
+    }
+  }
+  return len;
+}
+
+uint32_t Adafruit_SPIFlash::readBuffer(uint32_t addr, uint8_t *dst, uint32_t len) {
+  readCalls++;
+  return flashRead(addr, dst, len);
+}
+
+bool Adafruit_SPIFlash::readBlocks(uint32_t block, uint8_t *dst, size_t nb) {
+  blocksRead += nb;
+  for(size_t i=0; i<nb; i++) flashRead((block + i) * 512, &dst[i * 512], 512);
+  return true;
+}
+
+bool Adafruit_SPIFlash::writeBlocks(uint32_t block, const uint8_t *src, size_t nb) {
+  (void)block; (void)src; (void)nb;
+  return true; // File writes land in the host files; raw sectors aren't kept
+}
+
+// File32 ----------------------------------------------------------------------
+
+static bool openHost(File32 *f, const std::string &hostPath, oflag_t oflag) {
+  struct stat st;
+  bool exists = !stat(hostPath.c_str(), &st);
+  f->close();
+  snprintf(f->path, sizeof f->path, "%s", hostPath.c_str());
+  f->flags  = oflag;
+  f->dirPos = 0;
+  if(exists && S_ISDIR(st.st_mode)) {
+    f->dir = true;
+    return true;
+  }
+  const char *mode = "rb";
+  if(oflag & O_WRITE) {
+    if(!exists && !(oflag & O_CREAT)) return false;
+    mode = (!exists || (oflag & O_TRUNC)) ? "w+b" : "r+b";
+    extentDrop(f->path);
+  }
+  if(!(f->fp = fopen(hostPath.c_str(), mode))) return false;
+  if(oflag & O_APPEND) fseek((FILE *)f->fp, 0, SEEK_END);
+  return true;
+}
+
+File32::File32(const File32 &o) {
+  *this = o;
+}
+
+File32 &File32::operator=(const File32 &o) {
+  if(this == &o) return *this;
+  close();
+  memcpy(path, o.path, sizeof path);
+  flags  = o.flags;
+  dir    = o.dir;
+  dirPos = o.dirPos;
+  if(o.fp && (fp = fopen(path, (flags & O_WRITE) ? "r+b" : "rb"))) {
+    fseek((FILE *)fp, ftell((FILE *)o.fp), SEEK_SET);
+  }
+  return *this;
+}
+
+File32::~File32(void) {
+  close();
+}
+
+bool File32::open(const char *p, oflag_t oflag) {
+  std::string host;
+  if(!resolve(p, &host, NULL, oflag & O_CREAT)) return false;
+  return openHost(this, host, oflag);
+}
+
+bool File32::openNext(File32 *d, oflag_t oflag) {
+  if(!d || !d->dir) return false;
+  std::vector<std::string> names = listDir(d->path);
+  if(d->dirPos >= (int)names.size()) return false;
+  return openHost(this, std::string(d->path) + "/" + names[d->dirPos++], oflag);
+}
+
+bool File32::close(void) {
+  if(fp) fclose((FILE *)fp);
+  fp  = nullptr;
+  dir = false;
+  return true;
+}
+
+int File32::read(void) {
+  return fp ? fgetc((FILE *)fp) : -1;
+}
+
+int File32::read(void *buf, size_t n) {
+  return fp ? (int)fread(buf, 1, n, (FILE *)fp) : -1;
+}
+
+size_t File32::write(const void *buf, size_t n) {
+  if(!fp || !(flags & O_WRITE)) return 0;
+  extentDrop(path);
+  return fwrite(buf, 1, n, (FILE *)fp);
+}
+
+bool File32::seekSet(uint32_t pos) {
+  return fp && !fseek((FILE *)fp, pos, SEEK_SET);
+}
+
+bool File32::seekCur(int32_t off) {
+  return fp && !fseek((FILE *)fp, off, SEEK_CUR);
+}
+
+uint32_t File32::curPosition(void) const {
+  return fp ? ftell((FILE *)fp) : 0;
+}
+
+uint32_t File32::fileSize(void) const {
+  struct stat st;
+  return (fp && !fstat(fileno((FILE *)fp), &st)) ? st.st_size : 0;
+}
+
+bool File32::sync(void) {
+  return fp && !fflush((FILE *)fp);
+}
+
+size_t File32::getName(char *name, size_t size) {
+  const char *base = strrchr(path, '/');
+  base = base ? base + 1 : path;
+  size_t len = strlen(base);
+  if(!isOpen() || (len + 1 > size)) return 0;
+  memcpy(name, base, len + 1);
+  return len;
+}
+
+bool File32::contiguousRange(uint32_t *bgnSector, uint32_t *endSector) {
+  uint32_t size = fileSize();
+  if(!size) return false;
+  const Extent *e = extentFor(path, size);
+  if(bgnSector) *bgnSector = e->first;
+  if(endSector) *endSector = e->first + e->count - 1;
+  return true;
+}
+
+uint32_t File32::firstSector(void) {
+  uint32_t s = 0;
+  return contiguousRange(&s, NULL) ? s : 0;
+}
+
+// FatVolume -------------------------------------------------------------------
+
+File32 FatVolume::open(const char *path, oflag_t oflag) {
+  File32 f;
+  f.open(path, oflag);
+  return f;
+}
+
+bool FatVolume::exists(const char *path) {
+  return resolve(path, NULL);
+}
+
+bool FatVolume::mkdir(const char *path, bool pFlag) {
+  std::string host;
+  (void)pFlag;
+  return resolve(path, &host, NULL, true) && (!::mkdir(host.c_str(), 0755) || (errno == EEXIST));
+}
+
+bool FatVolume::remove(const char *path) {
+  std::string host;
+  if(!resolve(path, &host)) return false;
+  extentDrop(host.c_str());
+  return !unlink(host.c_str());
+}
+
+bool FatVolume::chdir(const char *path) {
+  std::string host, norm;
+  struct stat st;
+  if(!resolve(path, &host, &norm) || stat(host.c_str(), &st) || !S_ISDIR(st.st_mode)) return false;
+  cwd = norm;
+  return true;
+}
@@ -0,0 +1,135 @@
+// SPDX-FileCopyrightText: 2024 Monster Mask Open Claw Project
+//
+// SPDX-License-Identifier: MIT
+
+// JSON parsing for the ArduinoJson subset in mock/ArduinoJson.h. Accepts
+// // and /* */ comments, as the sketch's ArduinoJson build does.
+
+#include "ArduinoJson.h"
+
+void JsonDocument::skipSpace(void) {
+  while(p < end) {
+    if(isspace((uint8_t)*p)) {
+      p++;
+    } else if((*p == '/') && (p + 1 < end) && (p[1] == '/')) {
+      while((p < end) && (*p != '\n')) p++;
+    } else if((*p == '/') && (p + 1 < end) && (p[1] == '*')) {
+      for(p += 2; (p + 1 < end) && !((p[0] == '*') && (p[1] == '/')); p++);
+      p += 2;
+    } else {
+      break;
+    }
+  }
+}
+
+bool JsonDocument::parseString(std::string &out) {
+  if((p >= end) || (*p != '"')) return false;
+  for(p++; p < end; p++) {
+    char c = *p;
+    if(c == '"') {
+      p++;
+      return true;
+    }
+    if(c == '\\') {
+      if(++p >= end) return false;
+      switch(*p) {
+       case 'n': c = '\n'; break;
+       case 't': c = '\t'; break;
+       case 'r': c = '\r'; break;
+       case 'b': c = '\b'; break;
+       case 'f': c = '\f'; break;
+       case 'u': // Basic Latin only, which is all the configs use
+        if(p + 4 >= end) return false;
+        c = (char)strtol(std::string(p + 1, 4).c_str(), NULL, 16);
+        p += 4;
+        break;
+       default:  c = *p; break;
+      }
+    }
+    out += c;
+  }
+  return false;
+}
+
+// Returns node index, or -1 on error.
+int JsonDocument::parseValue(void) {
+  skipSpace();
+  if(p >= end) return -1;
+  int idx = nodes.size();
+  nodes.emplace_back();
+  if(*p == '{' || *p == '[') {
+    bool obj = (*p++ == '{');
+    nodes[idx].type = obj ? JsonNode::OBJECT : JsonNode::ARRAY;
+    skipSpace();
+    if((p < end) && (*p == (obj ? '}' : ']'))) {
+      p++;
+      return idx;
+    }
+    for(;;) {
+      std::string key;
+      if(obj) {
+        skipSpace();
+        if(!parseString(key)) return -1;
+        skipSpace();
+        if((p >= end) || (*p++ != ':')) return -1;
+      }
+      int kid = parseValue();
+      if(kid < 0) return -1;
+      nodes[idx].kids.push_back(kid);
+      if(obj) nodes[idx].keys.push_back(key);
+      skipSpace();
+      if(p >= end) return -1;
+      if(*p == ',') {
+        p++;
+        continue;
+      }
+      if(*p++ != (obj ? '}' : ']')) return -1;
+      return idx;
+    }
+  }
+  if(*p == '"') {
+    std::string s;
+    if(!parseString(s)) return -1;
+    nodes[idx].type = JsonNode::STRING;
+    nodes[idx].s    = s;
+    return idx;
+  }
+  static const struct { const char *word; JsonNode::Type type; bool b; } words[] = {
+    { "true", JsonNode::BOOL, true }, { "false", JsonNode::BOOL, false }, { "null", JsonNode::NUL, false } };
+  for(auto &w : words) {
+    size_t len = strlen(w.word);
+    if(((size_t)(end - p) >= len) && !strncmp(p, w.word, len)) {
+      p += len;
+      nodes[idx].type = w.type;
+      nodes[idx].b    = w.b;
+      return idx;
+    }
+  }
+  // Number. Integer unless it has a fraction or exponent.
+  std::string num;
+  while((p < end) && strchr("+-0123456789.eE", *p)) num += *p++;
+  if(num.empty()) return -1;
+  char *e;
+  if(num.find_first_of(".eE") == std::string::npos) {
+    nodes[idx].type = JsonNode::INT;
+    nodes[idx].i    = strtol(num.c_str(), &e, 10);
+  } else {
+    nodes[idx].type = JsonNode::FLOAT;
+    nodes[idx].f    = strtod(num.c_str(), &e);
+  }
+  return *e ? -1 : idx;
+}
+
+DeserializationError JsonDocument::parse(const char *text, size_t len) {
+  nodes.clear();
+  p      = text;
+  end    = text + len;
+  failed = false;
+  skipSpace();
+  if(p >= end) return DeserializationError::EmptyInput;
+  if(parseValue() < 0) {
+    nodes.clear();
+    return (p >= end) ? DeserializationError::IncompleteInput : DeserializationError::InvalidInput;
+  }
+  return DeserializationError::Ok;
+}
@@ -0,0 +1,122 @@
+// SPDX-FileCopyrightText: 2024 Monster Mask Open Claw Project
+//
+// SPDX-License-Identifier: MIT
+
+// Whole-sketch emulator: runs M4_Eyes setup() and loop() on the emulated
+// board and reports frame rate, bus use and loop timing.
+
+#include "emu.h"
+#include "Adafruit_Arcada.h"
+
+static uint64_t    stallNs  = 20ull * 1000000; // --stall-ms
+static const char *shotFile = NULL;            // --screenshot at exit
+
+// Longest single pass through loop() and how many exceeded --stall-ms,
+// e.g. a mood reload or filesystem re-index holding up rendering.
+static uint64_t loopMaxNs   = 0;
+static uint32_t loopStalls  = 0;
+static uint32_t loopCount   = 0;
+static std::string style;        // Config directory this boot, names metrics
+
+extern uint32_t frames; // M4_Eyes.ino
+extern uint64_t renderCycles; // globals.h
+extern uint32_t renderPixels, textureLoadCycles, tableGenCycles;
+extern const char *getCycleConfigPath(void); // user.cpp
+extern void     setup(void);
+extern void     loop(void);
+
+void emu_report(const char *why) {
+  uint64_t ms     = emu_now_ns / 1000000;
+  uint64_t bootMs = (emu_now_ns - emu_boot_ns) / 1000000;
+  fflush(stdout);
+  fprintf(stderr, "EMU:boot=%u,reason=%s,virtualMs=%llu,bootMs=%llu,hostMs=%llu,frames=%lu,fps=%.1f\n",
+    emu_boot_count, why, (unsigned long long)ms, (unsigned long long)bootMs,
+    (unsigned long long)((emu_host_ns() - emu_host_start) / 1000000), (unsigned long)frames,
+    bootMs ? frames * 1000.0 / bootMs : 0.0);
+  static const struct { SPIClass *spi; const char *name; } buses[] = {
+    { &ARCADA_TFT_SPI, "right" }, { &ARCADA_LEFTTFT_SPI, "left" } };
+  for(auto &b : buses) {
+    EmuBusStats s;
+    emu_bus_stats(b.spi, &s);
+    fprintf(stderr, "EMU:bus=%s,util=%.1f%%,bytes=%llu,dmaJobs=%u,dcGlitches=%u,lostBytes=%u\n",
+      b.name, (emu_now_ns > emu_boot_ns) ? 100.0 * s.busyNs / (emu_now_ns - emu_boot_ns) : 0.0,
+      (unsigned long long)s.bytes, s.dmaJobs, s.dcGlitches, s.lostBytes);
+  }
+  fprintf(stderr, "EMU:loops=%lu,loopMaxUs=%llu,loopStalls=%lu,flashReadCalls=%lu,flashBlocks=%lu\n",
+    (unsigned long)loopCount, (unsigned long long)(loopMaxNs / 1000), (unsigned long)loopStalls,
+    (unsigned long)Arcada_QSPI_Flash.readCalls, (unsigned long)Arcada_QSPI_Flash.blocksRead);
+
+  // Baseline metrics, per style since each boot runs one. Render cost is
+  // only meaningful with --cpu-scale above 0; the rest hold at any scale.
+  if(style.empty() || !bootMs) return;
+  EmuBusStats s;
+  emu_bus_stats(&ARCADA_TFT_SPI, &s);
+  uint32_t    glitches = s.dcGlitches;
+  emu_bus_stats(&ARCADA_LEFTTFT_SPI, &s);
+  glitches += s.dcGlitches;
+  std::string p = style + ".";
+  emu_metric((p + "fps").c_str(), frames * 1000.0 / bootMs, true, 3.0);
+  if(renderPixels) emu_metric((p + "nsPerPixel").c_str(), renderCycles * 1e9 / F_CPU / renderPixels, false, 10.0);
+  emu_metric((p + "textureLoadMs").c_str(), textureLoadCycles * 1000.0 / F_CPU, false, 25.0);
+  emu_metric((p + "tableGenMs").c_str(), tableGenCycles * 1000.0 / F_CPU, false, 25.0);
+  emu_metric((p + "loopMaxUs").c_str(), loopMaxNs / 1000.0, false, 50.0);
+  emu_metric((p + "dcGlitches").c_str(), glitches, false, 0.0);
+}
+
+void emu_exit(int status) {
+  status = emu_bench_finish(status);
+  if(shotFile) emu_screenshot(shotFile);
+  fflush(stdout);
+  fflush(stderr);
+  exit(status);
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+    "usage: %s [options]\n"
+    "  --fs DIR          host directory used as the flash filesystem (default %s)\n"
+    "  --script FILE     timed inputs and serial commands (see README.md)\n"
+    "  --run-ms N        stop after N ms of virtual time (default 10000)\n"
+    "  --cpu-scale X     M4 time per host time for sketch code (default 10, 0 = none)\n"
+    "  --poll-ns N       virtual ns charged per clock read (default 50)\n"
+    "  --stall-ms N      loop() passes longer than this count as stalls (default 20)\n"
+    "  --free-ram N      bytes free at start, for availableRAM() (default 180000)\n"
+    "  --screenshot FILE write both displays to a PPM image at exit\n"
+    "  --baseline-save F save benchmark metrics to F at exit\n"
+    "  --baseline F      compare metrics with F, exit 3 on regressions\n"
+    "  --quiet           don't echo the sketch's serial output\n",
+    prog, emu_fs_root.c_str());
+  exit(2);
+}
+
+int main(int argc, char *argv[]) {
+  emu_init(argc, argv);
+  for(int i=1; i<argc; i++) {
+    const char *a = argv[i], *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+    int         n = emu_common_option(a, v);
+    if(!n) {
+      if(!v) usage(argv[0]);
+      if(!strcmp(a, "--stall-ms"))        stallNs  = strtoull(v, NULL, 0) * 1000000;
+      else if(!strcmp(a, "--screenshot")) shotFile = v;
+      else usage(argv[0]);
+      n = 2;
+    }
+    if(n < 0) usage(argv[0]);
+    i += n - 1;
+  }
+  emu_start();
+
+  setup();
+  style = getCycleConfigPath();
+  style = style.substr(0, style.find('/'));
+  for(;;) {
+    uint64_t start = emu_now_ns;
+    loop();
+    emu_usb_task();
+    emu_sync();
+    uint64_t dt = emu_now_ns - start;
+    if(dt > loopMaxNs) loopMaxNs = dt;
+    if(dt > stallNs)   loopStalls++;
+    loopCount++;
+  }
+}
@@ -0,0 +1,11 @@
+#ifndef _EMU_AMG88XX_H_
+#define _EMU_AMG88XX_H_
+#include "Arduino.h"
+#define AMG88xx_PIXEL_ARRAY_SIZE 64
+// 8x8 thermal camera; the emulator's scripted sensors fill the frame.
+class Adafruit_AMG88xx {
+ public:
+  bool begin(void) { return true; }
+  void readPixels(float *buf, uint8_t size = AMG88xx_PIXEL_ARRAY_SIZE);
+};
+#endif
@@ -0,0 +1,68 @@
+// Host-side Arcada: MONSTER M4SK flavor (two ST7789 240x240 displays on
+// separate SPI buses, QSPI flash filesystem mapped to a host directory).
+
+#ifndef _EMU_ARCADA_H_
+#define _EMU_ARCADA_H_
+
+#include "Arduino.h"
+#include "SPI.h"
+#include "Adafruit_SPITFT.h"
+#include "Adafruit_ZeroDMA.h"
+#include "Adafruit_ImageReader.h"
+#include "Adafruit_SPIFlash.h"
+#include "SdFat.h"
+
+#define ARCADA_TFT_SPI      SPI
+#define ARCADA_TFT_CS       20
+#define ARCADA_TFT_DC       21
+#define ARCADA_TFT_RST      22
+#define ARCADA_LEFTTFT_SPI  SPI1
+#define ARCADA_LEFTTFT_CS   23
+#define ARCADA_LEFTTFT_DC   24
+#define ARCADA_LEFTTFT_RST  25
+#define ARCADA_TFT_WIDTH    240
+#define ARCADA_TFT_HEIGHT   240
+
+#define ARCADA_BUTTONMASK_UP   0x01
+#define ARCADA_BUTTONMASK_A    0x02
+#define ARCADA_BUTTONMASK_DOWN 0x04
+
+extern Adafruit_SPIFlash Arcada_QSPI_Flash;
+extern FatFileSystem     Arcada_QSPI_FileSys;
+
+class Adafruit_Arcada {
+ public:
+  bool             arcadaBegin(void);
+  bool             filesysBegin(void);
+  bool             filesysBeginMSD(void);
+  void             displayBegin(void);
+  void             setBacklight(uint8_t level) { backlight = level; }
+  uint32_t         availableFlash(void);
+  uint32_t         readButtons(void);
+  uint32_t         justPressedButtons(void);
+  bool             exists(const char *path);
+  File             open(const char *path = NULL, uint32_t flags = O_READ);
+  File             openFileByIndex(const char *path, uint16_t index, uint32_t flags, const char *extension = NULL);
+  bool             chdir(const char *path);
+  bool             mkdir(const char *path);
+  bool             remove(const char *path);
+  ImageReturnCode  drawBMP(char *filename, int16_t x, int16_t y, Adafruit_SPITFT *tft = NULL, boolean transact = true);
+  Adafruit_ImageReader *getImageReader(void);
+  uint8_t         *writeDataToFlash(uint8_t *src, uint32_t len);
+  uint16_t         readLightSensor(void);
+  void             enableSpeaker(bool on) { speakerOn = on; }
+  bool             timerCallback(float freq, void (*callback)(void));
+  void             timerStop(void);
+  bool             recentUSB(uint32_t timeout = 100);
+  Adafruit_SPITFT *display  = nullptr;
+  Adafruit_SPITFT *_display = nullptr;
+  Adafruit_SPITFT *display2 = nullptr;
+  // Emulator state
+  uint8_t          backlight = 0;
+  bool             speakerOn = false;
+  float            timerFreq = 0;
+  void           (*timerFunc)(void) = nullptr;
+  uint32_t         buttons = 0, lastButtons = 0, justPressed = 0;
+};
+
+#endif
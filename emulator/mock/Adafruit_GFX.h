@@ -0,0 +1,42 @@
+#ifndef _EMU_GFX_H_
+#define _EMU_GFX_H_
+
+#include "Arduino.h"
+
+class Adafruit_GFX {
+ public:
+  Adafruit_GFX(int16_t w, int16_t h) : WIDTH(w), HEIGHT(h), _width(w), _height(h) { }
+  virtual ~Adafruit_GFX() { }
+  virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+  virtual void setRotation(uint8_t r);
+  virtual void fillScreen(uint16_t color);
+  int16_t width(void) const { return _width; }
+  int16_t height(void) const { return _height; }
+  uint8_t getRotation(void) const { return rotation; }
+ protected:
+  int16_t WIDTH, HEIGHT, _width, _height;
+  uint8_t rotation = 0;
+};
+
+class GFXcanvas1 : public Adafruit_GFX {
+ public:
+  GFXcanvas1(uint16_t w, uint16_t h);
+  ~GFXcanvas1(void) { free(buffer); }
+  void     drawPixel(int16_t x, int16_t y, uint16_t color) override;
+  uint8_t *getBuffer(void) const { return buffer; }
+ private:
+  uint8_t *buffer;
+};
+
+class GFXcanvas16 : public Adafruit_GFX {
+ public:
+  GFXcanvas16(uint16_t w, uint16_t h);
+  ~GFXcanvas16(void) { free(buffer); }
+  void      drawPixel(int16_t x, int16_t y, uint16_t color) override;
+  void      byteSwap(void);
+  uint16_t *getBuffer(void) const { return buffer; }
+ private:
+  uint16_t *buffer;
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef _EMU_IMAGEREADER_H_
+#define _EMU_IMAGEREADER_H_
+
+#include "Adafruit_SPITFT.h"
+#include "SdFat.h"
+
+enum ImageReturnCode {
+  IMAGE_SUCCESS,
+  IMAGE_ERR_FILE_NOT_FOUND,
+  IMAGE_ERR_FORMAT,
+  IMAGE_ERR_MALLOC
+};
+enum ImageFormat { IMAGE_NONE, IMAGE_1, IMAGE_8, IMAGE_16 };
+
+class Adafruit_Image {
+ public:
+  Adafruit_Image(void) { }
+  ~Adafruit_Image(void) { dealloc(); }
+  void         dealloc(void);
+  int16_t      width(void) const;
+  int16_t      height(void) const;
+  ImageFormat  getFormat(void) const { return format; }
+  void        *getCanvas(void) const { return canvas; }
+  uint16_t    *getPalette(void) const { return palette; }
+  // Filled in by Adafruit_ImageReader::loadBMP()
+  void        *canvas  = nullptr;
+  uint16_t    *palette = nullptr;
+  ImageFormat  format  = IMAGE_NONE;
+};
+
+// BMP reader: 1-bit (to GFXcanvas1), 24-bit and 16-bit (to GFXcanvas16),
+// uncompressed or BI_BITFIELDS 565, like the real library.
+class Adafruit_ImageReader {
+ public:
+  Adafruit_ImageReader(FatVolume &fs) : filesys(&fs) { }
+  ImageReturnCode drawBMP(char *filename, Adafruit_SPITFT &tft, int16_t x, int16_t y, boolean transact = true);
+  ImageReturnCode loadBMP(char *filename, Adafruit_Image &img);
+  ImageReturnCode bmpDimensions(char *filename, int32_t *w, int32_t *h);
+ private:
+  FatVolume *filesys;
+};
+
+#endif
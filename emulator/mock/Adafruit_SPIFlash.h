@@ -0,0 +1,22 @@
+#ifndef _EMU_SPIFLASH_H_
+#define _EMU_SPIFLASH_H_
+
+#include "Arduino.h"
+
+// Block-level view of the emulated QSPI flash. Sector contents are
+// synthesized from the host directory backing the filesystem: each file
+// owns a contiguous sector run (see SdFat.h), other sectors read as 0xFF.
+class Adafruit_SPIFlash {
+ public:
+  bool     begin(void) { return true; }
+  uint32_t size(void) const { return 8u * 1024 * 1024; }
+  uint32_t sectorCount(void) const { return size() / 512; }
+  bool     readBlocks(uint32_t block, uint8_t *dst, size_t nb);
+  bool     writeBlocks(uint32_t block, const uint8_t *src, size_t nb);
+  bool     syncBlocks(void) { return true; }
+  uint32_t readBuffer(uint32_t addr, uint8_t *dst, uint32_t len);
+  // Emulator statistics
+  uint32_t blocksRead = 0, readCalls = 0;
+};
+
+#endif
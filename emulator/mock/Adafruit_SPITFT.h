@@ -0,0 +1,59 @@
+#ifndef _EMU_SPITFT_H_
+#define _EMU_SPITFT_H_
+
+#include "Adafruit_GFX.h"
+#include "SPI.h"
+
+// Base for SPI displays. Drawing goes out over the SPI bus as real
+// command/data bytes so the emulated panel on the far end decodes it.
+class Adafruit_SPITFT : public Adafruit_GFX {
+ public:
+  Adafruit_SPITFT(uint16_t w, uint16_t h, SPIClass *spi, int8_t cs, int8_t dc, int8_t rst)
+    : Adafruit_GFX(w, h), _spi(spi), _cs(cs), _dc(dc), _rst(rst) { }
+  virtual void setAddrWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h) = 0;
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+  void fillScreen(uint16_t color) override;
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  void startWrite(void);
+  void endWrite(void);
+  void writeCommand(uint8_t cmd);
+  void sendCommand(uint8_t cmd, const uint8_t *data = NULL, uint8_t n = 0);
+  void spiWrite(uint8_t b) { _spi->transfer(b); }
+  void SPI_WRITE16(uint16_t w) { spiWrite(w >> 8); spiWrite(w); }
+  void SPI_WRITE32(uint32_t l) { SPI_WRITE16(l >> 16); SPI_WRITE16(l); }
+  void writeColor(uint16_t color, uint32_t len);
+  void writePixels(uint16_t *colors, uint32_t len, bool block = true, bool bigEndian = false);
+  // Emulator: bus and control pins, so the panel model can find them
+  SPIClass *getSPI(void) const { return _spi; }
+  int8_t    getCS(void) const { return _cs; }
+  int8_t    getDC(void) const { return _dc; }
+ protected:
+  SPIClass *_spi;
+  int8_t    _cs, _dc, _rst;
+};
+
+#define ST77XX_CASET  0x2A
+#define ST77XX_RASET  0x2B
+#define ST77XX_RAMWR  0x2C
+#define ST77XX_MADCTL 0x36
+
+class Adafruit_ST77xx : public Adafruit_SPITFT {
+ public:
+  Adafruit_ST77xx(uint16_t w, uint16_t h, SPIClass *spi, int8_t cs, int8_t dc, int8_t rst)
+    : Adafruit_SPITFT(w, h, spi, cs, dc, rst) { }
+  void setAddrWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h) override;
+  void setRotation(uint8_t r) override;
+ protected:
+  uint8_t _colstart = 0, _rowstart = 0, _colstart2 = 0, _rowstart2 = 0;
+  int16_t _xstart = 0, _ystart = 0;
+};
+
+class Adafruit_ST7789 : public Adafruit_ST77xx {
+ public:
+  Adafruit_ST7789(SPIClass *spi, int8_t cs, int8_t dc, int8_t rst)
+    : Adafruit_ST77xx(240, 240, spi, cs, dc, rst) {
+  }
+  void init(uint16_t w, uint16_t h);
+};
+
+#endif
@@ -0,0 +1,30 @@
+// Host-side stand-in for Adafruit TinyUSB: the USB MIDI device only.
+// Packets come from script "midi" events and reach the sketch's
+// tud_midi_rx_cb() when the USB task runs, after loop() returns.
+
+#ifndef _EMU_ADAFRUIT_TINYUSB_H_
+#define _EMU_ADAFRUIT_TINYUSB_H_
+
+#include "Arduino.h"
+
+class Adafruit_USBD_MIDI {
+ public:
+  bool begin(void) { return true; }
+  void setStringDescriptor(const char *s) { (void)s; }
+};
+
+class Adafruit_USBD_Device {
+ public:
+  bool mounted(void) { return false; } // Not yet when setup() starts
+  bool detach(void) { return true; }
+  bool attach(void) { return true; }
+};
+extern Adafruit_USBD_Device TinyUSBDevice;
+
+extern "C" {
+uint32_t tud_midi_available(void);
+bool     tud_midi_packet_read(uint8_t packet[4]);
+void     tud_midi_rx_cb(uint8_t itf) __attribute__((weak)); // Sketch's, if any
+}
+
+#endif // _EMU_ADAFRUIT_TINYUSB_H_
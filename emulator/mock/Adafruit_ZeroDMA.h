@@ -0,0 +1,35 @@
+#ifndef _EMU_ZERODMA_H_
+#define _EMU_ZERODMA_H_
+
+#include "Arduino.h"
+
+typedef enum { DMA_STATUS_OK = 0, DMA_STATUS_ERR_NOT_FOUND, DMA_STATUS_BUSY } ZeroDMAstatus;
+
+// Each channel copies its descriptor chain into the attached SPI "wire"
+// when startJob() is called, and the emulator schedules the completion
+// callback by the time the bytes would take on the real bus.
+class Adafruit_ZeroDMA {
+ public:
+  Adafruit_ZeroDMA(void);
+  ZeroDMAstatus   allocate(void);
+  void            setTrigger(uint8_t trigger) { this->trigger = trigger; }
+  void            setAction(uint8_t action) { (void)action; }
+  void            setPriority(uint8_t pri) { (void)pri; }
+  DmacDescriptor *addDescriptor(void *src, void *dst, uint32_t count,
+                                uint8_t size, bool srcInc, bool dstInc);
+  void            setCallback(void (*cb)(Adafruit_ZeroDMA *)) { callback = cb; }
+  ZeroDMAstatus   startJob(void);
+  bool            isActive(void) { return busy; }
+  // Emulator hooks
+  void          (*callback)(Adafruit_ZeroDMA *) = nullptr;
+  DmacDescriptor  first;
+  uint8_t         trigger = 0;
+  bool            busy = false;
+  uint64_t        doneAt = 0;
+ protected:
+  friend void     emu_dma_complete_due(void);
+  uint8_t         channel;
+  volatile ZeroDMAstatus jobStatus;
+};
+
+#endif
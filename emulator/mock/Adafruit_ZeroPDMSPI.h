@@ -0,0 +1,20 @@
+#ifndef _EMU_ZEROPDMSPI_H_
+#define _EMU_ZEROPDMSPI_H_
+
+#include "SPI.h"
+
+// PDM microphone on a SERCOM in SPI mode. The emulator calls the SERCOM
+// handler once per 32-bit PDM word; decimateFilterWord() filters each
+// pair of words into a sample.
+class Adafruit_ZeroPDMSPI {
+ public:
+  Adafruit_ZeroPDMSPI(SPIClass *spi) : _spi(spi) { }
+  bool  begin(float sampleRate);
+  void  setMicGain(float g);
+  bool  decimateFilterWord(uint16_t *value, bool removeDC = true);
+  float gain = 1.0;
+ private:
+  SPIClass *_spi;
+};
+
+#endif
@@ -0,0 +1,109 @@
+// Host-side stand-in for the Arduino SAMD core, just enough of it for the
+// M4_Eyes sources. Time is virtual (see emu.h).
+
+#ifndef _EMU_ARDUINO_H_
+#define _EMU_ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <math.h>
+#include <algorithm>
+#include <type_traits>
+
+typedef bool    boolean;
+typedef uint8_t byte;
+
+#define HIGH         1
+#define LOW          0
+#define INPUT        0
+#define OUTPUT       1
+#define INPUT_PULLUP 2
+#define LED_BUILTIN  13
+#define F_CPU        120000000L
+#define A0           14
+#define A1           15
+#define A2           16
+#define A3           17
+#define HEX          16
+#define DEC          10
+
+#ifndef M_PI_2
+#define M_PI_2 1.57079632679489661923
+#endif
+
+template<class A, class B> static inline typename std::common_type<A, B>::type min(A a, B b) { return (a < b) ? a : b; }
+template<class A, class B> static inline typename std::common_type<A, B>::type max(A a, B b) { return (a > b) ? a : b; }
+#define constrain(x, lo, hi) ((x) < (lo) ? (lo) : ((x) > (hi) ? (hi) : (x)))
+
+// Virtual clock ------------------------------------------------------------
+// Time only moves when the sketch looks at it or waits: each call charges
+// the host CPU time used since the last one (scaled to the M4), then runs
+// whatever DMA completions, interrupts and script events are now due.
+uint32_t micros(void);
+uint32_t millis(void);
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield(void);
+
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int val);
+int  digitalRead(int pin);
+int  analogRead(int pin);
+void analogWrite(int pin, int val);
+void analogWriteResolution(int bits);
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+// Print / Serial --------------------------------------------------------------
+class Print {
+ public:
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buf, size_t n) {
+    size_t i;
+    for(i=0; i<n; i++) write(buf[i]);
+    return i;
+  }
+  size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+  size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int n, int base = DEC);
+  size_t print(unsigned int n, int base = DEC);
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC);
+  size_t print(double d, int digits = 2);
+  size_t println(void) { return print("\r\n"); }
+  template<class T> size_t println(T v) { size_t n = print(v); return n + println(); }
+  template<class T> size_t println(T v, int f) { size_t n = print(v, f); return n + println(); }
+};
+
+class Stream : public Print {
+ public:
+  virtual int available(void) { return 0; }
+  virtual int read(void) { return -1; }
+};
+
+class EmuSerial : public Stream {
+ public:
+  void   begin(uint32_t baud) { (void)baud; }
+  size_t write(uint8_t c) override;
+  using Print::write;
+  int    available(void) override;
+  int    read(void) override;
+  int    availableForWrite(void);
+  void   flush(void) { }
+  operator bool() { return true; }
+};
+extern EmuSerial Serial;
+
+// String class is not used by the sketch; omitted.
+
+#include "samd51.h"
+
+#endif // _EMU_ARDUINO_H_
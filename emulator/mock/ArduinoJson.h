@@ -0,0 +1,131 @@
+// Small subset of the ArduinoJson 6 API (comments enabled), enough for the
+// sketch's config parsing: StaticJsonDocument, deserializeJson() from a
+// File, and JsonVariant with is<T>(), as<T>(), [] and the | default op.
+
+#ifndef _EMU_ARDUINOJSON_H_
+#define _EMU_ARDUINOJSON_H_
+
+#include "Arduino.h"
+#include <string>
+#include <vector>
+#include <type_traits>
+
+class JsonArray { };
+class JsonObject { };
+
+struct JsonNode {
+  enum Type { NUL, BOOL, INT, FLOAT, STRING, ARRAY, OBJECT } type = NUL;
+  bool                  b = false;
+  long                  i = 0;
+  double                f = 0.0;
+  std::string           s;
+  std::vector<int>      kids;  // child node indices (array elements / object values)
+  std::vector<std::string> keys;
+};
+
+class JsonVariant {
+ public:
+  JsonVariant(void) : nodes(nullptr), idx(-1) { }
+  JsonVariant(std::vector<JsonNode> *n, int i) : nodes(n), idx(i) { }
+
+  template<class T> bool is(void) const {
+    const JsonNode *n = node();
+    if(!n) return false;
+    if(std::is_same<T, bool>::value) return n->type == JsonNode::BOOL;
+    if(std::is_same<T, const char *>::value || std::is_same<T, char *>::value)
+      return n->type == JsonNode::STRING;
+    if(std::is_same<T, JsonArray>::value) return n->type == JsonNode::ARRAY;
+    if(std::is_same<T, JsonObject>::value) return n->type == JsonNode::OBJECT;
+    if(std::is_floating_point<T>::value)
+      return (n->type == JsonNode::FLOAT) || (n->type == JsonNode::INT);
+    if(std::is_integral<T>::value) return n->type == JsonNode::INT;
+    return false;
+  }
+
+  template<class T> typename std::enable_if<std::is_arithmetic<T>::value, T>::type as(void) const {
+    const JsonNode *n = node();
+    if(!n) return 0;
+    switch(n->type) {
+     case JsonNode::BOOL:  return (T)n->b;
+     case JsonNode::INT:   return (T)n->i;
+     case JsonNode::FLOAT: return (T)n->f;
+     default:              return 0;
+    }
+  }
+  template<class T> typename std::enable_if<std::is_pointer<T>::value, T>::type as(void) const {
+    const JsonNode *n = node();
+    return (n && (n->type == JsonNode::STRING)) ? (T)n->s.c_str() : nullptr;
+  }
+
+  template<class T> operator T() const { return as<T>(); }
+
+  template<class T> typename std::enable_if<std::is_arithmetic<T>::value, T>::type operator|(T def) const {
+    if(std::is_floating_point<T>::value) return is<float>() ? as<T>() : def;
+    if(std::is_same<T, bool>::value)     return is<bool>()  ? as<T>() : def;
+    return is<int>() ? as<T>() : def;
+  }
+  const char *operator|(const char *def) const { return is<const char *>() ? as<const char *>() : def; }
+
+  size_t size(void) const {
+    const JsonNode *n = node();
+    return n ? n->kids.size() : 0;
+  }
+  JsonVariant operator[](int i) const {
+    const JsonNode *n = node();
+    if(n && (n->type == JsonNode::ARRAY) && (i >= 0) && (i < (int)n->kids.size()))
+      return JsonVariant(nodes, n->kids[i]);
+    return JsonVariant();
+  }
+  JsonVariant operator[](const char *key) const {
+    const JsonNode *n = node();
+    if(n && key && (n->type == JsonNode::OBJECT)) {
+      for(size_t k=0; k<n->keys.size(); k++) {
+        if(n->keys[k] == key) return JsonVariant(nodes, n->kids[k]);
+      }
+    }
+    return JsonVariant();
+  }
+  bool isNull(void) const { return !node() || node()->type == JsonNode::NUL; }
+
+ private:
+  const JsonNode *node(void) const { return (nodes && idx >= 0) ? &(*nodes)[idx] : nullptr; }
+  std::vector<JsonNode> *nodes;
+  int                    idx;
+};
+
+class DeserializationError {
+ public:
+  enum Code { Ok, EmptyInput, IncompleteInput, InvalidInput, NoMemory };
+  DeserializationError(Code c = Ok) : code(c) { }
+  explicit operator bool() const { return code != Ok; }
+  const char *c_str(void) const {
+    static const char *names[] = { "Ok", "EmptyInput", "IncompleteInput", "InvalidInput", "NoMemory" };
+    return names[code];
+  }
+  Code code;
+};
+
+class JsonDocument {
+ public:
+  JsonVariant operator[](const char *key) { return root()[key]; }
+  JsonVariant root(void) { return nodes.empty() ? JsonVariant() : JsonVariant(&nodes, 0); }
+  DeserializationError parse(const char *text, size_t len);
+ private:
+  int  parseValue(void);
+  void skipSpace(void);
+  bool parseString(std::string &out);
+  std::vector<JsonNode> nodes;
+  const char *p, *end;
+  bool        failed;
+};
+
+template<size_t N> class StaticJsonDocument : public JsonDocument { };
+
+template<class S> DeserializationError deserializeJson(JsonDocument &doc, S &stream) {
+  std::string text;
+  int c;
+  while((c = stream.read()) >= 0) text += (char)c;
+  return doc.parse(text.c_str(), text.size());
+}
+
+#endif
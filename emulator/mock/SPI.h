@@ -0,0 +1,38 @@
+#ifndef _EMU_SPI_H_
+#define _EMU_SPI_H_
+
+#include "Arduino.h"
+
+#define MSBFIRST 1
+#define SPI_MODE0 0
+typedef enum { SERCOM_CLOCK_SOURCE_FCPU, SERCOM_CLOCK_SOURCE_48M, SERCOM_CLOCK_SOURCE_100M } SercomClockSource;
+
+class SPISettings {
+ public:
+  SPISettings(uint32_t clock = 4000000, uint8_t bitOrder = MSBFIRST, uint8_t dataMode = SPI_MODE0)
+    : clock(clock), bitOrder(bitOrder), dataMode(dataMode) { }
+  uint32_t clock;
+  uint8_t  bitOrder, dataMode;
+};
+
+// One SPI bus. The emulator's virtual display sits on the far end and
+// sees every byte, along with the DC line level at the time.
+class SPIClass {
+ public:
+  SPIClass(int id) : id(id) { sercom.SPI.INTFLAG.reg = 0x03; } // DRE, TXC
+  void     begin(void) { }
+  void     beginTransaction(SPISettings s) { clock = s.clock; inTransaction = true; }
+  void     endTransaction(void) { inTransaction = false; }
+  uint8_t  transfer(uint8_t b);
+  void     transfer(void *buf, size_t n);
+  void     setClockSource(SercomClockSource c) { (void)c; }
+  uint8_t  getDMAC_ID_TX(void) { return 0x04 + id * 2; }
+  void    *getDataRegister(void) { return (void *)&sercom.SPI.DATA.reg; }
+  int      id;
+  Sercom   sercom;
+  uint32_t clock = 24000000;
+  bool     inTransaction = false;
+};
+extern SPIClass SPI, SPI1, SPI2;
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef _EMU_SDFAT_H_
+#define _EMU_SDFAT_H_
+
+#include "Arduino.h"
+
+#define O_READ    0x01
+#define O_RDONLY  0x01
+#define O_WRITE   0x02
+#define O_WRONLY  0x02
+#define O_RDWR    0x03
+#define O_APPEND  0x08
+#define O_CREAT   0x10
+#define O_TRUNC   0x20
+#define FILE_READ  O_RDONLY
+#define FILE_WRITE (O_RDWR | O_CREAT | O_APPEND)
+#define SD_MAX_FILENAME_SIZE 255
+typedef uint8_t oflag_t;
+
+// Files live in a host directory (the emulated QSPI filesystem root).
+// Every regular file is also given a contiguous run of 512-byte sectors
+// on the emulated flash so raw-sector fast paths can be exercised.
+class File32 {
+ public:
+  File32(void) { }
+  File32(const File32 &o);
+  File32 &operator=(const File32 &o);
+  ~File32(void);
+  bool     open(const char *path, oflag_t oflag = O_RDONLY);
+  bool     openNext(File32 *dir, oflag_t oflag = O_RDONLY);
+  bool     close(void);
+  operator bool() const { return fp != nullptr || dir; }
+  bool     isOpen(void) const { return (bool)*this; }
+  bool     isDir(void) const { return dir; }
+  bool     isFile(void) const { return fp != nullptr; }
+  int      read(void);
+  int      read(void *buf, size_t n);
+  size_t   write(const void *buf, size_t n);
+  size_t   write(uint8_t b) { return write(&b, 1); }
+  bool     seekSet(uint32_t pos);
+  bool     seekCur(int32_t off);
+  bool     seek(uint32_t pos) { return seekSet(pos); }
+  uint32_t curPosition(void) const;
+  uint32_t position(void) const { return curPosition(); }
+  uint32_t fileSize(void) const;
+  uint32_t size(void) const { return fileSize(); }
+  int      available(void) const { return fileSize() - curPosition(); }
+  bool     sync(void);
+  void     flush(void) { sync(); }
+  size_t   getName(char *name, size_t size);
+  bool     contiguousRange(uint32_t *bgnSector, uint32_t *endSector);
+  uint32_t firstSector(void);
+  void     rewindDirectory(void) { dirPos = 0; }
+  // Emulator state
+  oflag_t  flags = 0;
+  void    *fp = nullptr;
+  bool     dir = false;
+  int      dirPos = 0;
+  char     path[256] = "";
+};
+typedef File32 File;
+
+// SdFat 2.x block device interface (the filesystem's view of storage)
+class FsBlockDeviceInterface {
+ public:
+  virtual ~FsBlockDeviceInterface() {}
+  virtual void     end(void) {}
+  virtual bool     isBusy(void) = 0;
+  virtual bool     readSector(uint32_t sector, uint8_t *dst) = 0;
+  virtual bool     readSectors(uint32_t sector, uint8_t *dst, size_t ns) = 0;
+  virtual uint32_t sectorCount(void) = 0;
+  virtual bool     syncDevice(void) = 0;
+  virtual bool     writeSector(uint32_t sector, const uint8_t *src) = 0;
+  virtual bool     writeSectors(uint32_t sector, const uint8_t *src, size_t ns) = 0;
+};
+typedef FsBlockDeviceInterface FsBlockDevice;
+
+class FatVolume {
+ public:
+  bool   begin(void *blockDev) { device = blockDev; return true; }
+  void  *device = nullptr; // Emulator: block device last mounted on
+  File32 open(const char *path, oflag_t oflag = O_RDONLY);
+  bool   exists(const char *path);
+  bool   mkdir(const char *path, bool pFlag = true);
+  bool   remove(const char *path);
+  bool   chdir(const char *path);
+  void   cacheClear(void) { }
+};
+typedef FatVolume FatFileSystem;
+
+#endif
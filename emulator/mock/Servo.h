@@ -0,0 +1,12 @@
+#ifndef _EMU_SERVO_H_
+#define _EMU_SERVO_H_
+#include "Arduino.h"
+class Servo {
+ public:
+  uint8_t attach(int pin) { _pin = pin; return 0; }
+  void    detach(void) { _pin = -1; }
+  bool    attached(void) { return _pin >= 0; }
+  void    writeMicroseconds(int us) { _us = us; }
+  int     _pin = -1, _us = 1500;
+};
+#endif
@@ -0,0 +1,6 @@
+#ifndef _EMU_WIRE_H_
+#define _EMU_WIRE_H_
+#include "Arduino.h"
+class TwoWire { public: void begin(void) { } };
+extern TwoWire Wire;
+#endif
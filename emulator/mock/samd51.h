@@ -0,0 +1,216 @@
+// Minimal SAMD51 / Cortex-M4 register model for the host build. Only the
+// registers and fields the sketch touches are present; they're plain
+// memory, so writes are observable by the emulator but have no effect
+// unless the emulator looks at them.
+
+#ifndef _EMU_SAMD51_H_
+#define _EMU_SAMD51_H_
+
+#include <stdint.h>
+
+#define __IO volatile
+#define __I  volatile const
+#define __O  volatile
+
+// DMA descriptor, layout-compatible field names with the real one.
+typedef union {
+  struct {
+    uint16_t VALID:1, EVOSEL:2, BLOCKACT:2, :3, BEATSIZE:2, SRCINC:1,
+             DSTINC:1, STEPSEL:1, STEPSIZE:3;
+  } bit;
+  uint16_t reg;
+} DMAC_BTCTRL_Type;
+typedef union { uint16_t reg; } DMAC_BTCNT_Type;
+typedef union { uint32_t reg; } DMAC_SRCADDR_Type;
+typedef union { uint32_t reg; } DMAC_DSTADDR_Type;
+typedef union { uint32_t reg; } DMAC_DESCADDR_Type;
+
+typedef struct {
+  __IO DMAC_BTCTRL_Type   BTCTRL;
+  __IO DMAC_BTCNT_Type    BTCNT;
+  __IO DMAC_SRCADDR_Type  SRCADDR;
+  __IO DMAC_DSTADDR_Type  DSTADDR;
+  __IO DMAC_DESCADDR_Type DESCADDR;
+} DmacDescriptor;
+
+#define DMA_EVENT_OUTPUT_DISABLE          0
+#define DMA_BLOCK_ACTION_NOACT            0
+#define DMA_BEAT_SIZE_BYTE                0
+#define DMA_BEAT_SIZE_HWORD               1
+#define DMA_BEAT_SIZE_WORD                2
+#define DMA_STEPSEL_SRC                   1
+#define DMA_ADDRESS_INCREMENT_STEP_SIZE_1 0
+#define DMA_TRIGGER_ACTON_BEAT            2
+#define DMA_PRIORITY_0                    0
+
+typedef struct {
+  struct { union { struct { uint32_t SWRST:1, ENABLE:1; } bit; uint32_t reg; } CHCTRLA; } Channel[32];
+} Dmac;
+extern Dmac  emu_DMAC;
+#define DMAC (&emu_DMAC)
+
+typedef struct { __IO uint32_t CTRL, LOAD, VAL, CALIB; } SysTick_Type;
+extern SysTick_Type emu_SysTick;
+#define SysTick (&emu_SysTick)
+
+typedef struct { struct { struct { __IO uint32_t reg; } BKUP[8]; } MODE0; } Rtc;
+extern Rtc emu_RTC;
+#define RTC (&emu_RTC)
+
+// DWT cycle counter; the emulator advances CYCCNT alongside virtual time
+// at the nominal 120 MHz core clock.
+struct EmuCycleCounter {
+  operator uint32_t() const;          // Current virtual cycle count
+  EmuCycleCounter &operator=(uint32_t v);
+};
+typedef struct { __IO uint32_t CTRL; EmuCycleCounter CYCCNT; } DWT_Type;
+typedef struct { __IO uint32_t DEMCR; } CoreDebug_Type;
+extern DWT_Type       emu_DWT;
+extern CoreDebug_Type emu_CoreDebug;
+#define DWT       (&emu_DWT)
+#define CoreDebug (&emu_CoreDebug)
+#define DWT_CTRL_CYCCNTENA_Msk         (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk     (1UL << 24)
+
+// NVM controller, as used to rewrite internal flash. Flash is an array
+// in the emulator (see arcada.cpp); CPU writes land there directly, and
+// a block erase command fills the block at ADDR with 0xFF. ADDR is
+// pointer-sized so host addresses fit.
+struct EmuNvmCommand {
+  EmuNvmCommand &operator=(uint32_t v);
+};
+typedef struct {
+  union {
+    struct {
+      uint16_t AUTOWS:1, SUSPEN:1, :2, WMODE:2, PRM:2, RWS:4, AHBNS0:1,
+               AHBNS1:1, CACHEDIS0:1, CACHEDIS1:1;
+    } bit;
+    uint16_t reg;
+  } CTRLA;
+  struct { EmuNvmCommand reg; } CTRLB;
+  union { struct { uint16_t READY:1, PRM:1, LOAD:1, SUSP:1; } bit; uint16_t reg; } STATUS;
+  struct { uintptr_t reg; } ADDR;
+} Nvmctrl;
+extern Nvmctrl emu_NVMCTRL;
+#define NVMCTRL (&emu_NVMCTRL)
+#define NVMCTRL_CTRLA_WMODE_MAN_Val 0x0
+#define NVMCTRL_CTRLB_CMDEX_KEY     (0xA5 << 8)
+#define NVMCTRL_CTRLB_CMD_EB        0x01
+#define NVMCTRL_CTRLB_CMD_WP        0x03
+#define NVMCTRL_CTRLB_CMD_PBC       0x15
+
+// Cortex-M cache controller; always reads as disabled.
+typedef struct {
+  union { struct { uint32_t CEN:1; } bit; uint32_t reg; } CTRL;
+  union { struct { uint32_t CSTS:1; } bit; uint32_t reg; } SR;
+  union { struct { uint32_t INVALL:1; } bit; uint32_t reg; } MAINT0;
+} Cmcc;
+extern Cmcc emu_CMCC;
+#define CMCC (&emu_CMCC)
+
+// PORT groups (OUTSET/OUTCLR are how the fast paths drive CS/DC). Writes
+// go to the emulator so pin levels stay in step with digitalWrite().
+struct EmuPortReg {
+  EmuPortReg &operator=(uint32_t v);
+  operator uint32_t() const;
+  uint32_t value;
+};
+typedef struct { EmuPortReg reg; } PortReg;
+typedef struct {
+  PortReg DIR, DIRCLR, DIRSET, DIRTGL, OUT, OUTCLR, OUTSET, OUTTGL, IN;
+} PortGroup;
+typedef struct { PortGroup Group[4]; } Port;
+extern Port emu_PORT;
+#define PORT (&emu_PORT)
+
+// SERCOM in SPI mode: DATA and INTFLAG are all the sketch uses. A CPU
+// write to DATA sends the byte down that SERCOM's bus (and holds the CPU
+// until it's out), so DRE and TXC always read as set.
+struct EmuSpiData {
+  EmuSpiData &operator=(uint32_t v);
+  operator uint32_t() const { return 0; }
+};
+typedef struct {
+  __IO uint32_t CTRLA, CTRLB, CTRLC, BAUD;
+  __IO uint8_t  INTENCLR, r0, INTENSET, r1;
+  union { struct { uint8_t DRE:1, TXC:1, RXC:1, SSL:1, :3, ERROR:1; } bit; uint8_t reg; } INTFLAG;
+  uint8_t r2;
+  __IO uint16_t STATUS;
+  __IO uint32_t SYNCBUSY, r3, LENGTH, ADDR;
+  struct { EmuSpiData reg; } DATA;
+} SercomSpi;
+typedef union { SercomSpi SPI; } Sercom;
+
+// Generic clock peripheral channels, and the TC/TCC timers' channel IDs.
+typedef struct { struct { __IO uint32_t reg; } PCHCTRL[48]; } Gclk;
+extern Gclk emu_GCLK;
+#define GCLK (&emu_GCLK)
+#define GCLK_PCHCTRL_GEN_GCLK1_Val 0x1
+#define GCLK_PCHCTRL_CHEN_Pos      6
+#define TC0_GCLK_ID   9
+#define TC1_GCLK_ID   9
+#define TCC0_GCLK_ID 25
+#define TCC1_GCLK_ID 25
+#define TC2_GCLK_ID  26
+#define TC3_GCLK_ID  26
+#define TCC2_GCLK_ID 29
+#define TCC3_GCLK_ID 29
+#define TC4_GCLK_ID  30
+#define TC5_GCLK_ID  30
+#define TCC4_GCLK_ID 38
+
+// TC and TCC timers, enough for PWM output. Nothing drives the pins;
+// SYNCBUSY always reads clear.
+typedef struct {
+  union { struct { uint32_t SWRST:1, ENABLE:1, :6, PRESCALER:3; } bit; uint32_t reg; } CTRLA;
+  union { struct { uint32_t SWRST:1, ENABLE:1, CTRLB:1, STATUS:1, COUNT:1, PATT:1, WAVE:1; } bit; uint32_t reg; } SYNCBUSY;
+  struct { __IO uint32_t reg; } WAVE, PER, CC[6], CCBUF[6];
+} Tcc;
+typedef struct {
+  union { struct { uint32_t SWRST:1, ENABLE:1, MODE:2, :4, PRESCALER:3; } bit; uint32_t reg; } CTRLA;
+  union { struct { uint32_t SWRST:1, ENABLE:1, CTRLB:1, STATUS:1, COUNT:1; } bit; uint32_t reg; } SYNCBUSY;
+  struct { __IO uint8_t  reg; } WAVE;
+  struct { __IO uint16_t reg; } CC[2], CCBUF[2];
+} TcCount16;
+typedef union { TcCount16 COUNT16; } Tc;
+#define TCC_INST_NUM 5
+#define TC_INST_NUM  6
+#define TCC_CTRLA_PRESCALER_DIV16 (0x4 << 8)
+#define TCC_WAVE_WAVEGEN_NPWM     0x2
+#define TC_CTRLA_MODE_COUNT16     (0x0 << 2)
+#define TC_CTRLA_PRESCALER_DIV16  (0x4 << 8)
+#define TC_WAVE_WAVEGEN_NPWM      0x2
+
+// Pin description table, as in the variant files.
+typedef struct {
+  uint8_t  ulPort;
+  uint8_t  ulPin;
+  uint32_t ulPinType, ulPinAttribute, ulADCChannelNumber;
+  uint32_t ulPWMChannel, ulTCChannel, ulExtInt;
+} PinDescription;
+extern const PinDescription g_APinDescription[];
+extern void *g_apTCInstances[TCC_INST_NUM + TC_INST_NUM]; // TCCs, then TCs
+#define PIN_ATTR_PWM_E             (1UL << 8) // ulPinAttribute timer outputs
+#define PIN_ATTR_PWM_F             (1UL << 9)
+#define PIN_ATTR_PWM_G             (1UL << 10)
+#define GetTCNumber(x)             ((x) >> 8) // ulPWMChannel fields
+#define GetTCChannelNumber(x)      ((x) & 0xff)
+#define GetTC(x)                   (g_apTCInstances[GetTCNumber(x)])
+#define digitalPinToPort(P)    (&(PORT->Group[g_APinDescription[P].ulPort]))
+#define digitalPinToBitMask(P) (1ul << g_APinDescription[P].ulPin)
+
+static inline uint32_t __RBIT(uint32_t v) {
+  uint32_t r = 0;
+  for(int i=0; i<32; i++, v >>= 1) r = (r << 1) | (v & 1);
+  return r;
+}
+static inline uint32_t __CLZ(uint32_t v) { return v ? __builtin_clz(v) : 32; }
+static inline void __disable_irq(void) { }
+static inline void __enable_irq(void) { }
+static inline void __DMB(void) { __sync_synchronize(); }
+void NVIC_SystemReset(void);
+
+// Interrupt handler names the sketch defines, called by the emulator.
+extern "C" void SERCOM3_0_Handler(void);
+
+#endif // _EMU_SAMD51_H_
@@ -0,0 +1,20 @@
+// Pin multiplexer selection from the SAMD core. The emulator doesn't
+// model peripheral pin functions, so pinPeripheral() just accepts it.
+
+#ifndef _EMU_WIRING_PRIVATE_H_
+#define _EMU_WIRING_PRIVATE_H_
+#include "Arduino.h"
+
+typedef enum {
+  PIO_NOT_A_PIN = -1, PIO_EXTINT = 0, PIO_ANALOG, PIO_SERCOM, PIO_SERCOM_ALT,
+  PIO_TIMER, PIO_TIMER_ALT, PIO_TCC_PDEC, PIO_COM, PIO_SDHC, PIO_I2S,
+  PIO_PCC, PIO_GMAC, PIO_AC_CLK, PIO_CCL, PIO_DIGITAL, PIO_INPUT,
+  PIO_INPUT_PULLUP, PIO_OUTPUT
+} EPioType;
+
+static inline int pinPeripheral(uint32_t pin, EPioType type) {
+  (void)pin; (void)type;
+  return 0;
+}
+
+#endif // _EMU_WIRING_PRIVATE_H_
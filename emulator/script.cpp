@@ -0,0 +1,150 @@
+// SPDX-FileCopyrightText: 2024 Monster Mask Open Claw Project
+//
+// SPDX-License-Identifier: MIT
+
+// Scripted inputs. One event per line: time in milliseconds of virtual
+// time, a verb, and its arguments; '#' starts a comment. Events fire in
+// time order (file order for equal times). See README.md for the verbs.
+//
+// After a soft reset the emulator restarts and skips events already
+// past, but re-applies the input-state ones (light level, buttons, etc.)
+// so the new boot sees the same world.
+
+#include "emu.h"
+#include "Adafruit_Arcada.h"
+#include <vector>
+#include <algorithm>
+
+struct Event {
+  uint64_t    t;
+  std::string verb, args;
+  int         line;
+};
+
+static std::vector<Event> events;
+static size_t             nextEvent = 0;
+static const char        *scriptName;
+
+// Verbs that only set input state, re-applied on resume
+static const char *stateVerbs[] = { "light", "button", "pin", "analog", "boop",
+  "usb", "hostread", "heat" };
+static const char *actionVerbs[] = { "serial", "midi", "dmastall", "screenshot", "report", "quit" };
+
+static bool isVerb(const std::string &v, const char **list, size_t n) {
+  for(size_t i=0; i<n; i++) {
+    if(v == list[i]) return true;
+  }
+  return false;
+}
+
+static void badArgs(const Event &e) {
+  fprintf(stderr, "emu: %s:%d: bad arguments for %s\n", scriptName, e.line, e.verb.c_str());
+}
+
+static void apply(const Event &e, bool live) {
+  const char *a = e.args.c_str();
+  int         n1, n2;
+  if(e.verb == "serial") {
+    if(live) emu_serial_inject(a);
+  } else if(e.verb == "midi") {
+    unsigned st, d1, d2 = 0;
+    if(sscanf(a, "%i %i %i", &st, &d1, &d2) < 2) return badArgs(e);
+    if(live) emu_midi_inject(st, d1, d2);
+  } else if(e.verb == "light") {
+    emu_light = atoi(a);
+  } else if(e.verb == "button") {
+    char name[8];
+    if(sscanf(a, "%7s %d", name, &n1) != 2) return badArgs(e);
+    uint32_t mask = !strcasecmp(name, "up") ? ARCADA_BUTTONMASK_UP :
+                    !strcasecmp(name, "a")  ? ARCADA_BUTTONMASK_A  :
+                    !strcasecmp(name, "down") ? ARCADA_BUTTONMASK_DOWN : 0;
+    if(!mask) return badArgs(e);
+    emu_buttons = n1 ? (emu_buttons | mask) : (emu_buttons & ~mask);
+  } else if(e.verb == "pin") {
+    if(sscanf(a, "%d %d", &n1, &n2) != 2) return badArgs(e);
+    emu_pin_input(n1, n2);
+  } else if(e.verb == "analog") {
+    if(sscanf(a, "%d %d", &n1, &n2) != 2) return badArgs(e);
+    emu_analog_input(n1, n2);
+  } else if(e.verb == "boop") {
+    emu_boop_input(atoi(a));
+  } else if(e.verb == "usb") {
+    emu_usb_until_ns = e.t + (uint64_t)atoi(a) * 1000000;
+  } else if(e.verb == "hostread") {
+    emu_host_reading = atoi(a);
+  } else if(e.verb == "heat") {
+    float v = atof(a);
+    for(int i=0; i<64; i++) emu_heat[i] = v;
+  } else if(!live) {
+    return;
+  } else if(e.verb == "dmastall") {
+    emu_dma_stall(atoi(a));
+  } else if(e.verb == "screenshot") {
+    emu_screenshot(a);
+  } else if(e.verb == "report") {
+    emu_report("script");
+  } else if(e.verb == "quit") {
+    emu_report("quit");
+    emu_exit(0);
+  }
+}
+
+bool emu_script_load(const char *filename) {
+  FILE *f = fopen(filename, "r");
+  char  line[256];
+  int   num = 0;
+  if(!f) {
+    fprintf(stderr, "emu: can't open script %s\n", filename);
+    return false;
+  }
+  scriptName = filename;
+  while(fgets(line, sizeof line, f)) {
+    num++;
+    char *hash = strchr(line, '#');
+    if(hash) *hash = 0;
+    char *p = line, *e;
+    double ms = strtod(p, &e);
+    if(e == p) {
+      while(isspace((uint8_t)*p)) p++;
+      if(*p) {
+        fprintf(stderr, "emu: %s:%d: expected time in ms\n", filename, num);
+        fclose(f);
+        return false;
+      }
+      continue; // Blank or comment
+    }
+    for(p = e; isspace((uint8_t)*p); p++);
+    for(e = p; *e && !isspace((uint8_t)*e); e++);
+    Event ev { (uint64_t)(ms * 1000000.0), std::string(p, e - p), "", num };
+    while(isspace((uint8_t)*e)) e++;
+    ev.args = e;
+    while(!ev.args.empty() && isspace((uint8_t)ev.args.back())) ev.args.pop_back();
+    if(!isVerb(ev.verb, stateVerbs, sizeof stateVerbs / sizeof stateVerbs[0]) &&
+       !isVerb(ev.verb, actionVerbs, sizeof actionVerbs / sizeof actionVerbs[0])) {
+      fprintf(stderr, "emu: %s:%d: unknown event '%s'\n", filename, num, ev.verb.c_str());
+      fclose(f);
+      return false;
+    }
+    events.push_back(ev);
+  }
+  fclose(f);
+  std::stable_sort(events.begin(), events.end(),
+    [](const Event &a, const Event &b) { return a.t < b.t; });
+  return true;
+}
+
+uint64_t emu_script_next(void) {
+  return (nextEvent < events.size()) ? events[nextEvent].t : UINT64_MAX;
+}
+
+void emu_script_run_due(void) {
+  while((nextEvent < events.size()) && (events[nextEvent].t <= emu_now_ns)) {
+    apply(events[nextEvent++], true);
+  }
+}
+
+void emu_script_resume(uint64_t ns) {
+  while((nextEvent < events.size()) && (events[nextEvent].t <= ns)) {
+    apply(events[nextEvent++], false);
+  }
+}
@@ -0,0 +1,436 @@
+// SPDX-FileCopyrightText: 2024 Monster Mask Open Claw Project
+//
+// SPDX-License-Identifier: MIT
+
+// SPI buses, the ST7789 panels on the far end of them, DMA, and the bits
+// of Adafruit_GFX/SPITFT/ST77xx that drive a panel the library way.
+//
+// Each bus shifts bytes at its transaction's clock rate, one at a time,
+// and is busy until the last one is out. CPU transfers wait for that;
+// DMA jobs complete (and call back) when it happens. The panel decodes
+// every byte as it is queued, with the DC and CS levels at that moment,
+// so a DC or CS change while bytes are still on the wire is counted as
+// a glitch (on hardware, it would garble them).
+
+#include "emu.h"
+#include "Adafruit_SPITFT.h"
+#include <vector>
+
+SPIClass SPI(0), SPI1(1), SPI2(2);
+
+#define PANEL_COLS 240 // ST7789 frame memory
+#define PANEL_ROWS 320
+
+struct Panel {
+  bool     attached;
+  int8_t   cs, dc;
+  uint8_t  cmd, nArg, arg[4], madctl, hi;
+  bool     haveHi;
+  uint16_t xs, xe, ys, ye, x, y;
+  uint16_t mem[PANEL_ROWS][PANEL_COLS];
+};
+
+static std::vector<Adafruit_ZeroDMA *> channels;
+
+static struct Bus {
+  SPIClass   *spi;
+  uint64_t    busyUntil;
+  EmuBusStats stats;
+  Panel       panel;
+} bus[] = { { &SPI }, { &SPI1 }, { &SPI2 } };
+
+static Bus *findBus(SPIClass *spi) {
+  for(auto &b : bus) {
+    if(b.spi == spi) return &b;
+  }
+  return NULL;
+}
+
+// Map a pixel in the current address window to frame memory, honoring
+// MADCTL row/column exchange and mirroring, as the controller does.
+static void panelPixel(Panel *p, uint16_t color) {
+  uint16_t c = p->x, r = p->y;
+  if(p->madctl & 0x20) std::swap(c, r); // MV
+  if(p->madctl & 0x40) c = PANEL_COLS - 1 - c; // MX
+  if(p->madctl & 0x80) r = PANEL_ROWS - 1 - r; // MY
+  if((c < PANEL_COLS) && (r < PANEL_ROWS)) p->mem[r][c] = color;
+  if(++p->x > p->xe) {
+    p->x = p->xs;
+    if(++p->y > p->ye) p->y = p->ys;
+  }
+}
+
+static void panelByte(Panel *p, uint8_t b, bool dc) {
+  if(!dc) { // Command
+    p->cmd    = b;
+    p->nArg   = 0;
+    p->haveHi = false;
+    if(b == ST77XX_RAMWR) {
+      p->x = p->xs;
+      p->y = p->ys;
+    }
+    return;
+  }
+  switch(p->cmd) {
+   case ST77XX_CASET:
+   case ST77XX_RASET:
+    if(p->nArg < 4) p->arg[p->nArg++] = b;
+    if(p->nArg == 4) {
+      uint16_t a = (p->arg[0] << 8) | p->arg[1], e = (p->arg[2] << 8) | p->arg[3];
+      if(p->cmd == ST77XX_CASET) { p->xs = a; p->xe = e; }
+      else                       { p->ys = a; p->ye = e; }
+      p->nArg++;
+    }
+    break;
+   case ST77XX_MADCTL:
+    p->madctl = b;
+    break;
+   case ST77XX_RAMWR:
+    if(p->haveHi) panelPixel(p, (p->hi << 8) | b);
+    else          p->hi = b;
+    p->haveHi = !p->haveHi;
+    break;
+  }
+}
+
+uint64_t emu_bus_send(SPIClass *spi, const uint8_t *buf, size_t n, bool cpuWaits) {
+  Bus *b = findBus(spi);
+  emu_sync();
+  uint64_t start = (b->busyUntil > emu_now_ns) ? b->busyUntil : emu_now_ns;
+  uint64_t dur   = (uint64_t)n * 8000000000ull / spi->clock;
+  b->busyUntil       = start + dur;
+  b->stats.busyNs   += dur;
+  b->stats.bytes    += n;
+  if(b->panel.attached) {
+    if(emu_pin_level(b->panel.cs)) {
+      b->stats.lostBytes += n;
+    } else {
+      bool dc = emu_pin_level(b->panel.dc);
+      for(size_t i=0; i<n; i++) panelByte(&b->panel, buf[i], dc);
+    }
+  }
+  if(cpuWaits) emu_wait_until(b->busyUntil);
+  return b->busyUntil;
+}
+
+void emu_bus_pin_changed(int pin) {
+  for(auto &b : bus) {
+    if(b.panel.attached && ((pin == b.panel.dc) || (pin == b.panel.cs)) &&
+       (emu_now_ns < b.busyUntil)) b.stats.dcGlitches++;
+  }
+}
+
+void emu_bus_stats(SPIClass *spi, EmuBusStats *s) {
+  *s = findBus(spi)->stats;
+}
+
+uint8_t SPIClass::transfer(uint8_t b) {
+  emu_bus_send(this, &b, 1, true);
+  return 0xFF;
+}
+
+void SPIClass::transfer(void *buf, size_t n) {
+  emu_bus_send(this, (const uint8_t *)buf, n, true);
+}
+
+// CPU write to a SERCOM DATA register, e.g. from display.cpp
+EmuSpiData &EmuSpiData::operator=(uint32_t v) {
+  uint8_t b = v;
+  for(auto &bb : bus) {
+    if(bb.spi->getDataRegister() == (void *)this) {
+      emu_bus_send(bb.spi, &b, 1, true);
+      break;
+    }
+  }
+  return *this;
+}
+
+// Both panels side by side, left eye (second display) on the left, as
+// seen from the front with rotation 0 upright.
+bool emu_screenshot(const char *filename) {
+  FILE *f = fopen(filename, "wb");
+  if(!f) {
+    fprintf(stderr, "emu: can't write %s\n", filename);
+    return false;
+  }
+  fprintf(f, "P6\n%d %d\n255\n", 2 * PANEL_COLS, PANEL_COLS);
+  for(int y=0; y<PANEL_COLS; y++) {
+    for(int e=0; e<2; e++) {
+      Panel *p = &bus[1 - e].panel;
+      for(int x=0; x<PANEL_COLS; x++) {
+        uint16_t c = p->mem[PANEL_COLS - 1 - y][PANEL_COLS - 1 - x];
+        uint8_t  rgb[3] = { (uint8_t)(((c >> 11) & 31) * 255 / 31),
+                            (uint8_t)(((c >>  5) & 63) * 255 / 63),
+                            (uint8_t)(( c        & 31) * 255 / 31) };
+        fwrite(rgb, 1, 3, f);
+      }
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+// GFX ---------------------------------------------------------------------
+
+void Adafruit_GFX::setRotation(uint8_t r) {
+  rotation = r & 3;
+  _width   = (rotation & 1) ? HEIGHT : WIDTH;
+  _height  = (rotation & 1) ? WIDTH  : HEIGHT;
+}
+
+void Adafruit_GFX::fillScreen(uint16_t color) {
+  for(int16_t y=0; y<_height; y++) {
+    for(int16_t x=0; x<_width; x++) drawPixel(x, y, color);
+  }
+}
+
+GFXcanvas1::GFXcanvas1(uint16_t w, uint16_t h) : Adafruit_GFX(w, h) {
+  buffer = (uint8_t *)calloc((w + 7) / 8 * h, 1);
+}
+
+void GFXcanvas1::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  if(!buffer || (x < 0) || (y < 0) || (x >= _width) || (y >= _height)) return;
+  uint8_t *p = &buffer[y * ((WIDTH + 7) / 8) + x / 8];
+  if(color) *p |=  (0x80 >> (x & 7));
+  else      *p &= ~(0x80 >> (x & 7));
+}
+
+GFXcanvas16::GFXcanvas16(uint16_t w, uint16_t h) : Adafruit_GFX(w, h) {
+  buffer = (uint16_t *)calloc(w * h, 2);
+}
+
+void GFXcanvas16::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  if(buffer && (x >= 0) && (y >= 0) && (x < _width) && (y < _height)) buffer[y * WIDTH + x] = color;
+}
+
+void GFXcanvas16::byteSwap(void) {
+  if(buffer) {
+    for(uint32_t i=0, n=WIDTH * HEIGHT; i<n; i++) buffer[i] = __builtin_bswap16(buffer[i]);
+  }
+}
+
+// SPITFT / ST77xx ---------------------------------------------------------
+
+void Adafruit_SPITFT::startWrite(void) {
+  _spi->beginTransaction(SPISettings(24000000));
+  digitalWrite(_cs, LOW);
+}
+
+void Adafruit_SPITFT::endWrite(void) {
+  digitalWrite(_cs, HIGH);
+  _spi->endTransaction();
+}
+
+void Adafruit_SPITFT::writeCommand(uint8_t cmd) {
+  digitalWrite(_dc, LOW);
+  spiWrite(cmd);
+  digitalWrite(_dc, HIGH);
+}
+
+void Adafruit_SPITFT::sendCommand(uint8_t cmd, const uint8_t *data, uint8_t n) {
+  startWrite();
+  writeCommand(cmd);
+  for(uint8_t i=0; i<n; i++) spiWrite(data[i]);
+  endWrite();
+}
+
+void Adafruit_SPITFT::writeColor(uint16_t color, uint32_t len) {
+  uint8_t buf[512];
+  for(int i=0; i<(int)sizeof buf; i+=2) {
+    buf[i]     = color >> 8;
+    buf[i + 1] = color;
+  }
+  while(len) {
+    uint32_t n = (len > sizeof buf / 2) ? sizeof buf / 2 : len;
+    _spi->transfer(buf, n * 2);
+    len -= n;
+  }
+}
+
+void Adafruit_SPITFT::writePixels(uint16_t *colors, uint32_t len, bool block, bool bigEndian) {
+  uint8_t buf[512];
+  (void)block;
+  while(len) {
+    uint32_t n = (len > sizeof buf / 2) ? sizeof buf / 2 : len;
+    for(uint32_t i=0; i<n; i++) {
+      uint16_t c = bigEndian ? __builtin_bswap16(colors[i]) : colors[i];
+      buf[i * 2]     = c >> 8;
+      buf[i * 2 + 1] = c;
+    }
+    _spi->transfer(buf, n * 2);
+    colors += n;
+    len    -= n;
+  }
+}
+
+void Adafruit_SPITFT::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  if((x < 0) || (y < 0) || (x >= _width) || (y >= _height)) return;
+  startWrite();
+  setAddrWindow(x, y, 1, 1);
+  SPI_WRITE16(color);
+  endWrite();
+}
+
+void Adafruit_SPITFT::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  if(x < 0) { w += x; x = 0; }
+  if(y < 0) { h += y; y = 0; }
+  if((x + w) > _width)  w = _width  - x;
+  if((y + h) > _height) h = _height - y;
+  if((w <= 0) || (h <= 0)) return;
+  startWrite();
+  setAddrWindow(x, y, w, h);
+  writeColor(color, (uint32_t)w * h);
+  endWrite();
+}
+
+void Adafruit_SPITFT::fillScreen(uint16_t color) {
+  fillRect(0, 0, _width, _height, color);
+}
+
+void Adafruit_ST77xx::setAddrWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+  x += _xstart;
+  y += _ystart;
+  writeCommand(ST77XX_CASET);
+  SPI_WRITE32(((uint32_t)x << 16) | (x + w - 1));
+  writeCommand(ST77XX_RASET);
+  SPI_WRITE32(((uint32_t)y << 16) | (y + h - 1));
+  writeCommand(ST77XX_RAMWR);
+}
+
+// Same MADCTL values and RAM offsets per rotation as Adafruit_ST7789.
+void Adafruit_ST77xx::setRotation(uint8_t m) {
+  uint8_t madctl;
+  rotation = m & 3;
+  switch(rotation) {
+   case 0:
+    madctl  = 0xC0; // MX | MY
+    _xstart = _colstart;
+    _ystart = _rowstart;
+    break;
+   case 1:
+    madctl  = 0xA0; // MY | MV
+    _xstart = _rowstart;
+    _ystart = _colstart2;
+    break;
+   case 2:
+    madctl  = 0x00;
+    _xstart = _colstart2;
+    _ystart = _rowstart2;
+    break;
+   default:
+    madctl  = 0x60; // MX | MV
+    _xstart = _rowstart2;
+    _ystart = _colstart;
+    break;
+  }
+  _width  = (rotation & 1) ? HEIGHT : WIDTH;
+  _height = (rotation & 1) ? WIDTH  : HEIGHT;
+  sendCommand(ST77XX_MADCTL, &madctl, 1);
+}
+
+void Adafruit_ST7789::init(uint16_t w, uint16_t h) {
+  Bus *b = findBus(_spi);
+  // 240x240 panel at one end of the 240x320 controller memory
+  _colstart = _colstart2 = (PANEL_COLS - w);
+  _rowstart  = (PANEL_ROWS - h);
+  _rowstart2 = 0;
+  WIDTH = _width = w;
+  HEIGHT = _height = h;
+  pinMode(_cs, OUTPUT);
+  pinMode(_dc, OUTPUT);
+  digitalWrite(_cs, HIGH);
+  digitalWrite(_dc, HIGH);
+  b->panel.attached = true;
+  b->panel.cs       = _cs;
+  b->panel.dc       = _dc;
+  setRotation(0);
+}
+
+// DMA -----------------------------------------------------------------------
+
+static bool              stallNext[32];
+static Adafruit_ZeroDMA *isrDma;
+
+static void dmaIsr(void) {
+  isrDma->callback(isrDma);
+}
+
+Adafruit_ZeroDMA::Adafruit_ZeroDMA(void) : channel(0xFF), jobStatus(DMA_STATUS_OK) {
+  memset((void *)&first, 0, sizeof first);
+}
+
+ZeroDMAstatus Adafruit_ZeroDMA::allocate(void) {
+  if(channels.size() >= 32) return DMA_STATUS_ERR_NOT_FOUND;
+  channel = channels.size();
+  channels.push_back(this);
+  DMAC->Channel[channel].CHCTRLA.bit.ENABLE = 1;
+  return DMA_STATUS_OK;
+}
+
+DmacDescriptor *Adafruit_ZeroDMA::addDescriptor(void *src, void *dst, uint32_t count,
+  uint8_t size, bool srcInc, bool dstInc) {
+  first.BTCTRL.bit.VALID    = 1;
+  first.BTCTRL.bit.BEATSIZE = size;
+  first.BTCTRL.bit.SRCINC   = srcInc;
+  first.BTCTRL.bit.DSTINC   = dstInc;
+  first.BTCNT.reg           = count;
+  first.SRCADDR.reg         = (uint32_t)(uintptr_t)src + (srcInc ? (count << size) : 0);
+  first.DSTADDR.reg         = (uint32_t)(uintptr_t)dst + (dstInc ? (count << size) : 0);
+  first.DESCADDR.reg        = 0;
+  return &first;
+}
+
+// Gather the descriptor chain's bytes (SRCADDR is the END address when
+// incrementing, as on the real DMAC) and put them on the bus that owns
+// the destination DATA register.
+ZeroDMAstatus Adafruit_ZeroDMA::startJob(void) {
+  static std::vector<uint8_t> bytes;
+  SPIClass *spi = NULL;
+  if(jobStatus == DMA_STATUS_BUSY) return DMA_STATUS_BUSY;
+  bytes.clear();
+  DmacDescriptor *d = &first;
+  for(int links=0; d && (links < 64); links++) {
+    uint32_t beat = 1 << d->BTCTRL.bit.BEATSIZE, n = d->BTCNT.reg * beat;
+    uint8_t *src  = (uint8_t *)(uintptr_t)(d->SRCADDR.reg - (d->BTCTRL.bit.SRCINC ? n : 0));
+    for(uint32_t i=0; i<n; i++) bytes.push_back(src[d->BTCTRL.bit.SRCINC ? i : (i % beat)]);
+    for(auto &b : bus) {
+      if((uint32_t)(uintptr_t)b.spi->getDataRegister() == d->DSTADDR.reg) spi = b.spi;
+    }
+    d = d->DESCADDR.reg ? (DmacDescriptor *)(uintptr_t)d->DESCADDR.reg : NULL;
+  }
+  if(!spi) return DMA_STATUS_ERR_NOT_FOUND;
+  findBus(spi)->stats.dmaJobs++;
+  doneAt    = emu_bus_send(spi, bytes.data(), bytes.size(), false); // Syncs clock first
+  jobStatus = DMA_STATUS_BUSY;
+  busy      = true;
+  if(stallNext[channel]) { // Never completes; sketch must fix() it
+    doneAt             = UINT64_MAX;
+    stallNext[channel] = false;
+  }
+  return DMA_STATUS_OK;
+}
+
+uint64_t emu_dma_next_done(void) {
+  uint64_t t = UINT64_MAX;
+  for(auto c : channels) {
+    if(c->busy && (c->doneAt < t)) t = c->doneAt;
+  }
+  return t;
+}
+
+void emu_dma_complete_due(void) {
+  for(auto c : channels) {
+    if(c->busy && (c->doneAt <= emu_now_ns)) {
+      c->busy      = false;
+      c->jobStatus = DMA_STATUS_OK;
+      if(c->callback) {
+        isrDma = c;
+        emu_run_isr(dmaIsr);
+      }
+    }
+  }
+}
+
+void emu_dma_stall(uint8_t channel) {
+  if(channel < 32) stallNext[channel] = true;
+}
@@ -0,0 +1,399 @@
+// SPDX-FileCopyrightText: 2024 Monster Mask Open Claw Project
+//
+// SPDX-License-Identifier: MIT
+
+// Voice changer harness: runs the sketch's pdmvoice.cpp alone on the
+// emulated board, with the PDM mic fed from a WAV file and the DAC output
+// written to another, and reports its cost and splice quality.
+//
+// Input is PCM (8/16/24/32-bit, any rate, first channel used), turned into
+// a 3 MHz PDM bitstream by a second-order sigma-delta modulator, or a raw
+// PDM recording (WAV with 1 bit per sample, at the 3 MHz mic clock, first
+// bit in the LSB of each byte). Either way the sketch's own decimation
+// runs on it. Output is 16-bit mono at the playback timer's actual rate.
+
+#include "emu.h"
+#include "Adafruit_Arcada.h"
+#include <vector>
+
+#define PDM_HZ 3000000.0 // Mic bit clock (SPI_BITRATE in pdmvoice.cpp)
+
+Adafruit_Arcada arcada;          // Normally defined by M4_Eyes.ino
+uint32_t        frames = 0;      // "
+
+extern bool              voiceSetup(bool modEnable);
+extern float             voicePitch(float p);
+extern void              voiceGain(float g);
+extern void              voiceMod(uint32_t freq, uint8_t waveform);
+extern void              voiceAGC(float target, float maxGain, float attack, float release, float gate);
+extern volatile uint32_t voiceSplices;
+extern volatile int32_t  voiceAgcGain;
+extern volatile bool     voiceGateOpen;
+extern volatile uint32_t voiceAgcSamples;
+
+// Effect chain (voicefx.cpp), as globals.h
+#define FX_MAX 8
+typedef struct {
+  uint8_t type;
+  float   freq, mix, bits, ms, feedback, drive;
+} fxSpec;
+extern bool              fxSetup(const fxSpec *spec, uint8_t n);
+extern int8_t            fxType(const char *name);
+extern const char       *fxName(uint8_t i);
+extern volatile uint8_t  fxStages;
+extern uint32_t          fxSetupCycles[FX_MAX];
+
+// Input ---------------------------------------------------------------------
+
+static std::vector<float>   pcm;        // -1.0 to +1.0
+static double               pcmRate;
+static std::vector<uint8_t> pdm;        // Packed bits, if a PDM recording
+static uint64_t             pdmBits;    // Bits consumed so far
+static double               inSeconds;
+
+static uint32_t le32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+static uint16_t le16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+
+static bool loadWav(const char *filename) {
+  FILE *f = fopen(filename, "rb");
+  if(!f) {
+    fprintf(stderr, "voice: can't open %s\n", filename);
+    return false;
+  }
+  std::vector<uint8_t> d;
+  uint8_t              buf[65536];
+  size_t               n;
+  while((n = fread(buf, 1, sizeof buf, f)) > 0) d.insert(d.end(), buf, buf + n);
+  fclose(f);
+  if((d.size() < 12) || memcmp(&d[0], "RIFF", 4) || memcmp(&d[8], "WAVE", 4)) {
+    fprintf(stderr, "voice: %s isn't a WAV file\n", filename);
+    return false;
+  }
+  uint16_t format = 0, channels = 0, bits = 0;
+  uint32_t rate = 0;
+  for(size_t pos = 12; pos + 8 <= d.size(); ) {
+    uint32_t len = le32(&d[pos + 4]);
+    const uint8_t *c = &d[pos + 8];
+    if(pos + 8 + len > d.size()) len = d.size() - pos - 8;
+    if(!memcmp(&d[pos], "fmt ", 4) && (len >= 16)) {
+      format   = le16(c);
+      channels = le16(c + 2);
+      rate     = le32(c + 4);
+      bits     = le16(c + 14);
+      if((format == 0xFFFE) && (len >= 26)) format = le16(c + 24); // Extensible
+    } else if(!memcmp(&d[pos], "data", 4)) {
+      if(!channels || !rate) break;
+      if(bits == 1) {
+        if(fabs(rate - PDM_HZ) > 1.0) {
+          fprintf(stderr, "voice: PDM input is %u Hz, mic clock is %.0f; playing as-is\n",
+            (unsigned)rate, PDM_HZ);
+        }
+        pdm.assign(c, c + len);
+        inSeconds = len * 8.0 / PDM_HZ;
+        return true;
+      }
+      int bytes = bits / 8;
+      if((format != 1) || (bytes < 1) || (bytes > 4)) break;
+      pcmRate = rate;
+      for(uint32_t i=0; i + bytes * channels <= len; i += bytes * channels) {
+        int32_t s;
+        switch(bytes) {
+         case 1:  s = ((int32_t)c[i] - 128) << 24;  break; // 8-bit is unsigned
+         case 2:  s = (int32_t)(le16(&c[i]) << 16); break;
+         case 3:  s = (int32_t)((c[i] << 8) | (c[i + 1] << 16) | ((uint32_t)c[i + 2] << 24)); break;
+         default: s = (int32_t)le32(&c[i]);         break;
+        }
+        pcm.push_back(s / 2147483648.0f);
+      }
+      inSeconds = pcm.size() / pcmRate;
+      return true;
+    }
+    pos += 8 + len + (len & 1);
+  }
+  fprintf(stderr, "voice: %s: need PCM 8-32 bit or 1-bit PDM\n", filename);
+  return false;
+}
+
+// Next 32 mic bits. PCM is linearly interpolated to the bit clock and
+// modulated; past the end of the input, the mic hears silence.
+static uint32_t micWord(void) {
+  static double i1 = 0.0, i2 = 0.0, fb = 0.0;
+  uint32_t      word = 0;
+  if(!pdm.empty()) {
+    for(int b=0; b<32; b++, pdmBits++) {
+      bool bit = (pdmBits / 8 < pdm.size()) ? ((pdm[pdmBits / 8] >> (pdmBits & 7)) & 1) : (pdmBits & 1);
+      word |= (uint32_t)bit << b;
+    }
+    return word;
+  }
+  for(int b=0; b<32; b++, pdmBits++) {
+    double t = pdmBits / PDM_HZ * pcmRate, x = 0.0;
+    size_t i = (size_t)t;
+    if(i + 1 < pcm.size()) x = pcm[i] + (pcm[i + 1] - pcm[i]) * (t - i);
+    if(x > 0.9) x = 0.9; else if(x < -0.9) x = -0.9; // Keep modulator stable
+    i1 += x - fb;
+    i2 += i1 - fb;
+    fb  = (i2 >= 0.0) ? 1.0 : -1.0;
+    if(fb > 0.0) word |= 1u << b;
+  }
+  return word;
+}
+
+// Output and splices -------------------------------------------------------
+
+static std::vector<int16_t>  out;
+static std::vector<uint32_t> spliceAt;    // Output index each splice starts
+static uint32_t              lastSplices = 0;
+
+static void dacWrite(int channel, int value) {
+  if(channel) return; // A1 is the same signal
+  if(voiceSplices != lastSplices) { // Started during the previous callback
+    lastSplices = voiceSplices;
+    spliceAt.push_back(out.size());
+  }
+  out.push_back((value - 2048) * 16);
+}
+
+static bool writeWav(const char *filename, uint32_t rate) {
+  FILE *f = fopen(filename, "wb");
+  if(!f) {
+    fprintf(stderr, "voice: can't write %s\n", filename);
+    return false;
+  }
+  uint32_t len = out.size() * 2;
+  uint8_t  h[44];
+  auto put32 = [&](int i, uint32_t v) { h[i] = v; h[i + 1] = v >> 8; h[i + 2] = v >> 16; h[i + 3] = v >> 24; };
+  auto put16 = [&](int i, uint16_t v) { h[i] = v; h[i + 1] = v >> 8; };
+  memcpy(h, "RIFF", 4);      put32(4, 36 + len); memcpy(&h[8], "WAVEfmt ", 8);
+  put32(16, 16);             put16(20, 1);       put16(22, 1);
+  put32(24, rate);           put32(28, rate * 2); put16(32, 2); put16(34, 16);
+  memcpy(&h[36], "data", 4); put32(40, len);
+  fwrite(h, 1, sizeof h, f);
+  for(int16_t s : out) {
+    uint8_t b[2] = { (uint8_t)s, (uint8_t)(s >> 8) };
+    fwrite(b, 1, 2, f);
+  }
+  fclose(f);
+  return true;
+}
+
+// Reports -------------------------------------------------------------------
+
+static const char *outFile   = NULL;
+static double      clickMs   = 6.0;  // Window after each splice start
+static double      settleMs  = 50.0; // Output ignored by the click metric
+
+void emu_report(const char *why) {
+  double   outRate = arcada.timerFreq, cyclesPerNs = 0.12 * emu_cpu_scale; // 120 MHz
+  uint32_t pdmCalls, outCalls;
+  uint64_t pdmNs, outNs;
+  emu_timer_stats(EMU_TIMER_PDM, &pdmCalls, &pdmNs);
+  emu_timer_stats(EMU_TIMER_AUDIO, &outCalls, &outNs);
+  // Two PDM interrupts per mic sample
+  double inCycles  = pdmCalls ? 2.0 * pdmNs * cyclesPerNs / pdmCalls : 0.0,
+         outCycles = outCalls ? (double)outNs * cyclesPerNs / outCalls : 0.0;
+  double load      = (inCycles * PDM_HZ / 64.0 + outCycles * outRate) / 120e6 * 100.0;
+  fflush(stdout);
+  fprintf(stderr, "VOICE:reason=%s,inSeconds=%.2f,inSamples=%lu,outSamples=%lu,outRate=%.1f,"
+    "inCyclesPerSample=%.1f,outCyclesPerSample=%.1f,cpuLoad=%.1f%%\n",
+    why, inSeconds, (unsigned long)(pdmCalls / 2), (unsigned long)out.size(), outRate,
+    inCycles, outCycles, load);
+
+  // Click metric: mean squared second difference of the output over each
+  // splice's window, relative to that of the output between splices, in
+  // dB. A seamless splice is near 0 dB; a click stands well above it. The
+  // first --settle-ms (recording buffer filling) is left out of both.
+  uint32_t win    = (uint32_t)(clickMs * outRate / 1000.0 + 0.5),
+           settle = (uint32_t)(settleMs * outRate / 1000.0 + 0.5);
+  std::vector<bool> inSplice(out.size(), false);
+  for(uint32_t s : spliceAt) {
+    for(uint32_t i=s; (i < s + win) && (i < out.size()); i++) inSplice[i] = true;
+  }
+  double   total = 0.0;
+  uint32_t n     = 0;
+  for(size_t i=((settle > 2) ? settle : 2); i<out.size(); i++) {
+    if(inSplice[i]) continue;
+    double d2 = out[i] - 2.0 * out[i - 1] + out[i - 2];
+    total += d2 * d2;
+    n++;
+  }
+  double   base  = n ? total / n : 0.0;
+  double   sumDb = 0.0, maxDb = -INFINITY, maxAt = 0.0;
+  int      maxStep = 0;
+  uint32_t counted = 0;
+  for(uint32_t s : spliceAt) {
+    if((s < settle) || (s < 2) || (s + win > out.size()) || (base <= 0.0)) continue;
+    double e = 0.0;
+    for(uint32_t i=s; i<s + win; i++) {
+      double d2 = out[i] - 2.0 * out[i - 1] + out[i - 2];
+      e += d2 * d2;
+      int step = abs(out[i] - out[i - 1]) / 16; // DAC LSBs
+      if(step > maxStep) maxStep = step;
+    }
+    double db = 10.0 * log10((e / win + 1e-9) / base);
+    sumDb += db;
+    if(db > maxDb) {
+      maxDb = db;
+      maxAt = s * 1000.0 / outRate;
+    }
+    counted++;
+  }
+  // AGC's own cycle count is timed inside the PDM interrupt, where the
+  // emulator's CYCCNT stands still; its cost shows in inCyclesPerSample.
+  if(voiceAgcSamples) {
+    fprintf(stderr, "VOICE:agcGain=%.2f,gate=%s\n",
+      voiceAgcGain / 4096.0, voiceGateOpen ? "open" : "shut");
+  }
+  // Effects are timed by fxSetup(), outside any interrupt, so these count
+  if(fxStages) {
+    fprintf(stderr, "VOICE:fxCyclesPerBlock=");
+    for(uint8_t i=0; i<fxStages; i++) {
+      fprintf(stderr, "%s%s:%lu", i ? "," : "", fxName(i), (unsigned long)fxSetupCycles[i]);
+    }
+    fprintf(stderr, "\n");
+  }
+  fprintf(stderr, "VOICE:splices=%lu,splicesPerSec=%.1f,clickMeanDb=%.2f,clickMaxDb=%.2f,"
+    "clickMaxAtMs=%.1f,spliceMaxStep=%d\n",
+    (unsigned long)spliceAt.size(), outCalls ? spliceAt.size() * outRate / outCalls : 0.0,
+    counted ? sumDb / counted : 0.0, counted ? maxDb : 0.0, maxAt, maxStep);
+
+  // Clicks as a power ratio rather than dB, so the tolerance is relative
+  emu_metric("voice.inCyclesPerSample", inCycles, false, 20.0);
+  emu_metric("voice.outCyclesPerSample", outCycles, false, 20.0);
+  emu_metric("voice.cpuLoad", load, false, 20.0);
+  if(counted) emu_metric("voice.clickMaxRatio", pow(10.0, maxDb / 10.0), false, 25.0);
+}
+
+void emu_exit(int status) {
+  status = emu_bench_finish(status);
+  if(outFile && !writeWav(outFile, (uint32_t)(arcada.timerFreq + 0.5))) status = 1;
+  fflush(stdout);
+  fflush(stderr);
+  exit(status);
+}
+
+// Effects -------------------------------------------------------------------
+
+static fxSpec  fxChain[FX_MAX + 1]; // One spare, so fxSetup() sees a chain too long
+static uint8_t fxCount = 0;
+
+// --fx TYPE[:KEY=VALUE,...], keys as in a config.eye voiceFX entry
+static bool parseFx(const char *arg) {
+  char buf[128], *keys;
+  strncpy(buf, arg, sizeof buf - 1);
+  buf[sizeof buf - 1] = 0;
+  if((keys = strchr(buf, ':'))) *keys++ = 0;
+  int8_t type = fxType(buf);
+  if((type < 0) || (fxCount > FX_MAX)) return false;
+  fxSpec *fx = &fxChain[fxCount++];
+  fx->type   = type;
+  fx->freq   = fx->mix = fx->bits = fx->ms = fx->feedback = fx->drive = -1.0;
+  for(char *kv = keys ? strtok(keys, ",") : NULL; kv; kv = strtok(NULL, ",")) {
+    char *eq = strchr(kv, '=');
+    if(!eq) return false;
+    *eq = 0;
+    float v = atof(eq + 1);
+    if(!strcmp(kv, "freq"))          fx->freq     = v;
+    else if(!strcmp(kv, "mix"))      fx->mix      = v;
+    else if(!strcmp(kv, "bits"))     fx->bits     = v;
+    else if(!strcmp(kv, "ms"))       fx->ms       = v;
+    else if(!strcmp(kv, "feedback")) fx->feedback = v;
+    else if(!strcmp(kv, "drive"))    fx->drive    = v;
+    else return false;
+  }
+  return true;
+}
+
+// main() ----------------------------------------------------------------------
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+    "usage: %s --in FILE.wav | --tone HZ  [options]\n"
+    "  --in FILE.wav     mic input, PCM or 1-bit PDM\n"
+    "  --tone HZ         mic input is a sine at half scale instead\n"
+    "  --seconds S       length of --tone input (default 2)\n"
+    "  --out FILE.wav    write the DAC output\n"
+    "  --pitch P         voicePitch() (default 1.0)\n"
+    "  --gain G          voiceGain() (default 1.0)\n"
+    "  --mod HZ,WAVE     voiceMod(), WAVE 1-4 = square, sine, tri, saw\n"
+    "  --agc T[,G,A,R]   voiceAGC() target level, max gain, attack/release ms\n"
+    "  --gate LEVEL      voiceAGC() noise gate level\n"
+    "  --fx SPEC         add an effect, TYPE[:KEY=VALUE,...], e.g. echo:ms=80,mix=0.3\n"
+    "  --click-ms N      window after each splice for the click metric (default 6)\n"
+    "  --settle-ms N     start-up output the click metric ignores (default 50)\n"
+    "  --cpu-scale X     M4 time per host time for voice code (default 10)\n"
+    "  --baseline-save F save benchmark metrics to F at exit\n"
+    "  --baseline F      compare metrics with F, exit 3 on regressions\n"
+    "  --quiet           don't echo serial output\n",
+    prog);
+  exit(2);
+}
+
+int main(int argc, char *argv[]) {
+  const char *inFile = NULL;
+  double      tone = 0.0, seconds = 2.0, pitch = 1.0, gain = 1.0;
+  uint32_t    modFreq = 0;
+  int         modWave = 0;
+  float       agc[4]  = { 0.0, 4.0, 5.0, 300.0 }, gate = 0.0; // As config.eye
+
+  emu_init(argc, argv);
+  emu_run_limit_ns = UINT64_MAX; // Runs for the length of the input
+  for(int i=1; i<argc; i++) {
+    const char *a = argv[i], *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+    int         n = emu_common_option(a, v);
+    if(!n) {
+      if(!v) usage(argv[0]);
+      if(!strcmp(a, "--in"))            inFile   = v;
+      else if(!strcmp(a, "--tone"))     tone     = atof(v);
+      else if(!strcmp(a, "--seconds"))  seconds  = atof(v);
+      else if(!strcmp(a, "--out"))      outFile  = v;
+      else if(!strcmp(a, "--pitch"))    pitch    = atof(v);
+      else if(!strcmp(a, "--gain"))     gain     = atof(v);
+      else if(!strcmp(a, "--click-ms")) clickMs  = atof(v);
+      else if(!strcmp(a, "--settle-ms")) settleMs = atof(v);
+      else if(!strcmp(a, "--gate"))     gate     = atof(v);
+      else if(!strcmp(a, "--fx")) {
+        if(!parseFx(v)) usage(argv[0]);
+      }
+      else if(!strcmp(a, "--agc")) {
+        if(sscanf(v, "%f,%f,%f,%f", &agc[0], &agc[1], &agc[2], &agc[3]) < 1) usage(argv[0]);
+      }
+      else if(!strcmp(a, "--mod")) {
+        if(sscanf(v, "%u,%d", &modFreq, &modWave) != 2) usage(argv[0]);
+      } else usage(argv[0]);
+      n = 2;
+    }
+    if(n < 0) usage(argv[0]);
+    i += n - 1;
+  }
+  if(inFile) {
+    if(!loadWav(inFile)) return 1;
+  } else if(tone > 0.0) {
+    pcmRate   = 48000.0;
+    inSeconds = seconds;
+    for(uint32_t i=0; i<(uint32_t)(seconds * pcmRate); i++) {
+      pcm.push_back(0.5 * sin(2.0 * M_PI * tone * i / pcmRate));
+    }
+  } else {
+    usage(argv[0]);
+  }
+  emu_mic_word = micWord;
+  emu_dac_hook = dacWrite;
+  emu_start();
+
+  if(!fxSetup(fxChain, fxCount)) { // Before voiceSetup(), as the sketch does
+    fprintf(stderr, "voice: fxSetup() refused the effect chain\n");
+    return 1;
+  }
+  if(!voiceSetup(modWave > 0)) {
+    fprintf(stderr, "voice: voiceSetup() failed\n");
+    return 1;
+  }
+  voiceGain(gain);
+  voiceAGC(agc[0], agc[1], agc[2], agc[3], gate);
+  voicePitch(pitch);
+  if(modWave) voiceMod(modFreq, modWave);
+  emu_wait_until(emu_now_ns + (uint64_t)(inSeconds * 1e9));
+  emu_report("end");
+  emu_exit(0);
+}
@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+"""
+Convert WAV files to IMA-ADPCM for the Monster M4SK WAV player.
+
+IMA-ADPCM stores 4 bits per sample, half the size of the 8-bit PCM the
+player otherwise uses (a quarter of 16-bit PCM), so twice as much audio fits
+in flash and each second of playback reads half as much from it. The
+firmware decodes it block by block (M4_Eyes/adpcm.cpp); this writes the
+matching format: WAV format 0x11, mono, blocks of --block bytes, each a
+4-byte header (first sample and step index) then two samples per byte, low
+nibble first.
+
+Input may be 8-, 16-, 24- or 32-bit PCM at any sample rate; multi-channel
+input is mixed to mono. The sample rate is kept as-is, so resample first
+if needed (the firmware's DAC is 8-bit, 16-22 KHz is plenty). Each file's
+signal-to-noise ratio against the input is printed after encoding.
+
+Usage:
+    python wav2adpcm.py [--block BYTES] input.wav [output.wav]
+
+Output defaults to the input name with -adpcm added before .wav. Block size
+defaults to 256 bytes (505 samples); the firmware accepts up to 512.
+"""
+
+import math
+import os
+import struct
+import sys
+import wave
+
+STEP_TABLE = [
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+    19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+    130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+    876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+    5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767]
+
+INDEX_TABLE = [-1, -1, -1, -1, 2, 4, 6, 8]
+
+BLOCK_MAX = 512  # Largest blockAlign the firmware accepts
+
+
+def read_wav(path):
+    """Read a PCM WAV, return (sample_rate, list of 16-bit mono samples)."""
+    with wave.open(path, "rb") as w:
+        channels = w.getnchannels()
+        width = w.getsampwidth()
+        rate = w.getframerate()
+        raw = w.readframes(w.getnframes())
+
+    samples = []
+    frame = channels * width
+    for i in range(0, len(raw) - frame + 1, frame):
+        total = 0
+        for c in range(channels):
+            b = raw[i + c * width:i + (c + 1) * width]
+            if width == 1:  # 8-bit WAV is unsigned
+                v = (b[0] - 128) << 8
+            else:  # Wider is signed; keep the top 16 bits
+                v = int.from_bytes(b, "little", signed=True) >> (8 * (width - 2))
+            total += v
+        samples.append(int(total / channels))
+    return rate, samples
+
+
+def encode_nibble(sample, pred, index):
+    """Encode one sample; return (nibble, new predictor, new index).
+    The predictor is updated exactly as the decoder will, so errors
+    don't accumulate."""
+    step = STEP_TABLE[index]
+    delta = sample - pred
+    nibble = 0
+    if delta < 0:
+        nibble = 8
+        delta = -delta
+    diff = step >> 3
+    if delta >= step:
+        nibble |= 4
+        delta -= step
+        diff += step
+    if delta >= step >> 1:
+        nibble |= 2
+        delta -= step >> 1
+        diff += step >> 1
+    if delta >= step >> 2:
+        nibble |= 1
+        diff += step >> 2
+    if nibble & 8:
+        pred = max(pred - diff, -32768)
+    else:
+        pred = min(pred + diff, 32767)
+    index = min(max(index + INDEX_TABLE[nibble & 7], 0), 88)
+    return nibble, pred, index
+
+
+def encode(samples, block_size):
+    """Encode samples to ADPCM blocks; return (data bytes, decoded samples)."""
+    per_block = (block_size - 4) * 2 + 1
+    data = bytearray()
+    decoded = []
+    index = 0
+    for start in range(0, len(samples), per_block):
+        block = samples[start:start + per_block]
+        pred = block[0]
+        data += struct.pack("<hBB", pred, index, 0)
+        decoded.append(pred)
+        nibbles = []
+        for s in block[1:]:
+            n, pred, index = encode_nibble(s, pred, index)
+            nibbles.append(n)
+            decoded.append(pred)
+        if len(nibbles) & 1:  # Pad last block to a whole byte
+            n, pred, index = encode_nibble(pred, pred, index)
+            nibbles.append(n)
+        for i in range(0, len(nibbles), 2):
+            data.append(nibbles[i] | (nibbles[i + 1] << 4))
+    return bytes(data), decoded
+
+
+def write_adpcm_wav(path, rate, block_size, num_samples, data):
+    per_block = (block_size - 4) * 2 + 1
+    fmt = struct.pack("<HHIIHHHH", 0x11, 1, rate,
+                      rate * block_size // per_block, block_size, 4,
+                      2, per_block)
+    fact = struct.pack("<I", num_samples)
+    pad = b"\0" if len(data) & 1 else b""
+    body = (b"WAVE"
+            + b"fmt " + struct.pack("<I", len(fmt)) + fmt
+            + b"fact" + struct.pack("<I", len(fact)) + fact
+            + b"data" + struct.pack("<I", len(data)) + data + pad)
+    with open(path, "wb") as f:
+        f.write(b"RIFF" + struct.pack("<I", len(body)) + body)
+
+
+def snr_db(original, decoded):
+    signal = sum(s * s for s in original)
+    noise = sum((s - d) * (s - d) for s, d in zip(original, decoded))
+    if not noise:
+        return float("inf")
+    if not signal:
+        return 0.0
+    return 10.0 * math.log10(signal / noise)
+
+
+def main():
+    args = sys.argv[1:]
+    block_size = 256
+    if len(args) >= 2 and args[0] == "--block":
+        block_size = int(args[1])
+        args = args[2:]
+    if not 1 <= len(args) <= 2 or not 5 <= block_size <= BLOCK_MAX:
+        print(__doc__)
+        sys.exit(1)
+
+    in_path = args[0]
+    out_path = args[1] if len(args) > 1 else \
+        os.path.splitext(in_path)[0] + "-adpcm.wav"
+
+    rate, samples = read_wav(in_path)
+    if not samples:
+        sys.exit("%s: no samples" % in_path)
+    data, decoded = encode(samples, block_size)
+    write_adpcm_wav(out_path, rate, block_size, len(samples), data)
+    print("%s: %d samples at %d Hz, %d -> %d bytes, SNR %.1f dB" % (
+        out_path, len(samples), rate, os.path.getsize(in_path),
+        os.path.getsize(out_path), snr_db(samples, decoded)))
+
+
+if __name__ == "__main__":
+    main()